@@ -11,16 +11,37 @@
  * and limitations under the License.
  *************************************************************************************************/
 
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
 #include <grpc/grpc.h>
 #include <grpcpp/channel.h>
 #include <grpcpp/client_context.h>
+#include <grpcpp/completion_queue.h>
 #include <grpcpp/create_channel.h>
 #include <grpcpp/security/credentials.h>
+#include <grpcpp/server.h>
+#include <grpcpp/support/channel_arguments.h>
 
 #include "tkrzw_cmd_util.h"
 #include "tkrzw_dbm_remote.h"
 #include "tkrzw_rpc.grpc.pb.h"
 #include "tkrzw_rpc.pb.h"
+#include "tkrzw_rpc_common.h"
+#include "tkrzw_time_util.h"
 
 namespace tkrzw {
 
@@ -64,6 +85,277 @@ Status MakeStatusFromProto(const tkrzw::StatusProto& proto) {
   return Status(tkrzw::Status::Code(proto.code()), message);
 }
 
+struct RemoteDBMReplica final {
+  std::string address;
+  std::unique_ptr<DBMService::StubInterface> stub;
+  std::atomic_bool healthy;
+  std::atomic_int64_t lag;
+  std::atomic_int32_t num_outstanding;
+  RemoteDBMReplica(const std::string& address,
+                   std::unique_ptr<DBMService::StubInterface> stub)
+      : address(address), stub(std::move(stub)), healthy(false), lag(0), num_outstanding(0) {}
+};
+
+constexpr const char* INPROC_ADDRESS_PREFIX = "inproc:";
+
+std::map<std::string, grpc::Server*>& GetInProcessServers(std::mutex** mutex) {
+  static std::map<std::string, grpc::Server*> servers;
+  static std::mutex servers_mutex;
+  *mutex = &servers_mutex;
+  return servers;
+}
+
+grpc::Server* FindInProcessServer(const std::string& name) {
+  std::mutex* mutex = nullptr;
+  auto& servers = GetInProcessServers(&mutex);
+  std::lock_guard<std::mutex> lock(*mutex);
+  const auto it = servers.find(name);
+  return it == servers.end() ? nullptr : it->second;
+}
+
+Status MakeChannelArguments(
+    const RemoteDBM::ConnectOptions& options, grpc::ChannelArguments* args) {
+  if (options.max_send_message_size != 0) {
+    args->SetMaxSendMessageSize(std::max(options.max_send_message_size, -1));
+  }
+  if (options.max_receive_message_size != 0) {
+    args->SetMaxReceiveMessageSize(std::max(options.max_receive_message_size, -1));
+  }
+  if (options.keepalive_time > 0) {
+    args->SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, static_cast<int>(options.keepalive_time * 1000));
+    args->SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS,
+                 static_cast<int>(options.keepalive_timeout * 1000));
+    args->SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, options.keepalive_without_calls);
+    // Pings are sent even if there's no data frame so that idle connections are kept.
+    args->SetInt(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
+  }
+  if (!options.compression.empty()) {
+    if (options.compression == "none") {
+      args->SetCompressionAlgorithm(GRPC_COMPRESS_NONE);
+    } else if (options.compression == "deflate") {
+      args->SetCompressionAlgorithm(GRPC_COMPRESS_DEFLATE);
+    } else if (options.compression == "gzip") {
+      args->SetCompressionAlgorithm(GRPC_COMPRESS_GZIP);
+    } else {
+      return Status(Status::INVALID_ARGUMENT_ERROR, "unknown compression algorithm");
+    }
+  }
+  if (!options.load_balancing_policy.empty()) {
+    args->SetLoadBalancingPolicyName(options.load_balancing_policy);
+  }
+  return Status(Status::SUCCESS);
+}
+
+constexpr double CACHE_SYNC_INTERVAL = 1.0;
+constexpr int32_t CACHE_OBSERVER_ID = -1;
+constexpr int64_t RETRY_TOKEN_UNIT = 1000;
+constexpr int64_t RETRY_MAX_TOKENS = 10 * RETRY_TOKEN_UNIT;
+
+class RemoteDBMCache final {
+ public:
+  RemoteDBMCache(int64_t capacity, double max_staleness, int32_t dbm_index)
+      : capacity_(capacity), max_staleness_(max_staleness), dbm_index_(dbm_index),
+        records_(), index_(), epoch_(0), synced_time_(-1), num_hits_(0), num_misses_(0),
+        num_invalidations_(0), num_syncs_(0), mutex_() {}
+
+  double GetMaxStaleness() const {
+    return max_staleness_;
+  }
+
+  bool Get(std::string_view key, std::string* value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(std::string(key));
+    if (it == index_.end()) {
+      num_misses_++;
+      return false;
+    }
+    // A record is fresh if it was retrieved or confirmed by the stream recently.
+    const double known_time = std::max(it->second->fetch_time, synced_time_);
+    if (GetWallTime() - known_time > max_staleness_) {
+      records_.erase(it->second);
+      index_.erase(it);
+      num_misses_++;
+      return false;
+    }
+    records_.splice(records_.begin(), records_, it->second);
+    if (value != nullptr) {
+      *value = it->second->value;
+    }
+    num_hits_++;
+    return true;
+  }
+
+  uint64_t GetEpoch() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return epoch_;
+  }
+
+  void Add(std::string_view key, std::string_view value, uint64_t epoch, double fetch_time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Skips the record if it might have been updated while it was being retrieved.
+    if (epoch != epoch_) {
+      return;
+    }
+    Store(key, value, fetch_time, true);
+  }
+
+  void Update(int32_t dbm_index, std::string_view key, std::string_view value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dbm_index != dbm_index_) {
+      return;
+    }
+    epoch_++;
+    num_invalidations_++;
+    Store(key, value, GetWallTime(), false);
+  }
+
+  void Remove(int32_t dbm_index, std::string_view key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dbm_index != dbm_index_) {
+      return;
+    }
+    epoch_++;
+    num_invalidations_++;
+    auto it = index_.find(std::string(key));
+    if (it != index_.end()) {
+      records_.erase(it->second);
+      index_.erase(it);
+    }
+  }
+
+  void Clear(int32_t dbm_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dbm_index != dbm_index_) {
+      return;
+    }
+    epoch_++;
+    num_invalidations_++;
+    records_.clear();
+    index_.clear();
+  }
+
+  void Reset(int32_t dbm_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dbm_index_ = dbm_index;
+    epoch_++;
+    records_.clear();
+    index_.clear();
+  }
+
+  void Synchronize(bool first) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (first) {
+      epoch_++;
+      num_syncs_++;
+      records_.clear();
+      index_.clear();
+    }
+    synced_time_ = GetWallTime();
+  }
+
+  void Inspect(std::vector<std::pair<std::string, std::string>>* records) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t num_lookups = num_hits_ + num_misses_;
+    records->emplace_back(std::make_pair("cache_capacity", ToString(capacity_)));
+    records->emplace_back(std::make_pair("cache_num_records", ToString(index_.size())));
+    records->emplace_back(std::make_pair("cache_num_hits", ToString(num_hits_)));
+    records->emplace_back(std::make_pair("cache_num_misses", ToString(num_misses_)));
+    records->emplace_back(std::make_pair("cache_hit_rate", SPrintF(
+        "%.4f", num_lookups > 0 ? num_hits_ * 1.0 / num_lookups : 0.0)));
+    records->emplace_back(std::make_pair(
+        "cache_num_invalidations", ToString(num_invalidations_)));
+    records->emplace_back(std::make_pair("cache_num_syncs", ToString(num_syncs_)));
+    records->emplace_back(std::make_pair("cache_sync_age", SPrintF(
+        "%.3f", synced_time_ < 0 ? -1.0 : GetWallTime() - synced_time_)));
+  }
+
+ private:
+  struct Record {
+    std::string key;
+    std::string value;
+    double fetch_time;
+  };
+  typedef std::list<Record> RecordList;
+
+  void Store(std::string_view key, std::string_view value, double fetch_time, bool adding) {
+    auto it = index_.find(std::string(key));
+    if (it != index_.end()) {
+      it->second->value = value;
+      it->second->fetch_time = fetch_time;
+      records_.splice(records_.begin(), records_, it->second);
+      return;
+    }
+    if (!adding) {
+      return;
+    }
+    records_.emplace_front(Record{std::string(key), std::string(value), fetch_time});
+    index_.emplace(records_.front().key, records_.begin());
+    while (static_cast<int64_t>(index_.size()) > capacity_) {
+      index_.erase(records_.back().key);
+      records_.pop_back();
+    }
+  }
+
+  int64_t capacity_;
+  double max_staleness_;
+  int32_t dbm_index_;
+  RecordList records_;
+  std::unordered_map<std::string, RecordList::iterator> index_;
+  uint64_t epoch_;
+  double synced_time_;
+  int64_t num_hits_;
+  int64_t num_misses_;
+  int64_t num_invalidations_;
+  int64_t num_syncs_;
+  std::mutex mutex_;
+};
+
+struct RemoteDBMBatchCall final {
+  std::string_view key;
+  std::string_view value;
+  std::string* result;
+  Status status;
+};
+
+struct RemoteDBMBatch final {
+  std::vector<RemoteDBMBatchCall*> calls;
+  bool done = false;
+};
+
+struct RemoteDBMBatcher final {
+  std::shared_ptr<RemoteDBMBatch> current;
+  std::mutex mutex;
+  std::condition_variable cond;
+};
+
+class RemoteDBMAsyncCall {
+ public:
+  virtual ~RemoteDBMAsyncCall() = default;
+  virtual void Finish() = 0;
+  grpc::ClientContext context;
+  grpc::Status status;
+};
+
+template <typename RESPONSE>
+class RemoteDBMAsyncCallImpl final : public RemoteDBMAsyncCall {
+ public:
+  typedef std::function<void(const grpc::Status&, RESPONSE*)> Handler;
+  explicit RemoteDBMAsyncCallImpl(Handler handler) : handler_(std::move(handler)) {}
+  void Finish() override {
+    handler_(status, &response);
+  }
+  RESPONSE response;
+  std::unique_ptr<grpc::ClientAsyncResponseReaderInterface<RESPONSE>> reader;
+
+ private:
+  Handler handler_;
+};
+
+template <typename REQUEST, typename RESPONSE>
+using RemoteDBMAsyncMethod =
+    std::unique_ptr<grpc::ClientAsyncResponseReaderInterface<RESPONSE>>
+    (DBMService::StubInterface::*)(grpc::ClientContext*, const REQUEST&, grpc::CompletionQueue*);
+
 class RemoteDBMImpl final {
   friend class RemoteDBMStreamImpl;
   friend class RemoteDBMIteratorImpl;
@@ -75,11 +367,24 @@ class RemoteDBMImpl final {
   RemoteDBMImpl();
   ~RemoteDBMImpl();
   void InjectStub(void* stub);
-  Status Connect(const std::string& address, double timeout);
+  Status InjectReplicaStubs(const std::vector<void*>& stubs,
+                            double max_staleness, double heartbeat_interval);
+  Status Connect(const std::string& address, const RemoteDBM::ConnectOptions& options);
+  Status ConnectReplicas(const std::vector<std::string>& addresses,
+                         double max_staleness, double heartbeat_interval);
+  Status EnableCache(int64_t capacity, double max_staleness);
+  Status SetRetryPolicy(const RemoteDBM::RetryPolicy& policy);
+  Status EnableBatching(double window, int32_t max_batch_size);
+  Status EnableIteratorPrefetch(int32_t window);
+  Status EnableAutoReconnect(int32_t max_attempts, double initial_backoff, double max_backoff);
   Status Disconnect();
   Status SetDBMIndex(int32_t dbm_index);
+  Status SetMinTimestamp(int64_t min_timestamp);
+  int64_t GetLastTimestamp();
+  void UpdateLastTimestamp(int64_t timestamp);
   Status Echo(std::string_view message, std::string* echo);
   Status Inspect(std::vector<std::pair<std::string, std::string>>* records);
+  Status InspectClient(std::vector<std::pair<std::string, std::string>>* records);
   Status Get(std::string_view key, std::string* value);
   Status GetMulti(
       const std::vector<std::string_view>& keys, std::map<std::string, std::string>* records);
@@ -97,6 +402,7 @@ class RemoteDBMImpl final {
   Status CompareExchangeMulti(
       const std::vector<std::pair<std::string_view, std::string_view>>& expected,
       const std::vector<std::pair<std::string_view, std::string_view>>& desired);
+  Status ExecuteBatch(RemoteDBMBatchImpl* batch, bool atomic);
   Status Count(int64_t* count);
   Status GetFileSize(int64_t* file_size);
   Status Clear();
@@ -106,15 +412,129 @@ class RemoteDBMImpl final {
   Status SearchModal(std::string_view mode, std::string_view pattern,
                      std::vector<std::string>* matched, size_t capacity);
   Status ChangeMaster(std::string_view master, double timestamp_skew);
+  Status SetAsyncThreads(int32_t num_threads);
+  void GetAsync(std::string_view key,
+                std::function<void(const Status&, const std::string&)> callback);
+  void GetMultiAsync(
+      const std::vector<std::string_view>& keys,
+      std::function<void(const Status&, const std::map<std::string, std::string>&)> callback);
+  void SetAsync(std::string_view key, std::string_view value, bool overwrite,
+                std::function<void(const Status&)> callback);
+  void SetMultiAsync(const std::map<std::string_view, std::string_view>& records,
+                     bool overwrite, std::function<void(const Status&)> callback);
+  void RemoveAsync(std::string_view key, std::function<void(const Status&)> callback);
+  void RemoveMultiAsync(const std::vector<std::string_view>& keys,
+                        std::function<void(const Status&)> callback);
+  void AppendMultiAsync(const std::map<std::string_view, std::string_view>& records,
+                        std::string_view delim, std::function<void(const Status&)> callback);
 
  private:
+  DBMService::StubInterface* PickStub();
+  Status AddReplicas(std::vector<std::unique_ptr<RemoteDBMReplica>> replicas,
+                     double max_staleness, double heartbeat_interval);
+  void CheckReplicas();
+  void SendHeartbeat(RemoteDBMReplica* replica);
+  void StopHeartbeat();
+  void SyncCache();
+  void StopCache();
+  bool IsCacheReadable() const;
+  void InvalidateCache(std::string_view key);
+  DBMService::StubInterface* AcquireReadStub(RemoteDBMReplica** replica);
+  void ReleaseReadStub(RemoteDBMReplica* replica);
+  template <typename REQUEST, typename RESPONSE>
+  grpc::Status CallRead(
+      grpc::Status (DBMService::StubInterface::*call)(
+          grpc::ClientContext*, const REQUEST&, RESPONSE*),
+      const REQUEST& request, RESPONSE* response,
+      RemoteDBMAsyncMethod<REQUEST, RESPONSE> hedge_call = nullptr,
+      bool* from_replica = nullptr);
+  template <typename REQUEST, typename RESPONSE>
+  grpc::Status CallReadOnce(
+      grpc::Status (DBMService::StubInterface::*call)(
+          grpc::ClientContext*, const REQUEST&, RESPONSE*),
+      const REQUEST& request, RESPONSE* response,
+      RemoteDBMAsyncMethod<REQUEST, RESPONSE> hedge_call, bool* from_replica);
+  template <typename REQUEST, typename RESPONSE>
+  grpc::Status CallHedged(
+      DBMService::StubInterface* stub, RemoteDBMAsyncMethod<REQUEST, RESPONSE> call,
+      const REQUEST& request, RESPONSE* response, DBMService::StubInterface** winner_stub);
+  DBMService::StubInterface* PickHedgeStub(DBMService::StubInterface* first);
+  RemoteDBMReplica* FindReplica(DBMService::StubInterface* stub);
+  bool ShouldRetry(const grpc::Status& status, int32_t num_attempts);
+  bool CanReconnect();
+  bool WaitBackoff(double max_backoff);
+  bool WaitReconnectBackoff(int32_t num_attempts);
+  Status CallBatched(RemoteDBMBatcher* batcher, RemoteDBMBatchCall* call,
+                     void (RemoteDBMImpl::*execute)(RemoteDBMBatch*));
+  void ExecuteGetBatch(RemoteDBMBatch* batch);
+  void ExecuteSetBatch(RemoteDBMBatch* batch);
+  void ExecuteRemoveBatch(RemoteDBMBatch* batch);
+  void DriveAsyncCalls(grpc::CompletionQueue* queue);
+  void StopAsyncThreads();
+  template <typename REQUEST, typename RESPONSE>
+  void CallAsync(
+      DBMService::StubInterface* stub, RemoteDBMAsyncMethod<REQUEST, RESPONSE> call,
+      const REQUEST& request, typename RemoteDBMAsyncCallImpl<RESPONSE>::Handler handler);
+  template <typename REQUEST, typename RESPONSE>
+  void CallReadAsync(
+      RemoteDBMAsyncMethod<REQUEST, RESPONSE> call, const REQUEST& request,
+      typename RemoteDBMAsyncCallImpl<RESPONSE>::Handler handler);
+
   std::unique_ptr<DBMService::StubInterface> stub_;
+  std::vector<std::unique_ptr<DBMService::StubInterface>> channel_stubs_;
+  std::atomic_uint32_t channel_cursor_;
   double timeout_;
+  grpc::ChannelArguments channel_args_;
   int32_t dbm_index_;
+  int64_t min_timestamp_;
+  std::atomic_int64_t last_timestamp_;
   StreamList streams_;
   IteratorList iterators_;
   ReplicatorList replicators_;
-  SpinSharedMutex mutex_;
+  std::vector<std::unique_ptr<RemoteDBMReplica>> replicas_;
+  double max_staleness_;
+  double heartbeat_interval_;
+  std::atomic_uint32_t replica_cursor_;
+  std::thread heartbeat_thread_;
+  std::mutex heartbeat_mutex_;
+  std::condition_variable heartbeat_cond_;
+  bool heartbeat_alive_;
+  std::unique_ptr<RemoteDBMCache> cache_;
+  std::thread cache_thread_;
+  std::mutex cache_mutex_;
+  std::condition_variable cache_cond_;
+  bool cache_alive_;
+  RemoteDBMReplicatorImpl* cache_repl_;
+  RemoteDBM::RetryPolicy retry_policy_;
+  std::set<grpc::StatusCode> retryable_codes_;
+  std::atomic_int64_t retry_tokens_;
+  std::atomic_int64_t retry_num_retries_;
+  std::atomic_int64_t retry_num_throttled_;
+  std::atomic_int64_t hedge_num_sent_;
+  std::atomic_int64_t hedge_num_won_;
+  double batch_window_;
+  int32_t batch_max_size_;
+  RemoteDBMBatcher get_batcher_;
+  RemoteDBMBatcher set_batcher_;
+  RemoteDBMBatcher remove_batcher_;
+  std::atomic_int64_t batch_num_batches_;
+  std::atomic_int64_t batch_num_calls_;
+  int32_t iterator_prefetch_;
+  int32_t reconnect_max_attempts_;
+  double reconnect_initial_backoff_;
+  double reconnect_max_backoff_;
+  std::atomic_int64_t reconnect_num_successes_;
+  std::atomic_int64_t reconnect_num_failures_;
+  std::unique_ptr<grpc::CompletionQueue> async_queue_;
+  std::vector<std::thread> async_threads_;
+  int32_t num_async_threads_;
+  std::set<RemoteDBMAsyncCall*> async_calls_;
+  bool async_stopping_;
+  std::mutex async_mutex_;
+  std::mutex backoff_mutex_;
+  std::condition_variable backoff_cond_;
+  bool disconnecting_;
+  SlottedSharedMutex mutex_;
 };
 
 class RemoteDBMStreamImpl final {
@@ -135,11 +555,16 @@ class RemoteDBMStreamImpl final {
                    int64_t* current, int64_t initial, bool ignore_result);
 
  private:
+  bool ResetStream();
+  Status Reconnect();
+
   RemoteDBMImpl* dbm_;
-  grpc::ClientContext context_;
+  std::unique_ptr<grpc::ClientContext> context_;
   std::unique_ptr<grpc::ClientReaderWriterInterface<
                     tkrzw::StreamRequest, tkrzw::StreamResponse>> stream_;
   std::atomic_bool healthy_;
+  std::atomic_bool cancelled_;
+  std::mutex context_mutex_;
 };
 
 class RemoteDBMIteratorImpl final {
@@ -160,11 +585,38 @@ class RemoteDBMIteratorImpl final {
   Status Remove();
 
  private:
+  struct Prefetched {
+    Status next_status;
+    Status get_status;
+    std::string key;
+    std::string value;
+  };
+  Status WriteRequest(const IterateRequest& request);
+  Status ReadResponse(IterateResponse* response);
+  Status SendPrefetch();
+  Status ReceivePrefetch();
+  Status DiscardPrefetch(bool restore);
+  Status NextPrefetched();
+  void SetResumePoint(const IterateRequest& request);
+  void SetResumeKey(std::string_view key);
+  bool ResetStream();
+  Status Reconnect();
+
   RemoteDBMImpl* dbm_;
-  grpc::ClientContext context_;
+  std::unique_ptr<grpc::ClientContext> context_;
   std::unique_ptr<grpc::ClientReaderWriterInterface<
                     tkrzw::IterateRequest, tkrzw::IterateResponse>> stream_;
   std::atomic_bool healthy_;
+  std::atomic_bool cancelled_;
+  std::mutex context_mutex_;
+  IterateRequest resume_request_;
+  int32_t resume_steps_;
+  int32_t prefetch_size_;
+  std::deque<Prefetched> prefetched_;
+  int32_t num_inflight_;
+  Prefetched current_;
+  bool has_current_;
+  bool at_end_;
 };
 
 class RemoteDBMReplicatorImpl final {
@@ -174,22 +626,71 @@ class RemoteDBMReplicatorImpl final {
   ~RemoteDBMReplicatorImpl();
   void Cancel();
   int32_t GetMasterServerID();
-  Status Start(int64_t min_timestamp, int32_t server_id, double wait_time);
+  Status Start(int64_t min_timestamp, int32_t server_id, double wait_time,
+               const std::string& address);
   Status Read(int64_t* timestamp, RemoteDBM::ReplicateLog* op);
+  int64_t GetOriginTimestamp();
+  void GetPosition(int64_t* session_id, int64_t* sequence);
+  Status Ack(int64_t timestamp, int64_t session_id, int64_t sequence);
 
  private:
+  Status Reconnect();
+
   RemoteDBMImpl* dbm_;
-  grpc::ClientContext context_;
+  std::unique_ptr<grpc::ClientContext> context_;
   std::unique_ptr<grpc::ClientReaderInterface<tkrzw::ReplicateResponse>> stream_;
   std::atomic_bool healthy_;
+  std::atomic_bool cancelled_;
+  std::mutex context_mutex_;
   int32_t server_id_;
+  int32_t client_server_id_;
+  double stream_timeout_;
+  ReplicateRequest start_request_;
+  int64_t last_timestamp_;
+  int64_t origin_timestamp_;
+  std::atomic_int64_t session_id_;
+  std::atomic_int64_t sequence_;
+};
+
+class RemoteDBMBatchImpl final {
+  friend class RemoteDBMImpl;
+ public:
+  RemoteDBMBatchImpl();
+  void SetDBMIndex(int32_t dbm_index);
+  BatchOperation* AddOperation(BatchOperation::OpType op_type, std::string_view key);
+  int32_t GetNumOperations() const;
+  Status GetResult(int32_t index, std::string* value, int64_t* current);
+  void Clear();
+
+ private:
+  int32_t dbm_index_;
+  BatchRequest request_;
+  BatchResponse response_;
+  bool executed_;
 };
 
 RemoteDBMImpl::RemoteDBMImpl()
-    : stub_(nullptr), timeout_(0), dbm_index_(0),
-      streams_(), iterators_(), replicators_(), mutex_() {}
+    : stub_(nullptr), channel_stubs_(), channel_cursor_(0),
+      timeout_(0), channel_args_(), dbm_index_(0), min_timestamp_(0), last_timestamp_(0),
+      streams_(), iterators_(), replicators_(),
+      replicas_(), max_staleness_(0), heartbeat_interval_(0), replica_cursor_(0),
+      heartbeat_thread_(), heartbeat_mutex_(), heartbeat_cond_(), heartbeat_alive_(false),
+      cache_(nullptr), cache_thread_(), cache_mutex_(), cache_cond_(), cache_alive_(false),
+      cache_repl_(nullptr), retry_policy_(), retryable_codes_({grpc::StatusCode::UNAVAILABLE}),
+      retry_tokens_(RETRY_MAX_TOKENS), retry_num_retries_(0), retry_num_throttled_(0),
+      hedge_num_sent_(0), hedge_num_won_(0), batch_window_(-1), batch_max_size_(0),
+      get_batcher_(), set_batcher_(), remove_batcher_(), batch_num_batches_(0),
+      batch_num_calls_(0), iterator_prefetch_(0), reconnect_max_attempts_(0),
+      reconnect_initial_backoff_(0), reconnect_max_backoff_(0), reconnect_num_successes_(0),
+      reconnect_num_failures_(0),
+      async_queue_(nullptr), async_threads_(), num_async_threads_(1), async_calls_(),
+      async_stopping_(false), async_mutex_(), backoff_mutex_(), backoff_cond_(),
+      disconnecting_(false), mutex_() {}
 
 RemoteDBMImpl::~RemoteDBMImpl() {
+  StopHeartbeat();
+  StopCache();
+  StopAsyncThreads();
   for (auto* stream : streams_) {
     stream->dbm_ = nullptr;
   }
@@ -205,52 +706,794 @@ void RemoteDBMImpl::InjectStub(void* stub) {
   stub_.reset(reinterpret_cast<DBMService::StubInterface*>(stub));
 }
 
-Status RemoteDBMImpl::Connect(const std::string& address, double timeout) {
-  std::lock_guard<SpinSharedMutex> lock(mutex_);
+Status RemoteDBMImpl::Connect(
+    const std::string& address, const RemoteDBM::ConnectOptions& options) {
+  std::lock_guard<SlottedSharedMutex> lock(mutex_);
   if (stub_ != nullptr) {
     return Status(Status::PRECONDITION_ERROR, "connected database");
   }
-  if (timeout < 0) {
-    timeout = INT32MAX;
+  const int32_t num_channels = options.num_channels;
+  if (num_channels < 1) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "invalid number of channels");
+  }
+  grpc::ChannelArguments base_args;
+  const Status args_status = MakeChannelArguments(options, &base_args);
+  if (args_status != Status::SUCCESS) {
+    return args_status;
   }
-  auto channel = grpc::CreateChannel(address, grpc::InsecureChannelCredentials());
+  const double connect_timeout = options.connect_timeout < 0 ? INT32MAX : options.connect_timeout;
   const auto deadline = std::chrono::system_clock::now() +
-      std::chrono::microseconds(static_cast<int64_t>(timeout * 1000000));
-  while (true) {
-    auto status = channel->GetState(true);
-    if (status == GRPC_CHANNEL_READY) {
-      break;
+      std::chrono::microseconds(static_cast<int64_t>(connect_timeout * 1000000));
+  grpc::Server* inproc_server = nullptr;
+  if (StrBeginsWith(address, INPROC_ADDRESS_PREFIX)) {
+    inproc_server = FindInProcessServer(address.substr(std::strlen(INPROC_ADDRESS_PREFIX)));
+    if (inproc_server == nullptr) {
+      return Status(Status::NOT_FOUND_ERROR, "unknown in-process server");
+    }
+  }
+  std::vector<std::unique_ptr<DBMService::StubInterface>> stubs;
+  for (int32_t i = 0; i < num_channels; i++) {
+    // Distinct arguments and a local subchannel pool prevent channels from sharing one
+    // connection.
+    grpc::ChannelArguments args = base_args;
+    if (num_channels > 1) {
+      args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+      args.SetInt("tkrzw.channel_index", i);
     }
-    if ((status != GRPC_CHANNEL_IDLE && status != GRPC_CHANNEL_CONNECTING) ||
-        !channel->WaitForStateChange(status, deadline)) {
-      return Status(Status::NETWORK_ERROR, "connection failed");
+    if (inproc_server != nullptr) {
+      stubs.emplace_back(DBMService::NewStub(inproc_server->InProcessChannel(args)));
+      continue;
+    }
+    auto channel = grpc::CreateCustomChannel(
+        address, grpc::InsecureChannelCredentials(), args);
+    while (true) {
+      auto status = channel->GetState(true);
+      if (status == GRPC_CHANNEL_READY) {
+        break;
+      }
+      if ((status != GRPC_CHANNEL_IDLE && status != GRPC_CHANNEL_CONNECTING) ||
+          !channel->WaitForStateChange(status, deadline)) {
+        return Status(Status::NETWORK_ERROR, "connection failed");
+      }
+    }
+    stubs.emplace_back(DBMService::NewStub(channel));
+  }
+  stub_ = std::move(stubs.front());
+  channel_stubs_.clear();
+  for (size_t i = 1; i < stubs.size(); i++) {
+    channel_stubs_.emplace_back(std::move(stubs[i]));
+  }
+  timeout_ = options.call_timeout < 0 ? INT32MAX : options.call_timeout;
+  channel_args_ = base_args;
+  return Status(Status::SUCCESS);
+}
+
+DBMService::StubInterface* RemoteDBMImpl::PickStub() {
+  if (channel_stubs_.empty()) {
+    return stub_.get();
+  }
+  const uint32_t index = channel_cursor_.fetch_add(1) % (channel_stubs_.size() + 1);
+  return index == 0 ? stub_.get() : channel_stubs_[index - 1].get();
+}
+
+Status RemoteDBMImpl::ConnectReplicas(const std::vector<std::string>& addresses,
+                                      double max_staleness, double heartbeat_interval) {
+  std::vector<std::unique_ptr<RemoteDBMReplica>> replicas;
+  {
+    std::shared_lock<SlottedSharedMutex> lock(mutex_);
+    for (const auto& address : addresses) {
+      auto channel = grpc::CreateCustomChannel(
+          address, grpc::InsecureChannelCredentials(), channel_args_);
+      replicas.emplace_back(std::make_unique<RemoteDBMReplica>(
+          address, DBMService::NewStub(channel)));
+    }
+  }
+  return AddReplicas(std::move(replicas), max_staleness, heartbeat_interval);
+}
+
+Status RemoteDBMImpl::InjectReplicaStubs(const std::vector<void*>& stubs,
+                                         double max_staleness, double heartbeat_interval) {
+  std::vector<std::unique_ptr<RemoteDBMReplica>> replicas;
+  for (size_t i = 0; i < stubs.size(); i++) {
+    replicas.emplace_back(std::make_unique<RemoteDBMReplica>(
+        StrCat("injected:", i), std::unique_ptr<DBMService::StubInterface>(
+            reinterpret_cast<DBMService::StubInterface*>(stubs[i]))));
+  }
+  return AddReplicas(std::move(replicas), max_staleness, heartbeat_interval);
+}
+
+Status RemoteDBMImpl::AddReplicas(std::vector<std::unique_ptr<RemoteDBMReplica>> replicas,
+                                  double max_staleness, double heartbeat_interval) {
+  {
+    std::lock_guard<SlottedSharedMutex> lock(mutex_);
+    if (stub_ == nullptr) {
+      return Status(Status::PRECONDITION_ERROR, "not connected database");
+    }
+    if (!replicas_.empty() || heartbeat_thread_.joinable()) {
+      return Status(Status::PRECONDITION_ERROR, "connected replicas");
+    }
+    replicas_ = std::move(replicas);
+    max_staleness_ = max_staleness;
+    heartbeat_interval_ = heartbeat_interval;
+  }
+  {
+    std::shared_lock<SlottedSharedMutex> lock(mutex_);
+    for (auto& replica : replicas_) {
+      SendHeartbeat(replica.get());
     }
   }
-  stub_ = DBMService::NewStub(channel);
-  timeout_ = timeout;
+  {
+    std::lock_guard<std::mutex> lock(heartbeat_mutex_);
+    heartbeat_alive_ = true;
+  }
+  heartbeat_thread_ = std::thread([&]{ CheckReplicas(); });
   return Status(Status::SUCCESS);
 }
 
 Status RemoteDBMImpl::Disconnect() {
-  std::lock_guard<SpinSharedMutex> lock(mutex_);
+  StopHeartbeat();
+  StopCache();
+  StopAsyncThreads();
+  // Threads sleeping for backoff with the shared lock are woken up to give it up.
+  {
+    std::lock_guard<std::mutex> backoff_lock(backoff_mutex_);
+    disconnecting_ = true;
+  }
+  backoff_cond_.notify_all();
+  std::lock_guard<SlottedSharedMutex> lock(mutex_);
+  {
+    std::lock_guard<std::mutex> backoff_lock(backoff_mutex_);
+    disconnecting_ = false;
+  }
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
+  replicas_.clear();
+  cache_.reset(nullptr);
+  channel_stubs_.clear();
   stub_.reset(nullptr);
   return Status(Status::SUCCESS);
 }
 
+void RemoteDBMImpl::CheckReplicas() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(heartbeat_mutex_);
+      if (heartbeat_cond_.wait_for(
+              lock, std::chrono::microseconds(static_cast<int64_t>(heartbeat_interval_ * 1000000)),
+              [&]() { return !heartbeat_alive_; })) {
+        break;
+      }
+    }
+    std::shared_lock<SlottedSharedMutex> lock(mutex_);
+    for (auto& replica : replicas_) {
+      SendHeartbeat(replica.get());
+    }
+  }
+}
+
+void RemoteDBMImpl::SendHeartbeat(RemoteDBMReplica* replica) {
+  grpc::ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+      static_cast<int64_t>(std::min(timeout_, heartbeat_interval_) * 1000000)));
+  HeartbeatRequest request;
+  HeartbeatResponse response;
+  const grpc::Status status = replica->stub->Heartbeat(&context, request, &response);
+  if (!status.ok() || (!response.master().empty() && !response.replicating())) {
+    replica->healthy.store(false);
+    return;
+  }
+  replica->lag.store(response.lag());
+  replica->healthy.store(true);
+}
+
+void RemoteDBMImpl::StopHeartbeat() {
+  {
+    std::lock_guard<std::mutex> lock(heartbeat_mutex_);
+    heartbeat_alive_ = false;
+  }
+  heartbeat_cond_.notify_all();
+  if (heartbeat_thread_.joinable()) {
+    heartbeat_thread_.join();
+  }
+}
+
+Status RemoteDBMImpl::EnableCache(int64_t capacity, double max_staleness) {
+  {
+    std::lock_guard<SlottedSharedMutex> lock(mutex_);
+    if (stub_ == nullptr) {
+      return Status(Status::PRECONDITION_ERROR, "not connected database");
+    }
+    if (cache_ != nullptr) {
+      return Status(Status::PRECONDITION_ERROR, "enabled cache");
+    }
+    if (capacity < 1 || max_staleness <= 0) {
+      return Status(Status::INVALID_ARGUMENT_ERROR, "invalid cache parameters");
+    }
+    cache_ = std::make_unique<RemoteDBMCache>(capacity, max_staleness, dbm_index_);
+  }
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_alive_ = true;
+  }
+  cache_thread_ = std::thread([&]{ SyncCache(); });
+  return Status(Status::SUCCESS);
+}
+
+void RemoteDBMImpl::SyncCache() {
+  const double wait_time = std::min(cache_->GetMaxStaleness() / 2, CACHE_SYNC_INTERVAL);
+  while (true) {
+    // The stream starts at the current timestamp of the server so that no update is missed.
+    int64_t min_timestamp = -1;
+    {
+      std::shared_lock<SlottedSharedMutex> lock(mutex_);
+      grpc::ClientContext context;
+      context.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+          static_cast<int64_t>(std::min(timeout_, CACHE_SYNC_INTERVAL) * 1000000)));
+      HeartbeatRequest request;
+      HeartbeatResponse response;
+      if (stub_->Heartbeat(&context, request, &response).ok()) {
+        min_timestamp = response.ulog_timestamp();
+      }
+    }
+    if (min_timestamp >= 0) {
+      RemoteDBMReplicatorImpl repl(this);
+      repl.stream_timeout_ = INT32MAX;
+      {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        if (!cache_alive_) {
+          break;
+        }
+        cache_repl_ = &repl;
+      }
+      if (repl.Start(min_timestamp, CACHE_OBSERVER_ID, wait_time, "") == Status::SUCCESS) {
+        cache_->Synchronize(true);
+        RemoteDBM::ReplicateLog op;
+        while (true) {
+          int64_t timestamp = 0;
+          const Status status = repl.Read(&timestamp, &op);
+          if (status != Status::SUCCESS && status != Status::INFEASIBLE_ERROR) {
+            break;
+          }
+          if (status == Status::SUCCESS) {
+            switch (op.op_type) {
+              case DBMUpdateLoggerMQ::OP_SET:
+                cache_->Update(op.dbm_index, op.key, op.value);
+                break;
+              case DBMUpdateLoggerMQ::OP_REMOVE:
+                cache_->Remove(op.dbm_index, op.key);
+                break;
+              case DBMUpdateLoggerMQ::OP_CLEAR:
+                cache_->Clear(op.dbm_index);
+                break;
+              default:
+                break;
+            }
+          }
+          cache_->Synchronize(false);
+        }
+      }
+      std::lock_guard<std::mutex> lock(cache_mutex_);
+      cache_repl_ = nullptr;
+    }
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    if (cache_cond_.wait_for(
+            lock, std::chrono::microseconds(static_cast<int64_t>(CACHE_SYNC_INTERVAL * 1000000)),
+            [&]() { return !cache_alive_; })) {
+      break;
+    }
+  }
+}
+
+void RemoteDBMImpl::StopCache() {
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_alive_ = false;
+    if (cache_repl_ != nullptr) {
+      cache_repl_->Cancel();
+    }
+  }
+  cache_cond_.notify_all();
+  if (cache_thread_.joinable()) {
+    cache_thread_.join();
+  }
+}
+
+// A fenced read must reflect the given timestamp, which the cache cannot prove.
+bool RemoteDBMImpl::IsCacheReadable() const {
+  return cache_ != nullptr && min_timestamp_ <= 0;
+}
+
+void RemoteDBMImpl::InvalidateCache(std::string_view key) {
+  if (cache_ != nullptr) {
+    cache_->Remove(dbm_index_, key);
+  }
+}
+
+DBMService::StubInterface* RemoteDBMImpl::AcquireReadStub(RemoteDBMReplica** replica) {
+  *replica = nullptr;
+  const size_t num_replicas = replicas_.size();
+  if (num_replicas == 0) {
+    return PickStub();
+  }
+  const int64_t max_lag = max_staleness_ * 1000;
+  const uint32_t cursor = replica_cursor_.fetch_add(1);
+  int32_t min_outstanding = INT32MAX;
+  for (size_t i = 0; i < num_replicas; i++) {
+    RemoteDBMReplica* candidate = replicas_[(cursor + i) % num_replicas].get();
+    if (!candidate->healthy.load() || candidate->lag.load() > max_lag) {
+      continue;
+    }
+    const int32_t num_outstanding = candidate->num_outstanding.load();
+    if (num_outstanding < min_outstanding) {
+      min_outstanding = num_outstanding;
+      *replica = candidate;
+    }
+  }
+  if (*replica == nullptr) {
+    return PickStub();
+  }
+  (*replica)->num_outstanding.fetch_add(1);
+  return (*replica)->stub.get();
+}
+
+void RemoteDBMImpl::ReleaseReadStub(RemoteDBMReplica* replica) {
+  if (replica != nullptr) {
+    replica->num_outstanding.fetch_sub(1);
+  }
+}
+
+template <typename REQUEST, typename RESPONSE>
+grpc::Status RemoteDBMImpl::CallRead(
+    grpc::Status (DBMService::StubInterface::*call)(
+        grpc::ClientContext*, const REQUEST&, RESPONSE*),
+    const REQUEST& request, RESPONSE* response,
+    RemoteDBMAsyncMethod<REQUEST, RESPONSE> hedge_call, bool* from_replica) {
+  if (retry_policy_.max_attempts > 1) {
+    int64_t tokens = retry_tokens_.load();
+    const int64_t earned = static_cast<int64_t>(retry_policy_.budget_ratio * RETRY_TOKEN_UNIT);
+    while (tokens < RETRY_MAX_TOKENS && !retry_tokens_.compare_exchange_weak(
+               tokens, std::min(RETRY_MAX_TOKENS, tokens + earned))) {}
+  }
+  int32_t num_attempts = 0;
+  while (true) {
+    num_attempts++;
+    const grpc::Status status = CallReadOnce(call, request, response, hedge_call, from_replica);
+    if (status.ok() || !ShouldRetry(status, num_attempts)) {
+      return status;
+    }
+    response->Clear();
+  }
+}
+
+bool RemoteDBMImpl::ShouldRetry(const grpc::Status& status, int32_t num_attempts) {
+  if (num_attempts >= retry_policy_.max_attempts ||
+      retryable_codes_.find(status.error_code()) == retryable_codes_.end()) {
+    return false;
+  }
+  int64_t tokens = retry_tokens_.load();
+  do {
+    if (tokens < RETRY_TOKEN_UNIT) {
+      retry_num_throttled_.fetch_add(1);
+      return false;
+    }
+  } while (!retry_tokens_.compare_exchange_weak(tokens, tokens - RETRY_TOKEN_UNIT));
+  const double max_backoff = std::min(retry_policy_.max_backoff, retry_policy_.initial_backoff *
+      std::pow(retry_policy_.backoff_multiplier, num_attempts - 1));
+  if (!WaitBackoff(max_backoff)) {
+    return false;
+  }
+  retry_num_retries_.fetch_add(1);
+  return true;
+}
+
+template <typename REQUEST, typename RESPONSE>
+grpc::Status RemoteDBMImpl::CallReadOnce(
+    grpc::Status (DBMService::StubInterface::*call)(
+        grpc::ClientContext*, const REQUEST&, RESPONSE*),
+    const REQUEST& request, RESPONSE* response,
+    RemoteDBMAsyncMethod<REQUEST, RESPONSE> hedge_call, bool* from_replica) {
+  RemoteDBMReplica* replica = nullptr;
+  DBMService::StubInterface* stub = AcquireReadStub(&replica);
+  RemoteDBMReplica* served_replica = replica;
+  grpc::Status status;
+  if (hedge_call != nullptr && retry_policy_.hedge_delay >= 0) {
+    // The winner of a hedged call can be another replica or the master.
+    DBMService::StubInterface* winner_stub = stub;
+    status = CallHedged(stub, hedge_call, request, response, &winner_stub);
+    served_replica = winner_stub == stub ? replica : FindReplica(winner_stub);
+  } else {
+    grpc::ClientContext context;
+    context.set_deadline(std::chrono::system_clock::now() +
+                         std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
+    status = (stub->*call)(&context, request, response);
+  }
+  ReleaseReadStub(replica);
+  bool replica_served = served_replica != nullptr;
+  if (served_replica != nullptr &&
+      (!status.ok() || response->status().code() == Status::INFEASIBLE_ERROR)) {
+    if (!status.ok()) {
+      served_replica->healthy.store(false);
+    }
+    grpc::ClientContext master_context;
+    master_context.set_deadline(
+        std::chrono::system_clock::now() +
+        std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
+    response->Clear();
+    status = (PickStub()->*call)(&master_context, request, response);
+    replica_served = false;
+  }
+  if (from_replica != nullptr) {
+    *from_replica = replica_served;
+  }
+  return status;
+}
+
+template <typename REQUEST, typename RESPONSE>
+grpc::Status RemoteDBMImpl::CallHedged(
+    DBMService::StubInterface* stub, RemoteDBMAsyncMethod<REQUEST, RESPONSE> call,
+    const REQUEST& request, RESPONSE* response, DBMService::StubInterface** winner_stub) {
+  struct Attempt {
+    grpc::ClientContext context;
+    grpc::Status status;
+    RESPONSE response;
+    std::unique_ptr<grpc::ClientAsyncResponseReaderInterface<RESPONSE>> reader;
+    DBMService::StubInterface* target = nullptr;
+  };
+  const auto now = std::chrono::system_clock::now();
+  const auto deadline =
+      now + std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000));
+  const auto hedge_deadline = now + std::chrono::microseconds(
+      static_cast<int64_t>(retry_policy_.hedge_delay * 1000000));
+  grpc::CompletionQueue queue;
+  Attempt attempts[2];
+  auto start = [&](Attempt* attempt, DBMService::StubInterface* target) {
+    attempt->target = target;
+    attempt->context.set_deadline(deadline);
+    attempt->reader = (target->*call)(&attempt->context, request, &queue);
+    attempt->reader->Finish(&attempt->response, &attempt->status, attempt);
+  };
+  start(&attempts[0], stub);
+  int32_t num_started = 1;
+  int32_t num_done = 0;
+  bool hedgeable = true;
+  Attempt* winner = nullptr;
+  while (num_done < num_started) {
+    void* tag = nullptr;
+    bool ok = false;
+    if (num_started < 2 && hedgeable) {
+      if (queue.AsyncNext(&tag, &ok, hedge_deadline) == grpc::CompletionQueue::TIMEOUT) {
+        // Hedging to the same target as the first attempt is pointless.
+        DBMService::StubInterface* hedge_stub = PickHedgeStub(stub);
+        if (hedge_stub == stub) {
+          hedgeable = false;
+          continue;
+        }
+        start(&attempts[1], hedge_stub);
+        num_started++;
+        hedge_num_sent_.fetch_add(1);
+        continue;
+      }
+    } else {
+      queue.Next(&tag, &ok);
+    }
+    num_done++;
+    winner = static_cast<Attempt*>(tag);
+    if (winner->status.ok()) {
+      break;
+    }
+  }
+  if (winner == &attempts[1]) {
+    hedge_num_won_.fetch_add(1);
+  }
+  for (int32_t i = 0; i < num_started; i++) {
+    attempts[i].context.TryCancel();
+  }
+  for (; num_done < num_started; num_done++) {
+    void* tag = nullptr;
+    bool ok = false;
+    queue.Next(&tag, &ok);
+  }
+  queue.Shutdown();
+  void* tag = nullptr;
+  bool ok = false;
+  while (queue.Next(&tag, &ok)) {}
+  *response = std::move(winner->response);
+  *winner_stub = winner->target;
+  return winner->status;
+}
+
+DBMService::StubInterface* RemoteDBMImpl::PickHedgeStub(DBMService::StubInterface* first) {
+  const size_t num_replicas = replicas_.size();
+  const int64_t max_lag = max_staleness_ * 1000;
+  const uint32_t cursor = replica_cursor_.fetch_add(1);
+  for (size_t i = 0; i < num_replicas; i++) {
+    RemoteDBMReplica* candidate = replicas_[(cursor + i) % num_replicas].get();
+    if (candidate->stub.get() != first && candidate->healthy.load() &&
+        candidate->lag.load() <= max_lag) {
+      return candidate->stub.get();
+    }
+  }
+  return PickStub();
+}
+
+RemoteDBMReplica* RemoteDBMImpl::FindReplica(DBMService::StubInterface* stub) {
+  for (auto& replica : replicas_) {
+    if (replica->stub.get() == stub) {
+      return replica.get();
+    }
+  }
+  return nullptr;
+}
+
+Status RemoteDBMImpl::SetRetryPolicy(const RemoteDBM::RetryPolicy& policy) {
+  std::set<grpc::StatusCode> codes;
+  for (const auto& name : policy.retryable_codes) {
+    bool found = false;
+    for (int32_t code = grpc::StatusCode::OK; code <= grpc::StatusCode::UNAUTHENTICATED;
+         code++) {
+      if (name == GRPCStatusCodeName(static_cast<grpc::StatusCode>(code))) {
+        codes.emplace(static_cast<grpc::StatusCode>(code));
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      return Status(Status::INVALID_ARGUMENT_ERROR, StrCat("unknown status code: ", name));
+    }
+  }
+  if (policy.max_attempts < 1) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "invalid number of attempts");
+  }
+  std::lock_guard<SlottedSharedMutex> lock(mutex_);
+  retry_policy_ = policy;
+  retryable_codes_ = std::move(codes);
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMImpl::EnableBatching(double window, int32_t max_batch_size) {
+  std::lock_guard<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  if (window < 0 || max_batch_size < 1) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "invalid batch parameters");
+  }
+  batch_window_ = window;
+  batch_max_size_ = max_batch_size;
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMImpl::EnableIteratorPrefetch(int32_t window) {
+  std::lock_guard<SlottedSharedMutex> lock(mutex_);
+  if (window < 0) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "invalid prefetch window");
+  }
+  iterator_prefetch_ = window;
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMImpl::EnableAutoReconnect(
+    int32_t max_attempts, double initial_backoff, double max_backoff) {
+  std::lock_guard<SlottedSharedMutex> lock(mutex_);
+  if (max_attempts < 0 || initial_backoff < 0 || max_backoff < initial_backoff) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "invalid reconnection parameters");
+  }
+  reconnect_max_attempts_ = max_attempts;
+  reconnect_initial_backoff_ = initial_backoff;
+  reconnect_max_backoff_ = max_backoff;
+  return Status(Status::SUCCESS);
+}
+
+bool RemoteDBMImpl::CanReconnect() {
+  return stub_ != nullptr && reconnect_max_attempts_ > 0;
+}
+
+// The full jitter spreads retries of many clients which failed at the same time.  The callers
+// hold the shared lock, so Disconnect cuts the sleep short rather than waiting for it.
+bool RemoteDBMImpl::WaitBackoff(double max_backoff) {
+  thread_local std::mt19937 misc_rng(std::random_device{}());
+  std::uniform_real_distribution<double> dist(0, std::max(0.0, max_backoff));
+  const auto duration = std::chrono::microseconds(static_cast<int64_t>(dist(misc_rng) * 1000000));
+  std::unique_lock<std::mutex> lock(backoff_mutex_);
+  return !backoff_cond_.wait_for(lock, duration, [&]() { return disconnecting_; });
+}
+
+bool RemoteDBMImpl::WaitReconnectBackoff(int32_t num_attempts) {
+  // Even the first attempt waits so that clients broken at the same time don't reconnect at once.
+  const double max_backoff = std::min(
+      reconnect_max_backoff_, reconnect_initial_backoff_ * std::pow(2.0, num_attempts - 1));
+  return WaitBackoff(max_backoff);
+}
+
+Status RemoteDBMImpl::CallBatched(RemoteDBMBatcher* batcher, RemoteDBMBatchCall* call,
+                                  void (RemoteDBMImpl::*execute)(RemoteDBMBatch*)) {
+  std::unique_lock<std::mutex> lock(batcher->mutex);
+  // The first call of a batch becomes the leader which sends the request for all calls.
+  const bool leader = batcher->current == nullptr;
+  if (leader) {
+    batcher->current = std::make_shared<RemoteDBMBatch>();
+  }
+  std::shared_ptr<RemoteDBMBatch> batch = batcher->current;
+  batch->calls.emplace_back(call);
+  if (static_cast<int32_t>(batch->calls.size()) >= batch_max_size_) {
+    batcher->current.reset();
+    batcher->cond.notify_all();
+  }
+  if (!leader) {
+    batcher->cond.wait(lock, [&]() { return batch->done; });
+    return call->status;
+  }
+  batcher->cond.wait_for(
+      lock, std::chrono::microseconds(static_cast<int64_t>(batch_window_ * 1000000)),
+      [&]() { return batcher->current != batch; });
+  if (batcher->current == batch) {
+    batcher->current.reset();
+  }
+  lock.unlock();
+  (this->*execute)(batch.get());
+  batch_num_batches_.fetch_add(1);
+  batch_num_calls_.fetch_add(batch->calls.size());
+  lock.lock();
+  batch->done = true;
+  batcher->cond.notify_all();
+  return call->status;
+}
+
+void RemoteDBMImpl::ExecuteGetBatch(RemoteDBMBatch* batch) {
+  GetMultiRequest request;
+  request.set_dbm_index(dbm_index_);
+  for (const auto* call : batch->calls) {
+    request.add_keys(std::string(call->key));
+  }
+  request.set_min_timestamp(min_timestamp_);
+  const uint64_t cache_epoch = cache_ == nullptr ? 0 : cache_->GetEpoch();
+  const double fetch_time = GetWallTime();
+  GetMultiResponse response;
+  bool from_replica = false;
+  grpc::Status status = CallRead(&DBMService::StubInterface::GetMulti, request, &response,
+                                 &DBMService::StubInterface::AsyncGetMulti, &from_replica);
+  if (!status.ok()) {
+    for (auto* call : batch->calls) {
+      call->status = Status(Status::NETWORK_ERROR, GRPCStatusString(status));
+    }
+    return;
+  }
+  std::map<std::string_view, std::string_view> records;
+  for (const auto& record : response.records()) {
+    records.emplace(std::string_view(record.first()), std::string_view(record.second()));
+    if (IsCacheReadable() && !from_replica) {
+      cache_->Add(record.first(), record.second(), cache_epoch, fetch_time);
+    }
+  }
+  const Status total_status = MakeStatusFromProto(response.status());
+  for (auto* call : batch->calls) {
+    const auto it = records.find(call->key);
+    if (it != records.end()) {
+      if (call->result != nullptr) {
+        *call->result = it->second;
+      }
+      call->status = Status(Status::SUCCESS);
+    } else if (total_status == Status::SUCCESS || total_status == Status::NOT_FOUND_ERROR) {
+      call->status = Status(Status::NOT_FOUND_ERROR);
+    } else {
+      call->status = total_status;
+    }
+  }
+}
+
+void RemoteDBMImpl::ExecuteSetBatch(RemoteDBMBatch* batch) {
+  // Later calls of the same key overwrite earlier ones, as if they were done sequentially.
+  std::map<std::string_view, std::string_view> records;
+  for (const auto* call : batch->calls) {
+    records[call->key] = call->value;
+  }
+  grpc::ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() +
+                       std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
+  SetMultiRequest request;
+  request.set_dbm_index(dbm_index_);
+  for (const auto& record : records) {
+    auto* req_record = request.add_records();
+    req_record->set_first(std::string(record.first));
+    req_record->set_second(std::string(record.second));
+  }
+  request.set_overwrite(true);
+  SetMultiResponse response;
+  grpc::Status status = PickStub()->SetMulti(&context, request, &response);
+  for (const auto& record : records) {
+    InvalidateCache(record.first);
+  }
+  Status total_status(Status::SUCCESS);
+  if (status.ok()) {
+    UpdateLastTimestamp(response.timestamp());
+    total_status = MakeStatusFromProto(response.status());
+  } else {
+    total_status = Status(Status::NETWORK_ERROR, GRPCStatusString(status));
+  }
+  for (auto* call : batch->calls) {
+    call->status = total_status;
+  }
+}
+
+void RemoteDBMImpl::ExecuteRemoveBatch(RemoteDBMBatch* batch) {
+  std::set<std::string_view> keys;
+  grpc::ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() +
+                       std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
+  RemoveMultiRequest request;
+  request.set_dbm_index(dbm_index_);
+  for (const auto* call : batch->calls) {
+    if (keys.emplace(call->key).second) {
+      request.add_keys(std::string(call->key));
+    }
+  }
+  request.set_report_missing(true);
+  RemoveMultiResponse response;
+  grpc::Status status = PickStub()->RemoveMulti(&context, request, &response);
+  for (const auto& key : keys) {
+    InvalidateCache(key);
+  }
+  if (!status.ok()) {
+    for (auto* call : batch->calls) {
+      call->status = Status(Status::NETWORK_ERROR, GRPCStatusString(status));
+    }
+    return;
+  }
+  UpdateLastTimestamp(response.timestamp());
+  const Status total_status = MakeStatusFromProto(response.status());
+  std::set<std::string_view> missing_keys;
+  for (const auto& key : response.missing_keys()) {
+    missing_keys.emplace(key);
+  }
+  // Only the first call of each key removes the record, as if they were done sequentially.
+  std::set<std::string_view> removed_keys;
+  for (auto* call : batch->calls) {
+    if (missing_keys.find(call->key) != missing_keys.end() ||
+        removed_keys.find(call->key) != removed_keys.end()) {
+      call->status = Status(Status::NOT_FOUND_ERROR);
+    } else if (total_status == Status::SUCCESS || total_status == Status::NOT_FOUND_ERROR) {
+      call->status = Status(Status::SUCCESS);
+      removed_keys.emplace(call->key);
+    } else {
+      call->status = total_status;
+    }
+  }
+}
+
 Status RemoteDBMImpl::SetDBMIndex(int32_t dbm_index) {
-  std::lock_guard<SpinSharedMutex> lock(mutex_);
+  std::lock_guard<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   dbm_index_ = dbm_index;
+  if (cache_ != nullptr) {
+    cache_->Reset(dbm_index);
+  }
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMImpl::SetMinTimestamp(int64_t min_timestamp) {
+  std::lock_guard<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  min_timestamp_ = min_timestamp;
   return Status(Status::SUCCESS);
 }
 
+int64_t RemoteDBMImpl::GetLastTimestamp() {
+  return last_timestamp_.load();
+}
+
+void RemoteDBMImpl::UpdateLastTimestamp(int64_t timestamp) {
+  int64_t last_timestamp = last_timestamp_.load();
+  while (timestamp > last_timestamp &&
+         !last_timestamp_.compare_exchange_weak(last_timestamp, timestamp)) {}
+}
+
 Status RemoteDBMImpl::Echo(std::string_view message, std::string* echo) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -260,7 +1503,7 @@ Status RemoteDBMImpl::Echo(std::string_view message, std::string* echo) {
   EchoRequest request;
   request.set_message(std::string(message));
   EchoResponse response;
-  grpc::Status status = stub_->Echo(&context, request, &response);
+  grpc::Status status = PickStub()->Echo(&context, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
@@ -269,7 +1512,7 @@ Status RemoteDBMImpl::Echo(std::string_view message, std::string* echo) {
 }
 
 Status RemoteDBMImpl::Inspect(std::vector<std::pair<std::string, std::string>>* records) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -279,7 +1522,7 @@ Status RemoteDBMImpl::Inspect(std::vector<std::pair<std::string, std::string>>*
   InspectRequest request;
   request.set_dbm_index(dbm_index_);
   InspectResponse response;
-  grpc::Status status = stub_->Inspect(&context, request, &response);
+  grpc::Status status = PickStub()->Inspect(&context, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
@@ -289,61 +1532,117 @@ Status RemoteDBMImpl::Inspect(std::vector<std::pair<std::string, std::string>>*
   return Status(Status::SUCCESS);
 }
 
+Status RemoteDBMImpl::InspectClient(std::vector<std::pair<std::string, std::string>>* records) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  records->emplace_back(std::make_pair("connected", ToString(stub_ == nullptr ? 0 : 1)));
+  records->emplace_back(std::make_pair("num_channels", ToString(
+      stub_ == nullptr ? 0 : channel_stubs_.size() + 1)));
+  records->emplace_back(std::make_pair("num_replicas", ToString(replicas_.size())));
+  if (cache_ != nullptr) {
+    cache_->Inspect(records);
+  }
+  records->emplace_back(std::make_pair("retry_num_retries", ToString(retry_num_retries_.load())));
+  records->emplace_back(std::make_pair(
+      "retry_num_throttled", ToString(retry_num_throttled_.load())));
+  records->emplace_back(std::make_pair("hedge_num_sent", ToString(hedge_num_sent_.load())));
+  records->emplace_back(std::make_pair("hedge_num_won", ToString(hedge_num_won_.load())));
+  const int64_t num_batches = batch_num_batches_.load();
+  const int64_t num_batch_calls = batch_num_calls_.load();
+  records->emplace_back(std::make_pair("batch_num_batches", ToString(num_batches)));
+  records->emplace_back(std::make_pair("batch_num_calls", ToString(num_batch_calls)));
+  records->emplace_back(std::make_pair("batch_mean_size", SPrintF(
+      "%.3f", num_batches > 0 ? num_batch_calls * 1.0 / num_batches : 0.0)));
+  records->emplace_back(std::make_pair(
+      "reconnect_num_successes", ToString(reconnect_num_successes_.load())));
+  records->emplace_back(std::make_pair(
+      "reconnect_num_failures", ToString(reconnect_num_failures_.load())));
+  return Status(Status::SUCCESS);
+}
+
 Status RemoteDBMImpl::Get(std::string_view key, std::string* value) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
-  grpc::ClientContext context;
-  context.set_deadline(std::chrono::system_clock::now() +
-                       std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
+  if (IsCacheReadable() && cache_->Get(key, value)) {
+    return Status(Status::SUCCESS);
+  }
+  if (batch_window_ >= 0) {
+    RemoteDBMBatchCall call = {key, std::string_view(), value, Status(Status::SUCCESS)};
+    return CallBatched(&get_batcher_, &call, &RemoteDBMImpl::ExecuteGetBatch);
+  }
   GetRequest request;
   request.set_dbm_index(dbm_index_);
   request.set_key(key.data(), key.size());
   if (value == nullptr) {
     request.set_omit_value(true);
   }
+  request.set_min_timestamp(min_timestamp_);
+  const uint64_t cache_epoch = cache_ == nullptr ? 0 : cache_->GetEpoch();
+  const double fetch_time = GetWallTime();
   GetResponse response;
-  grpc::Status status = stub_->Get(&context, request, &response);
+  bool from_replica = false;
+  grpc::Status status = CallRead(&DBMService::StubInterface::Get, request, &response,
+                                 &DBMService::StubInterface::AsyncGet, &from_replica);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
   if (response.status().code() == 0 && value != nullptr) {
     *value = response.value();
+    if (IsCacheReadable() && !from_replica) {
+      cache_->Add(key, response.value(), cache_epoch, fetch_time);
+    }
   }
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::GetMulti(
     const std::vector<std::string_view>& keys, std::map<std::string, std::string>* records) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
-  grpc::ClientContext context;
-  context.set_deadline(std::chrono::system_clock::now() +
-                       std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
   GetMultiRequest request;
   request.set_dbm_index(dbm_index_);
   for (const auto& key : keys) {
+    std::string value;
+    if (IsCacheReadable() && cache_->Get(key, &value)) {
+      records->emplace(std::make_pair(std::string(key), std::move(value)));
+      continue;
+    }
     request.add_keys(std::string(key));
   }
+  if (request.keys_size() == 0 && !keys.empty()) {
+    return Status(Status::SUCCESS);
+  }
+  request.set_min_timestamp(min_timestamp_);
+  const uint64_t cache_epoch = cache_ == nullptr ? 0 : cache_->GetEpoch();
+  const double fetch_time = GetWallTime();
   GetMultiResponse response;
-  grpc::Status status = stub_->GetMulti(&context, request, &response);
+  bool from_replica = false;
+  grpc::Status status = CallRead(&DBMService::StubInterface::GetMulti, request, &response,
+                                 &DBMService::StubInterface::AsyncGetMulti, &from_replica);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
   for (const auto& record : response.records()) {
+    if (IsCacheReadable() && !from_replica) {
+      cache_->Add(record.first(), record.second(), cache_epoch, fetch_time);
+    }
     records->emplace(std::make_pair(record.first(), record.second()));
   }
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::Set(std::string_view key, std::string_view value, bool overwrite) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
+  if (batch_window_ >= 0 && overwrite) {
+    RemoteDBMBatchCall call = {key, value, nullptr, Status(Status::SUCCESS)};
+    return CallBatched(&set_batcher_, &call, &RemoteDBMImpl::ExecuteSetBatch);
+  }
   grpc::ClientContext context;
   context.set_deadline(std::chrono::system_clock::now() +
                        std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
@@ -353,16 +1652,18 @@ Status RemoteDBMImpl::Set(std::string_view key, std::string_view value, bool ove
   request.set_value(value.data(), value.size());
   request.set_overwrite(overwrite);
   SetResponse response;
-  grpc::Status status = stub_->Set(&context, request, &response);
+  grpc::Status status = PickStub()->Set(&context, request, &response);
+  InvalidateCache(key);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::SetMulti(
     const std::map<std::string_view, std::string_view>& records, bool overwrite) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -378,18 +1679,26 @@ Status RemoteDBMImpl::SetMulti(
   }
   request.set_overwrite(overwrite);
   SetMultiResponse response;
-  grpc::Status status = stub_->SetMulti(&context, request, &response);
+  grpc::Status status = PickStub()->SetMulti(&context, request, &response);
+  for (const auto& record : records) {
+    InvalidateCache(record.first);
+  }
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::Remove(std::string_view key) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
+  if (batch_window_ >= 0) {
+    RemoteDBMBatchCall call = {key, std::string_view(), nullptr, Status(Status::SUCCESS)};
+    return CallBatched(&remove_batcher_, &call, &RemoteDBMImpl::ExecuteRemoveBatch);
+  }
   grpc::ClientContext context;
   context.set_deadline(std::chrono::system_clock::now() +
                        std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
@@ -397,15 +1706,17 @@ Status RemoteDBMImpl::Remove(std::string_view key) {
   request.set_dbm_index(dbm_index_);
   request.set_key(key.data(), key.size());
   RemoveResponse response;
-  grpc::Status status = stub_->Remove(&context, request, &response);
+  grpc::Status status = PickStub()->Remove(&context, request, &response);
+  InvalidateCache(key);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::RemoveMulti(const std::vector<std::string_view>& keys) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -418,16 +1729,20 @@ Status RemoteDBMImpl::RemoveMulti(const std::vector<std::string_view>& keys) {
     request.add_keys(std::string(key));
   }
   RemoveMultiResponse response;
-  grpc::Status status = stub_->RemoveMulti(&context, request, &response);
+  grpc::Status status = PickStub()->RemoveMulti(&context, request, &response);
+  for (const auto& key : keys) {
+    InvalidateCache(key);
+  }
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::Append(
     std::string_view key, std::string_view value, std::string_view delim) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -440,16 +1755,18 @@ Status RemoteDBMImpl::Append(
   request.set_value(value.data(), value.size());
   request.set_delim(delim.data(), delim.size());
   AppendResponse response;
-  grpc::Status status = stub_->Append(&context, request, &response);
+  grpc::Status status = PickStub()->Append(&context, request, &response);
+  InvalidateCache(key);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::AppendMulti(
     const std::map<std::string_view, std::string_view>& records, std::string_view delim) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -465,16 +1782,20 @@ Status RemoteDBMImpl::AppendMulti(
   }
   request.set_delim(std::string(delim));
   AppendMultiResponse response;
-  grpc::Status status = stub_->AppendMulti(&context, request, &response);
+  grpc::Status status = PickStub()->AppendMulti(&context, request, &response);
+  for (const auto& record : records) {
+    InvalidateCache(record.first);
+  }
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::CompareExchange(std::string_view key, std::string_view expected,
                                       std::string_view desired) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -493,16 +1814,18 @@ Status RemoteDBMImpl::CompareExchange(std::string_view key, std::string_view exp
     request.set_desired_value(desired.data(), desired.size());
   }
   CompareExchangeResponse response;
-  grpc::Status status = stub_->CompareExchange(&context, request, &response);
+  grpc::Status status = PickStub()->CompareExchange(&context, request, &response);
+  InvalidateCache(key);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::Increment(
     std::string_view key, int64_t increment, int64_t* current, int64_t initial) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -515,10 +1838,12 @@ Status RemoteDBMImpl::Increment(
   request.set_increment(increment);
   request.set_initial(initial);
   IncrementResponse response;
-  grpc::Status status = stub_->Increment(&context, request, &response);
+  grpc::Status status = PickStub()->Increment(&context, request, &response);
+  InvalidateCache(key);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   if (current != nullptr) {
     *current = response.current();
   }
@@ -528,7 +1853,7 @@ Status RemoteDBMImpl::Increment(
 Status RemoteDBMImpl::CompareExchangeMulti(
     const std::vector<std::pair<std::string_view, std::string_view>>& expected,
     const std::vector<std::pair<std::string_view, std::string_view>>& desired) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -554,24 +1879,55 @@ Status RemoteDBMImpl::CompareExchangeMulti(
     }
   }
   CompareExchangeMultiResponse response;
-  grpc::Status status = stub_->CompareExchangeMulti(&context, request, &response);
+  grpc::Status status = PickStub()->CompareExchangeMulti(&context, request, &response);
+  for (const auto& record : desired) {
+    InvalidateCache(record.first);
+  }
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
-Status RemoteDBMImpl::Count(int64_t* count) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+Status RemoteDBMImpl::ExecuteBatch(RemoteDBMBatchImpl* batch, bool atomic) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   grpc::ClientContext context;
   context.set_deadline(std::chrono::system_clock::now() +
                        std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
+  batch->request_.set_atomic(atomic);
+  batch->response_.Clear();
+  batch->executed_ = false;
+  grpc::Status status = PickStub()->Batch(&context, batch->request_, &batch->response_);
+  if (cache_ != nullptr) {
+    for (const auto& op : batch->request_.operations()) {
+      if (op.operation() != BatchOperation::OP_GET) {
+        cache_->Remove(op.dbm_index(), op.key());
+      }
+    }
+  }
+  if (!status.ok()) {
+    return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
+  }
+  if (batch->response_.results_size() != batch->request_.operations_size()) {
+    return Status(Status::BROKEN_DATA_ERROR, "inconsistent number of results");
+  }
+  batch->executed_ = true;
+  UpdateLastTimestamp(batch->response_.timestamp());
+  return MakeStatusFromProto(batch->response_.status());
+}
+
+Status RemoteDBMImpl::Count(int64_t* count) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
   CountRequest request;
   CountResponse response;
-  grpc::Status status = stub_->Count(&context, request, &response);
+  grpc::Status status = CallRead(&DBMService::StubInterface::Count, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
@@ -582,7 +1938,7 @@ Status RemoteDBMImpl::Count(int64_t* count) {
 }
 
 Status RemoteDBMImpl::GetFileSize(int64_t* file_size) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -591,7 +1947,7 @@ Status RemoteDBMImpl::GetFileSize(int64_t* file_size) {
                        std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
   GetFileSizeRequest request;
   GetFileSizeResponse response;
-  grpc::Status status = stub_->GetFileSize(&context, request, &response);
+  grpc::Status status = PickStub()->GetFileSize(&context, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
@@ -602,7 +1958,7 @@ Status RemoteDBMImpl::GetFileSize(int64_t* file_size) {
 }
 
 Status RemoteDBMImpl::Clear() {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -611,15 +1967,19 @@ Status RemoteDBMImpl::Clear() {
                        std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
   ClearRequest request;
   ClearResponse response;
-  grpc::Status status = stub_->Clear(&context, request, &response);
+  grpc::Status status = PickStub()->Clear(&context, request, &response);
+  if (cache_ != nullptr) {
+    cache_->Clear(dbm_index_);
+  }
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
+  UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMImpl::Rebuild(const std::map<std::string, std::string>& params) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -633,7 +1993,7 @@ Status RemoteDBMImpl::Rebuild(const std::map<std::string, std::string>& params)
     req_param->set_second(param.second);
   }
   RebuildResponse response;
-  grpc::Status status = stub_->Rebuild(&context, request, &response);
+  grpc::Status status = PickStub()->Rebuild(&context, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
@@ -641,7 +2001,7 @@ Status RemoteDBMImpl::Rebuild(const std::map<std::string, std::string>& params)
 }
 
 Status RemoteDBMImpl::ShouldBeRebuilt(bool* tobe) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -650,7 +2010,7 @@ Status RemoteDBMImpl::ShouldBeRebuilt(bool* tobe) {
                        std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
   ShouldBeRebuiltRequest request;
   ShouldBeRebuiltResponse response;
-  grpc::Status status = stub_->ShouldBeRebuilt(&context, request, &response);
+  grpc::Status status = PickStub()->ShouldBeRebuilt(&context, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
@@ -661,7 +2021,7 @@ Status RemoteDBMImpl::ShouldBeRebuilt(bool* tobe) {
 }
 
 Status RemoteDBMImpl::Synchronize(bool hard, const std::map<std::string, std::string>& params) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -676,7 +2036,7 @@ Status RemoteDBMImpl::Synchronize(bool hard, const std::map<std::string, std::st
     req_param->set_second(param.second);
   }
   SynchronizeResponse response;
-  grpc::Status status = stub_->Synchronize(&context, request, &response);
+  grpc::Status status = PickStub()->Synchronize(&context, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
@@ -685,19 +2045,16 @@ Status RemoteDBMImpl::Synchronize(bool hard, const std::map<std::string, std::st
 
 Status RemoteDBMImpl::SearchModal(std::string_view mode, std::string_view pattern,
                                   std::vector<std::string>* matched, size_t capacity) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
-  grpc::ClientContext context;
-  context.set_deadline(std::chrono::system_clock::now() +
-                       std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
   SearchModalRequest request;
   request.set_mode(std::string(mode));
   request.set_pattern(pattern.data(), pattern.size());
   request.set_capacity(capacity);
   SearchModalResponse response;
-  grpc::Status status = stub_->SearchModal(&context, request, &response);
+  grpc::Status status = CallRead(&DBMService::StubInterface::SearchModal, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
@@ -709,7 +2066,7 @@ Status RemoteDBMImpl::SearchModal(std::string_view mode, std::string_view patter
 }
 
 Status RemoteDBMImpl::ChangeMaster(std::string_view master, double timestamp_skew) {
-  std::shared_lock<SpinSharedMutex> lock(mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
   if (stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -720,51 +2077,425 @@ Status RemoteDBMImpl::ChangeMaster(std::string_view master, double timestamp_ske
   request.set_master(std::string(master));
   request.set_timestamp_skew(timestamp_skew);
   ChangeMasterResponse response;
-  grpc::Status status = stub_->ChangeMaster(&context, request, &response);
+  grpc::Status status = PickStub()->ChangeMaster(&context, request, &response);
   if (!status.ok()) {
     return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
   }
   return MakeStatusFromProto(response.status());
 }
 
+Status RemoteDBMImpl::SetAsyncThreads(int32_t num_threads) {
+  if (num_threads < 1) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "invalid number of threads");
+  }
+  std::lock_guard<std::mutex> lock(async_mutex_);
+  num_async_threads_ = num_threads;
+  return Status(Status::SUCCESS);
+}
+
+void RemoteDBMImpl::DriveAsyncCalls(grpc::CompletionQueue* queue) {
+  void* tag = nullptr;
+  bool ok = false;
+  while (queue->Next(&tag, &ok)) {
+    auto* call = static_cast<RemoteDBMAsyncCall*>(tag);
+    call->Finish();
+    {
+      std::lock_guard<std::mutex> lock(async_mutex_);
+      async_calls_.erase(call);
+    }
+    delete call;
+  }
+}
+
+void RemoteDBMImpl::StopAsyncThreads() {
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    if (async_threads_.empty()) {
+      return;
+    }
+    async_stopping_ = true;
+    for (auto* call : async_calls_) {
+      call->context.TryCancel();
+    }
+    async_queue_->Shutdown();
+    threads.swap(async_threads_);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::lock_guard<std::mutex> lock(async_mutex_);
+  async_queue_.reset(nullptr);
+  async_stopping_ = false;
+}
+
+template <typename REQUEST, typename RESPONSE>
+void RemoteDBMImpl::CallAsync(
+    DBMService::StubInterface* stub, RemoteDBMAsyncMethod<REQUEST, RESPONSE> call,
+    const REQUEST& request, typename RemoteDBMAsyncCallImpl<RESPONSE>::Handler handler) {
+  std::unique_lock<std::mutex> lock(async_mutex_);
+  if (async_stopping_) {
+    lock.unlock();
+    RESPONSE response;
+    handler(grpc::Status(grpc::StatusCode::CANCELLED, "disconnected"), &response);
+    return;
+  }
+  if (async_threads_.empty()) {
+    async_queue_ = std::make_unique<grpc::CompletionQueue>();
+    grpc::CompletionQueue* queue = async_queue_.get();
+    for (int32_t i = 0; i < num_async_threads_; i++) {
+      async_threads_.emplace_back([this, queue]{ DriveAsyncCalls(queue); });
+    }
+  }
+  auto* async_call = new RemoteDBMAsyncCallImpl<RESPONSE>(std::move(handler));
+  async_call->context.set_deadline(
+      std::chrono::system_clock::now() +
+      std::chrono::microseconds(static_cast<int64_t>(timeout_ * 1000000)));
+  async_calls_.emplace(async_call);
+  async_call->reader = (stub->*call)(&async_call->context, request, async_queue_.get());
+  async_call->reader->Finish(&async_call->response, &async_call->status, async_call);
+}
+
+template <typename REQUEST, typename RESPONSE>
+void RemoteDBMImpl::CallReadAsync(
+    RemoteDBMAsyncMethod<REQUEST, RESPONSE> call, const REQUEST& request,
+    typename RemoteDBMAsyncCallImpl<RESPONSE>::Handler handler) {
+  RemoteDBMReplica* replica = nullptr;
+  DBMService::StubInterface* stub = AcquireReadStub(&replica);
+  if (replica == nullptr) {
+    CallAsync(stub, call, request, std::move(handler));
+    return;
+  }
+  auto fallback = [this, replica, call, request, handler](
+      const grpc::Status& status, RESPONSE* response) {
+    ReleaseReadStub(replica);
+    if (status.ok() && response->status().code() != Status::INFEASIBLE_ERROR) {
+      handler(status, response);
+      return;
+    }
+    if (!status.ok()) {
+      replica->healthy.store(false);
+    }
+    std::shared_lock<SlottedSharedMutex> lock(mutex_);
+    if (stub_ == nullptr) {
+      lock.unlock();
+      handler(status, response);
+      return;
+    }
+    CallAsync(PickStub(), call, request, handler);
+  };
+  CallAsync(stub, call, request, std::move(fallback));
+}
+
+void RemoteDBMImpl::GetAsync(
+    std::string_view key, std::function<void(const Status&, const std::string&)> callback) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    lock.unlock();
+    callback(Status(Status::PRECONDITION_ERROR, "not connected database"), "");
+    return;
+  }
+  GetRequest request;
+  request.set_dbm_index(dbm_index_);
+  request.set_key(key.data(), key.size());
+  request.set_min_timestamp(min_timestamp_);
+  CallReadAsync<GetRequest, GetResponse>(
+      &DBMService::StubInterface::AsyncGet, request,
+      [callback](const grpc::Status& status, GetResponse* response) {
+        if (!status.ok()) {
+          callback(Status(Status::NETWORK_ERROR, GRPCStatusString(status)), "");
+          return;
+        }
+        callback(MakeStatusFromProto(response->status()), response->value());
+      });
+}
+
+void RemoteDBMImpl::GetMultiAsync(
+    const std::vector<std::string_view>& keys,
+    std::function<void(const Status&, const std::map<std::string, std::string>&)> callback) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    lock.unlock();
+    callback(Status(Status::PRECONDITION_ERROR, "not connected database"), {});
+    return;
+  }
+  GetMultiRequest request;
+  request.set_dbm_index(dbm_index_);
+  for (const auto& key : keys) {
+    request.add_keys(std::string(key));
+  }
+  request.set_min_timestamp(min_timestamp_);
+  CallReadAsync<GetMultiRequest, GetMultiResponse>(
+      &DBMService::StubInterface::AsyncGetMulti, request,
+      [callback](const grpc::Status& status, GetMultiResponse* response) {
+        std::map<std::string, std::string> records;
+        if (!status.ok()) {
+          callback(Status(Status::NETWORK_ERROR, GRPCStatusString(status)), records);
+          return;
+        }
+        for (const auto& record : response->records()) {
+          records.emplace(std::make_pair(record.first(), record.second()));
+        }
+        callback(MakeStatusFromProto(response->status()), records);
+      });
+}
+
+void RemoteDBMImpl::SetAsync(std::string_view key, std::string_view value, bool overwrite,
+                             std::function<void(const Status&)> callback) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    lock.unlock();
+    callback(Status(Status::PRECONDITION_ERROR, "not connected database"));
+    return;
+  }
+  SetRequest request;
+  request.set_dbm_index(dbm_index_);
+  request.set_key(key.data(), key.size());
+  request.set_value(value.data(), value.size());
+  request.set_overwrite(overwrite);
+  RemoteDBMCache* cache = cache_.get();
+  const int32_t dbm_index = dbm_index_;
+  CallAsync<SetRequest, SetResponse>(
+      PickStub(), &DBMService::StubInterface::AsyncSet, request,
+      [this, callback, cache, dbm_index, key = std::string(key)](
+          const grpc::Status& status, SetResponse* response) {
+        if (cache != nullptr) {
+          cache->Remove(dbm_index, key);
+        }
+        if (!status.ok()) {
+          callback(Status(Status::NETWORK_ERROR, GRPCStatusString(status)));
+          return;
+        }
+        UpdateLastTimestamp(response->timestamp());
+        callback(MakeStatusFromProto(response->status()));
+      });
+}
+
+void RemoteDBMImpl::SetMultiAsync(
+    const std::map<std::string_view, std::string_view>& records, bool overwrite,
+    std::function<void(const Status&)> callback) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    lock.unlock();
+    callback(Status(Status::PRECONDITION_ERROR, "not connected database"));
+    return;
+  }
+  SetMultiRequest request;
+  request.set_dbm_index(dbm_index_);
+  std::vector<std::string> keys;
+  keys.reserve(records.size());
+  for (const auto& record : records) {
+    auto* req_record = request.add_records();
+    req_record->set_first(std::string(record.first));
+    req_record->set_second(std::string(record.second));
+    keys.emplace_back(record.first);
+  }
+  request.set_overwrite(overwrite);
+  RemoteDBMCache* cache = cache_.get();
+  const int32_t dbm_index = dbm_index_;
+  CallAsync<SetMultiRequest, SetMultiResponse>(
+      PickStub(), &DBMService::StubInterface::AsyncSetMulti, request,
+      [this, callback, cache, dbm_index, keys = std::move(keys)](
+          const grpc::Status& status, SetMultiResponse* response) {
+        if (cache != nullptr) {
+          for (const auto& key : keys) {
+            cache->Remove(dbm_index, key);
+          }
+        }
+        if (!status.ok()) {
+          callback(Status(Status::NETWORK_ERROR, GRPCStatusString(status)));
+          return;
+        }
+        UpdateLastTimestamp(response->timestamp());
+        callback(MakeStatusFromProto(response->status()));
+      });
+}
+
+void RemoteDBMImpl::RemoveAsync(
+    std::string_view key, std::function<void(const Status&)> callback) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    lock.unlock();
+    callback(Status(Status::PRECONDITION_ERROR, "not connected database"));
+    return;
+  }
+  RemoveRequest request;
+  request.set_dbm_index(dbm_index_);
+  request.set_key(key.data(), key.size());
+  RemoteDBMCache* cache = cache_.get();
+  const int32_t dbm_index = dbm_index_;
+  CallAsync<RemoveRequest, RemoveResponse>(
+      PickStub(), &DBMService::StubInterface::AsyncRemove, request,
+      [this, callback, cache, dbm_index, key = std::string(key)](
+          const grpc::Status& status, RemoveResponse* response) {
+        if (cache != nullptr) {
+          cache->Remove(dbm_index, key);
+        }
+        if (!status.ok()) {
+          callback(Status(Status::NETWORK_ERROR, GRPCStatusString(status)));
+          return;
+        }
+        UpdateLastTimestamp(response->timestamp());
+        callback(MakeStatusFromProto(response->status()));
+      });
+}
+
+void RemoteDBMImpl::RemoveMultiAsync(
+    const std::vector<std::string_view>& keys, std::function<void(const Status&)> callback) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    lock.unlock();
+    callback(Status(Status::PRECONDITION_ERROR, "not connected database"));
+    return;
+  }
+  RemoveMultiRequest request;
+  request.set_dbm_index(dbm_index_);
+  std::vector<std::string> key_strs;
+  key_strs.reserve(keys.size());
+  for (const auto& key : keys) {
+    request.add_keys(std::string(key));
+    key_strs.emplace_back(key);
+  }
+  RemoteDBMCache* cache = cache_.get();
+  const int32_t dbm_index = dbm_index_;
+  CallAsync<RemoveMultiRequest, RemoveMultiResponse>(
+      PickStub(), &DBMService::StubInterface::AsyncRemoveMulti, request,
+      [this, callback, cache, dbm_index, keys = std::move(key_strs)](
+          const grpc::Status& status, RemoveMultiResponse* response) {
+        if (cache != nullptr) {
+          for (const auto& key : keys) {
+            cache->Remove(dbm_index, key);
+          }
+        }
+        if (!status.ok()) {
+          callback(Status(Status::NETWORK_ERROR, GRPCStatusString(status)));
+          return;
+        }
+        UpdateLastTimestamp(response->timestamp());
+        callback(MakeStatusFromProto(response->status()));
+      });
+}
+
+void RemoteDBMImpl::AppendMultiAsync(
+    const std::map<std::string_view, std::string_view>& records, std::string_view delim,
+    std::function<void(const Status&)> callback) {
+  std::shared_lock<SlottedSharedMutex> lock(mutex_);
+  if (stub_ == nullptr) {
+    lock.unlock();
+    callback(Status(Status::PRECONDITION_ERROR, "not connected database"));
+    return;
+  }
+  AppendMultiRequest request;
+  request.set_dbm_index(dbm_index_);
+  std::vector<std::string> keys;
+  keys.reserve(records.size());
+  for (const auto& record : records) {
+    auto* req_record = request.add_records();
+    req_record->set_first(std::string(record.first));
+    req_record->set_second(std::string(record.second));
+    keys.emplace_back(record.first);
+  }
+  request.set_delim(std::string(delim));
+  RemoteDBMCache* cache = cache_.get();
+  const int32_t dbm_index = dbm_index_;
+  CallAsync<AppendMultiRequest, AppendMultiResponse>(
+      PickStub(), &DBMService::StubInterface::AsyncAppendMulti, request,
+      [this, callback, cache, dbm_index, keys = std::move(keys)](
+          const grpc::Status& status, AppendMultiResponse* response) {
+        if (cache != nullptr) {
+          for (const auto& key : keys) {
+            cache->Remove(dbm_index, key);
+          }
+        }
+        if (!status.ok()) {
+          callback(Status(Status::NETWORK_ERROR, GRPCStatusString(status)));
+          return;
+        }
+        UpdateLastTimestamp(response->timestamp());
+        callback(MakeStatusFromProto(response->status()));
+      });
+}
+
 RemoteDBMStreamImpl::RemoteDBMStreamImpl(RemoteDBMImpl* dbm)
-    : dbm_(dbm), context_(), stream_(nullptr), healthy_(true) {
+    : dbm_(dbm), context_(std::make_unique<grpc::ClientContext>()), stream_(nullptr),
+      healthy_(true), cancelled_(false), context_mutex_() {
   {
-    std::lock_guard<SpinSharedMutex> lock(dbm_->mutex_);
+    std::lock_guard<SlottedSharedMutex> lock(dbm_->mutex_);
     dbm_->streams_.emplace_back(this);
   }
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
-  stream_ = dbm_->stub_->Stream(&context_);
+  stream_ = dbm_->PickStub()->Stream(context_.get());
 }
 
 RemoteDBMStreamImpl::~RemoteDBMStreamImpl() {
   if (dbm_ != nullptr) {
     if (healthy_.load()) {
-      std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+      std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
       stream_->WritesDone();
       stream_->Finish();
     }
-    std::lock_guard<SpinSharedMutex> lock(dbm_->mutex_);
+    std::lock_guard<SlottedSharedMutex> lock(dbm_->mutex_);
     dbm_->streams_.remove(this);
   }
 }
 
 void RemoteDBMStreamImpl::Cancel() {
   healthy_.store(false);
-  context_.TryCancel();
+  cancelled_.store(true);
+  std::lock_guard<std::mutex> lock(context_mutex_);
+  context_->TryCancel();
+}
+
+bool RemoteDBMStreamImpl::ResetStream() {
+  std::lock_guard<std::mutex> lock(context_mutex_);
+  if (cancelled_.load()) {
+    return false;
+  }
+  stream_.reset(nullptr);
+  context_ = std::make_unique<grpc::ClientContext>();
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+      static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  stream_ = dbm_->PickStub()->Stream(context_.get());
+  return true;
+}
+
+Status RemoteDBMStreamImpl::Reconnect() {
+  if (cancelled_.load() || !dbm_->CanReconnect()) {
+    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+  }
+  for (int32_t num_attempts = 1; num_attempts <= dbm_->reconnect_max_attempts_; num_attempts++) {
+    if (!dbm_->WaitReconnectBackoff(num_attempts) || !ResetStream()) {
+      break;
+    }
+    // An echo confirms that the new stream is established.
+    StreamRequest stream_request;
+    stream_request.mutable_echo_request();
+    StreamResponse stream_response;
+    if (stream_->Write(stream_request) && stream_->Read(&stream_response)) {
+      healthy_.store(true);
+      dbm_->reconnect_num_successes_.fetch_add(1);
+      return Status(Status::SUCCESS);
+    }
+    stream_->Finish();
+  }
+  dbm_->reconnect_num_failures_.fetch_add(1);
+  return Status(Status::NETWORK_ERROR, "reconnection failed");
 }
 
 Status RemoteDBMStreamImpl::Echo(std::string_view message, std::string* echo) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   StreamRequest stream_request;
   auto* request = stream_request.mutable_echo_request();
@@ -786,14 +2517,17 @@ Status RemoteDBMStreamImpl::Echo(std::string_view message, std::string* echo) {
 }
 
 Status RemoteDBMStreamImpl::Get(std::string_view key, std::string* value) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   StreamRequest stream_request;
   auto* request = stream_request.mutable_get_request();
@@ -802,6 +2536,7 @@ Status RemoteDBMStreamImpl::Get(std::string_view key, std::string* value) {
   if (value == nullptr) {
     request->set_omit_value(true);
   }
+  request->set_min_timestamp(dbm_->min_timestamp_);
   if (!stream_->Write(stream_request)) {
     healthy_.store(false);
     const std::string message = GRPCStatusString(stream_->Finish());
@@ -824,14 +2559,17 @@ Status RemoteDBMStreamImpl::Get(std::string_view key, std::string* value) {
 
 Status RemoteDBMStreamImpl::Set(std::string_view key, std::string_view value,
                                 bool overwrite, bool ignore_result) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   StreamRequest stream_request;
   auto* request = stream_request.mutable_set_request();
@@ -848,6 +2586,7 @@ Status RemoteDBMStreamImpl::Set(std::string_view key, std::string_view value,
     return Status(Status::NETWORK_ERROR, StrCat("Write failed: ", message));
   }
   if (ignore_result) {
+    dbm_->InvalidateCache(key);
     return Status(Status::SUCCESS);
   }
   StreamResponse stream_response;
@@ -856,19 +2595,24 @@ Status RemoteDBMStreamImpl::Set(std::string_view key, std::string_view value,
     const std::string message = GRPCStatusString(stream_->Finish());
     return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
   }
+  dbm_->InvalidateCache(key);
   const SetResponse& response = stream_response.set_response();
+  dbm_->UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMStreamImpl::Remove(std::string_view key, bool ignore_result) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   StreamRequest stream_request;
   auto* request = stream_request.mutable_remove_request();
@@ -883,6 +2627,7 @@ Status RemoteDBMStreamImpl::Remove(std::string_view key, bool ignore_result) {
     return Status(Status::NETWORK_ERROR, StrCat("Write failed: ", message));
   }
   if (ignore_result) {
+    dbm_->InvalidateCache(key);
     return Status(Status::SUCCESS);
   }
   StreamResponse stream_response;
@@ -891,20 +2636,25 @@ Status RemoteDBMStreamImpl::Remove(std::string_view key, bool ignore_result) {
     const std::string message = GRPCStatusString(stream_->Finish());
     return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
   }
+  dbm_->InvalidateCache(key);
   const RemoveResponse& response = stream_response.remove_response();
+  dbm_->UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMStreamImpl::Append(
     std::string_view key, std::string_view value, std::string_view delim, bool ignore_result) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   StreamRequest stream_request;
   auto* request = stream_request.mutable_append_request();
@@ -921,6 +2671,7 @@ Status RemoteDBMStreamImpl::Append(
     return Status(Status::NETWORK_ERROR, StrCat("Write failed: ", message));
   }
   if (ignore_result) {
+    dbm_->InvalidateCache(key);
     return Status(Status::SUCCESS);
   }
   StreamResponse stream_response;
@@ -929,20 +2680,25 @@ Status RemoteDBMStreamImpl::Append(
     const std::string message = GRPCStatusString(stream_->Finish());
     return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
   }
+  dbm_->InvalidateCache(key);
   const AppendResponse& response = stream_response.append_response();
+  dbm_->UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMStreamImpl::CompareExchange(
     std::string_view key, std::string_view expected, std::string_view desired) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   StreamRequest stream_request;
   auto* request = stream_request.mutable_compare_exchange_request();
@@ -967,21 +2723,26 @@ Status RemoteDBMStreamImpl::CompareExchange(
     const std::string message = GRPCStatusString(stream_->Finish());
     return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
   }
+  dbm_->InvalidateCache(key);
   const CompareExchangeResponse& response = stream_response.compare_exchange_response();
+  dbm_->UpdateLastTimestamp(response.timestamp());
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMStreamImpl::Increment(
     std::string_view key, int64_t increment,
     int64_t* current, int64_t initial, bool ignore_result) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   StreamRequest stream_request;
   auto* request = stream_request.mutable_increment_request();
@@ -995,6 +2756,7 @@ Status RemoteDBMStreamImpl::Increment(
     return Status(Status::NETWORK_ERROR, StrCat("Write failed: ", message));
   }
   if (ignore_result) {
+    dbm_->InvalidateCache(key);
     return Status(Status::SUCCESS);
   }
   StreamResponse stream_response;
@@ -1003,7 +2765,9 @@ Status RemoteDBMStreamImpl::Increment(
     const std::string message = GRPCStatusString(stream_->Finish());
     return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
   }
+  dbm_->InvalidateCache(key);
   const IncrementResponse& response = stream_response.increment_response();
+  dbm_->UpdateLastTimestamp(response.timestamp());
   if (current != nullptr) {
     *current = response.current();
   }
@@ -1011,47 +2775,62 @@ Status RemoteDBMStreamImpl::Increment(
 }
 
 RemoteDBMIteratorImpl::RemoteDBMIteratorImpl(RemoteDBMImpl* dbm)
-    : dbm_(dbm), context_(), stream_(nullptr), healthy_(true) {
+    : dbm_(dbm), context_(std::make_unique<grpc::ClientContext>()), stream_(nullptr),
+      healthy_(true), cancelled_(false), context_mutex_(), resume_request_(),
+      resume_steps_(0), prefetch_size_(0),
+      prefetched_(), num_inflight_(0), current_(), has_current_(false), at_end_(false) {
   {
-    std::lock_guard<SpinSharedMutex> lock(dbm_->mutex_);
+    std::lock_guard<SlottedSharedMutex> lock(dbm_->mutex_);
     dbm_->iterators_.emplace_back(this);
   }
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
+  prefetch_size_ = dbm_->iterator_prefetch_;
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
-  stream_ = dbm_->stub_->Iterate(&context_);
+  stream_ = dbm_->PickStub()->Iterate(context_.get());
 }
 
 RemoteDBMIteratorImpl::~RemoteDBMIteratorImpl() {
   if (dbm_ != nullptr) {
     if (healthy_.load()) {
-      std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+      std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
+      DiscardPrefetch(false);
       stream_->WritesDone();
       stream_->Finish();
     }
-    std::lock_guard<SpinSharedMutex> lock(dbm_->mutex_);
+    std::lock_guard<SlottedSharedMutex> lock(dbm_->mutex_);
     dbm_->iterators_.remove(this);
   }
 }
 
 void RemoteDBMIteratorImpl::Cancel() {
   healthy_.store(false);
-  context_.TryCancel();
+  cancelled_.store(true);
+  std::lock_guard<std::mutex> lock(context_mutex_);
+  context_->TryCancel();
 }
 
 Status RemoteDBMIteratorImpl::First() {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  const Status prefetch_status = DiscardPrefetch(false);
+  if (prefetch_status != Status::SUCCESS) {
+    return prefetch_status;
+  }
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_FIRST);
+  SetResumePoint(request);
   if (!stream_->Write(request)) {
     healthy_.store(false);
     const std::string message = GRPCStatusString(stream_->Finish());
@@ -1067,18 +2846,26 @@ Status RemoteDBMIteratorImpl::First() {
 }
 
 Status RemoteDBMIteratorImpl::Last() {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  const Status prefetch_status = DiscardPrefetch(false);
+  if (prefetch_status != Status::SUCCESS) {
+    return prefetch_status;
+  }
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_LAST);
+  SetResumePoint(request);
   if (!stream_->Write(request)) {
     healthy_.store(false);
     const std::string message = GRPCStatusString(stream_->Finish());
@@ -1094,19 +2881,27 @@ Status RemoteDBMIteratorImpl::Last() {
 }
 
 Status RemoteDBMIteratorImpl::Jump(std::string_view key) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  const Status prefetch_status = DiscardPrefetch(false);
+  if (prefetch_status != Status::SUCCESS) {
+    return prefetch_status;
+  }
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_JUMP);
   request.set_key(std::string(key));
+  SetResumePoint(request);
   if (!stream_->Write(request)) {
     healthy_.store(false);
     const std::string message = GRPCStatusString(stream_->Finish());
@@ -1122,19 +2917,28 @@ Status RemoteDBMIteratorImpl::Jump(std::string_view key) {
 }
 
 Status RemoteDBMIteratorImpl::JumpLower(std::string_view key, bool inclusive) {
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  const Status prefetch_status = DiscardPrefetch(false);
+  if (prefetch_status != Status::SUCCESS) {
+    return prefetch_status;
+  }
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_JUMP_LOWER);
   request.set_key(std::string(key));
   request.set_jump_inclusive(inclusive);
+  SetResumePoint(request);
   if (!stream_->Write(request)) {
     healthy_.store(false);
     const std::string message = GRPCStatusString(stream_->Finish());
@@ -1150,19 +2954,28 @@ Status RemoteDBMIteratorImpl::JumpLower(std::string_view key, bool inclusive) {
 }
 
 Status RemoteDBMIteratorImpl::JumpUpper(std::string_view key, bool inclusive) {
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  const Status prefetch_status = DiscardPrefetch(false);
+  if (prefetch_status != Status::SUCCESS) {
+    return prefetch_status;
+  }
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_JUMP_UPPER);
   request.set_key(std::string(key));
   request.set_jump_inclusive(inclusive);
+  SetResumePoint(request);
   if (!stream_->Write(request)) {
     healthy_.store(false);
     const std::string message = GRPCStatusString(stream_->Finish());
@@ -1178,18 +2991,27 @@ Status RemoteDBMIteratorImpl::JumpUpper(std::string_view key, bool inclusive) {
 }
 
 Status RemoteDBMIteratorImpl::Next() {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  if (prefetch_size_ > 0 &&
+      (!at_end_ || !prefetched_.empty() || num_inflight_ > 0)) {
+    return NextPrefetched();
+  }
+  has_current_ = false;
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_NEXT);
+  resume_steps_++;
   if (!stream_->Write(request)) {
     healthy_.store(false);
     const std::string message = GRPCStatusString(stream_->Finish());
@@ -1205,18 +3027,26 @@ Status RemoteDBMIteratorImpl::Next() {
 }
 
 Status RemoteDBMIteratorImpl::Previous() {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  const Status prefetch_status = DiscardPrefetch(true);
+  if (prefetch_status != Status::SUCCESS) {
+    return prefetch_status;
+  }
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_PREVIOUS);
+  resume_steps_--;
   if (!stream_->Write(request)) {
     healthy_.store(false);
     const std::string message = GRPCStatusString(stream_->Finish());
@@ -1232,14 +3062,28 @@ Status RemoteDBMIteratorImpl::Previous() {
 }
 
 Status RemoteDBMIteratorImpl::Get(std::string* key, std::string* value) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
+  }
+  if (has_current_) {
+    if (current_.get_status == Status::SUCCESS) {
+      if (key != nullptr) {
+        *key = current_.key;
+      }
+      if (value != nullptr) {
+        *value = current_.value;
+      }
+    }
+    return current_.get_status;
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
@@ -1264,6 +3108,7 @@ Status RemoteDBMIteratorImpl::Get(std::string* key, std::string* value) {
   if (response.status().code() == 0) {
     if (key != nullptr) {
       *key = response.key();
+      SetResumeKey(response.key());
     }
     if (value != nullptr) {
       *value = response.value();
@@ -1273,15 +3118,22 @@ Status RemoteDBMIteratorImpl::Get(std::string* key, std::string* value) {
 }
 
 Status RemoteDBMIteratorImpl::Set(std::string_view value) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  const Status prefetch_status = DiscardPrefetch(true);
+  if (prefetch_status != Status::SUCCESS) {
+    return prefetch_status;
+  }
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_SET);
@@ -1297,19 +3149,29 @@ Status RemoteDBMIteratorImpl::Set(std::string_view value) {
     const std::string message = GRPCStatusString(stream_->Finish());
     return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
   }
+  if (response.status().code() == 0) {
+    dbm_->InvalidateCache(response.key());
+  }
   return MakeStatusFromProto(response.status());
 }
 
 Status RemoteDBMIteratorImpl::Remove() {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
       static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  const Status prefetch_status = DiscardPrefetch(true);
+  if (prefetch_status != Status::SUCCESS) {
+    return prefetch_status;
+  }
   IterateRequest request;
   request.set_dbm_index(dbm_->dbm_index_);
   request.set_operation(IterateRequest::OP_REMOVE);
@@ -1324,30 +3186,228 @@ Status RemoteDBMIteratorImpl::Remove() {
     const std::string message = GRPCStatusString(stream_->Finish());
     return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
   }
+  if (response.status().code() == 0) {
+    dbm_->InvalidateCache(response.key());
+  }
   return MakeStatusFromProto(response.status());
 }
 
+void RemoteDBMIteratorImpl::SetResumePoint(const IterateRequest& request) {
+  resume_request_ = request;
+  resume_steps_ = 0;
+}
+
+void RemoteDBMIteratorImpl::SetResumeKey(std::string_view key) {
+  resume_request_.Clear();
+  resume_request_.set_operation(IterateRequest::OP_JUMP);
+  resume_request_.set_key(key.data(), key.size());
+  resume_steps_ = 0;
+}
+
+bool RemoteDBMIteratorImpl::ResetStream() {
+  std::lock_guard<std::mutex> lock(context_mutex_);
+  if (cancelled_.load()) {
+    return false;
+  }
+  stream_.reset(nullptr);
+  context_ = std::make_unique<grpc::ClientContext>();
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+      static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  stream_ = dbm_->PickStub()->Iterate(context_.get());
+  return true;
+}
+
+Status RemoteDBMIteratorImpl::Reconnect() {
+  if (cancelled_.load() || !dbm_->CanReconnect()) {
+    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+  }
+  prefetched_.clear();
+  num_inflight_ = 0;
+  for (int32_t num_attempts = 1; num_attempts <= dbm_->reconnect_max_attempts_; num_attempts++) {
+    if (!dbm_->WaitReconnectBackoff(num_attempts) || !ResetStream()) {
+      break;
+    }
+    // The position is restored by the last positioning operation and the following steps.
+    std::vector<IterateRequest> requests;
+    if (resume_request_.operation() != IterateRequest::OP_NONE) {
+      requests.emplace_back(resume_request_);
+      requests.back().set_dbm_index(dbm_->dbm_index_);
+    }
+    IterateRequest step_request;
+    step_request.set_dbm_index(dbm_->dbm_index_);
+    step_request.set_operation(
+        resume_steps_ >= 0 ? IterateRequest::OP_NEXT : IterateRequest::OP_PREVIOUS);
+    for (int32_t i = 0; i < std::abs(resume_steps_); i++) {
+      requests.emplace_back(step_request);
+    }
+    if (requests.empty()) {
+      IterateRequest noop_request;
+      noop_request.set_dbm_index(dbm_->dbm_index_);
+      requests.emplace_back(noop_request);
+    }
+    bool ok = true;
+    for (const auto& request : requests) {
+      IterateResponse response;
+      if (!stream_->Write(request) || !stream_->Read(&response)) {
+        ok = false;
+        break;
+      }
+    }
+    if (ok) {
+      healthy_.store(true);
+      dbm_->reconnect_num_successes_.fetch_add(1);
+      return Status(Status::SUCCESS);
+    }
+    stream_->Finish();
+  }
+  dbm_->reconnect_num_failures_.fetch_add(1);
+  return Status(Status::NETWORK_ERROR, "reconnection failed");
+}
+
+Status RemoteDBMIteratorImpl::WriteRequest(const IterateRequest& request) {
+  if (!stream_->Write(request)) {
+    healthy_.store(false);
+    const std::string message = GRPCStatusString(stream_->Finish());
+    return Status(Status::NETWORK_ERROR, StrCat("Write failed: ", message));
+  }
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMIteratorImpl::ReadResponse(IterateResponse* response) {
+  if (!stream_->Read(response)) {
+    healthy_.store(false);
+    const std::string message = GRPCStatusString(stream_->Finish());
+    return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
+  }
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMIteratorImpl::SendPrefetch() {
+  // The requests are pipelined on the stream so that the responses arrive before they are used.
+  IterateRequest request;
+  request.set_dbm_index(dbm_->dbm_index_);
+  request.set_operation(IterateRequest::OP_NEXT);
+  Status status = WriteRequest(request);
+  if (status != Status::SUCCESS) {
+    return status;
+  }
+  request.set_operation(IterateRequest::OP_GET);
+  status = WriteRequest(request);
+  if (status != Status::SUCCESS) {
+    return status;
+  }
+  num_inflight_++;
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMIteratorImpl::ReceivePrefetch() {
+  IterateResponse next_response;
+  Status status = ReadResponse(&next_response);
+  if (status != Status::SUCCESS) {
+    return status;
+  }
+  IterateResponse get_response;
+  status = ReadResponse(&get_response);
+  if (status != Status::SUCCESS) {
+    return status;
+  }
+  num_inflight_--;
+  Prefetched record;
+  record.next_status = MakeStatusFromProto(next_response.status());
+  record.get_status = MakeStatusFromProto(get_response.status());
+  if (record.get_status == Status::SUCCESS) {
+    record.key = get_response.key();
+    record.value = get_response.value();
+  } else {
+    at_end_ = true;
+  }
+  prefetched_.emplace_back(std::move(record));
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMIteratorImpl::DiscardPrefetch(bool restore) {
+  const bool ahead = !prefetched_.empty() || num_inflight_ > 0;
+  while (num_inflight_ > 0) {
+    const Status status = ReceivePrefetch();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
+  }
+  prefetched_.clear();
+  // The cursor on the server is ahead of the current record, so it is moved back.
+  if (restore && ahead && has_current_ && current_.get_status == Status::SUCCESS) {
+    IterateRequest request;
+    request.set_dbm_index(dbm_->dbm_index_);
+    request.set_operation(IterateRequest::OP_JUMP);
+    request.set_key(current_.key);
+    Status status = WriteRequest(request);
+    if (status != Status::SUCCESS) {
+      return status;
+    }
+    IterateResponse response;
+    status = ReadResponse(&response);
+    if (status != Status::SUCCESS) {
+      return status;
+    }
+  }
+  has_current_ = false;
+  at_end_ = false;
+  return Status(Status::SUCCESS);
+}
+
+Status RemoteDBMIteratorImpl::NextPrefetched() {
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+      static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  while (!at_end_ && static_cast<int32_t>(prefetched_.size()) + num_inflight_ < prefetch_size_) {
+    const Status status = SendPrefetch();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
+  }
+  if (prefetched_.empty()) {
+    const Status status = ReceivePrefetch();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
+  }
+  current_ = std::move(prefetched_.front());
+  prefetched_.pop_front();
+  has_current_ = true;
+  if (current_.get_status == Status::SUCCESS) {
+    SetResumeKey(current_.key);
+  } else {
+    resume_steps_++;
+  }
+  return current_.next_status;
+}
+
 RemoteDBMReplicatorImpl::RemoteDBMReplicatorImpl(RemoteDBMImpl* dbm)
-    : dbm_(dbm), context_(), stream_(nullptr), healthy_(true), server_id_(-1) {
+    : dbm_(dbm), context_(std::make_unique<grpc::ClientContext>()), stream_(nullptr),
+      healthy_(true), cancelled_(false), context_mutex_(), server_id_(-1),
+      client_server_id_(0), stream_timeout_(0), start_request_(), last_timestamp_(-1),
+      origin_timestamp_(-1), session_id_(0), sequence_(0) {
   if (healthy_.load()) {
-    std::lock_guard<SpinSharedMutex> lock(dbm_->mutex_);
+    std::lock_guard<SlottedSharedMutex> lock(dbm_->mutex_);
     dbm_->replicators_.emplace_back(this);
   }
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
-      static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
+  stream_timeout_ = dbm_->timeout_;
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+      static_cast<int64_t>(stream_timeout_ * 1000000)));
 }
 
 RemoteDBMReplicatorImpl::~RemoteDBMReplicatorImpl() {
   if (dbm_ != nullptr) {
-    std::lock_guard<SpinSharedMutex> lock(dbm_->mutex_);
+    std::lock_guard<SlottedSharedMutex> lock(dbm_->mutex_);
     dbm_->replicators_.remove(this);
   }
 }
 
 void RemoteDBMReplicatorImpl::Cancel() {
   healthy_.store(false);
-  context_.TryCancel();
+  cancelled_.store(true);
+  std::lock_guard<std::mutex> lock(context_mutex_);
+  context_->TryCancel();
 }
 
 int32_t RemoteDBMReplicatorImpl::GetMasterServerID() {
@@ -1355,8 +3415,8 @@ int32_t RemoteDBMReplicatorImpl::GetMasterServerID() {
 }
 
 Status RemoteDBMReplicatorImpl::Start(
-    int64_t min_timestamp, int32_t server_id, double wait_time) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+    int64_t min_timestamp, int32_t server_id, double wait_time, const std::string& address) {
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -1364,15 +3424,20 @@ Status RemoteDBMReplicatorImpl::Start(
     return Status(Status::PRECONDITION_ERROR, "started replicator");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
-  context_.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
-      static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+      static_cast<int64_t>(stream_timeout_ * 1000000)));
   ReplicateRequest request;
   request.set_min_timestamp(min_timestamp);
   request.set_server_id(server_id);
   request.set_wait_time(wait_time);
-  stream_ = dbm_->stub_->Replicate(&context_, request);
+  request.set_address(address);
+  start_request_ = request;
+  stream_ = dbm_->stub_->Replicate(context_.get(), request);
   ReplicateResponse response;
   if (!stream_->Read(&response)) {
     healthy_.store(false);
@@ -1383,11 +3448,52 @@ Status RemoteDBMReplicatorImpl::Start(
     return Status(Status::BROKEN_DATA_ERROR, "invalid operation type");
   }
   server_id_ = response.server_id();
+  client_server_id_ = server_id;
+  session_id_.store(response.session_id());
+  sequence_.store(0);
   return Status(Status::SUCCESS);
 }
 
+Status RemoteDBMReplicatorImpl::Reconnect() {
+  if (cancelled_.load() || stream_ == nullptr || !dbm_->CanReconnect()) {
+    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+  }
+  // The replication resumes from the last timestamp, so some updates may be read again.
+  ReplicateRequest request = start_request_;
+  request.set_min_timestamp(std::max(start_request_.min_timestamp(), last_timestamp_));
+  for (int32_t num_attempts = 1; num_attempts <= dbm_->reconnect_max_attempts_; num_attempts++) {
+    if (!dbm_->WaitReconnectBackoff(num_attempts)) {
+      break;
+    }
+    {
+      std::lock_guard<std::mutex> lock(context_mutex_);
+      if (cancelled_.load()) {
+        break;
+      }
+      stream_.reset(nullptr);
+      context_ = std::make_unique<grpc::ClientContext>();
+      context_->set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+          static_cast<int64_t>(stream_timeout_ * 1000000)));
+      stream_ = dbm_->stub_->Replicate(context_.get(), request);
+    }
+    ReplicateResponse response;
+    if (stream_->Read(&response) && response.op_type() == ReplicateResponse::OP_NOOP) {
+      server_id_ = response.server_id();
+      session_id_.store(response.session_id());
+      sequence_.store(0);
+      healthy_.store(true);
+      dbm_->reconnect_num_successes_.fetch_add(1);
+      return Status(Status::SUCCESS);
+    }
+    context_->TryCancel();
+    stream_->Finish();
+  }
+  dbm_->reconnect_num_failures_.fetch_add(1);
+  return Status(Status::NETWORK_ERROR, "reconnection failed");
+}
+
 Status RemoteDBMReplicatorImpl::Read(int64_t* timestamp, RemoteDBM::ReplicateLog* op) {
-  std::shared_lock<SpinSharedMutex> lock(dbm_->mutex_);
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
   if (dbm_->stub_ == nullptr) {
     return Status(Status::PRECONDITION_ERROR, "not connected database");
   }
@@ -1395,7 +3501,10 @@ Status RemoteDBMReplicatorImpl::Read(int64_t* timestamp, RemoteDBM::ReplicateLog
     return Status(Status::PRECONDITION_ERROR, "not started replicator");
   }
   if (!healthy_.load()) {
-    return Status(Status::PRECONDITION_ERROR, "unhealthy stream");
+    const Status status = Reconnect();
+    if (status != Status::SUCCESS) {
+      return status;
+    }
   }
   ReplicateResponse response;
   if (!stream_->Read(&response)) {
@@ -1404,6 +3513,12 @@ Status RemoteDBMReplicatorImpl::Read(int64_t* timestamp, RemoteDBM::ReplicateLog
     return Status(Status::NETWORK_ERROR, StrCat("Read failed: ", message));
   }
   *timestamp = response.timestamp();
+  last_timestamp_ = std::max(last_timestamp_, response.timestamp());
+  origin_timestamp_ = response.origin_timestamp() == 0 ?
+      response.timestamp() : response.origin_timestamp();
+  if (response.sequence() > 0) {
+    sequence_.store(response.sequence());
+  }
   delete[] op->buffer_;
   switch (response.op_type()) {
     case ReplicateResponse::OP_SET:
@@ -1431,6 +3546,82 @@ Status RemoteDBMReplicatorImpl::Read(int64_t* timestamp, RemoteDBM::ReplicateLog
   return MakeStatusFromProto(response.status());
 }
 
+int64_t RemoteDBMReplicatorImpl::GetOriginTimestamp() {
+  return origin_timestamp_;
+}
+
+void RemoteDBMReplicatorImpl::GetPosition(int64_t* session_id, int64_t* sequence) {
+  *session_id = session_id_.load();
+  *sequence = sequence_.load();
+}
+
+Status RemoteDBMReplicatorImpl::Ack(int64_t timestamp, int64_t session_id, int64_t sequence) {
+  std::shared_lock<SlottedSharedMutex> lock(dbm_->mutex_);
+  if (dbm_->stub_ == nullptr) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  if (stream_ == nullptr) {
+    return Status(Status::PRECONDITION_ERROR, "not started replicator");
+  }
+  grpc::ClientContext context;
+  context.set_deadline(std::chrono::system_clock::now() + std::chrono::microseconds(
+      static_cast<int64_t>(dbm_->timeout_ * 1000000)));
+  ReplicateAckRequest request;
+  request.set_server_id(client_server_id_);
+  request.set_timestamp(timestamp);
+  request.set_session_id(session_id);
+  request.set_sequence(sequence);
+  ReplicateAckResponse response;
+  grpc::Status status = dbm_->stub_->ReplicateAck(&context, request, &response);
+  if (!status.ok()) {
+    return Status(Status::NETWORK_ERROR, GRPCStatusString(status));
+  }
+  return MakeStatusFromProto(response.status());
+}
+
+RemoteDBMBatchImpl::RemoteDBMBatchImpl()
+    : dbm_index_(0), request_(), response_(), executed_(false) {}
+
+void RemoteDBMBatchImpl::SetDBMIndex(int32_t dbm_index) {
+  dbm_index_ = dbm_index;
+}
+
+BatchOperation* RemoteDBMBatchImpl::AddOperation(
+    BatchOperation::OpType op_type, std::string_view key) {
+  auto* op = request_.add_operations();
+  op->set_operation(op_type);
+  op->set_dbm_index(dbm_index_);
+  op->set_key(key.data(), key.size());
+  return op;
+}
+
+int32_t RemoteDBMBatchImpl::GetNumOperations() const {
+  return request_.operations_size();
+}
+
+Status RemoteDBMBatchImpl::GetResult(int32_t index, std::string* value, int64_t* current) {
+  if (!executed_) {
+    return Status(Status::PRECONDITION_ERROR, "not executed batch");
+  }
+  if (index < 0 || index >= response_.results_size()) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "out-of-range index");
+  }
+  const auto& result = response_.results(index);
+  if (value != nullptr) {
+    *value = result.value();
+  }
+  if (current != nullptr) {
+    *current = result.current();
+  }
+  return MakeStatusFromProto(result.status());
+}
+
+void RemoteDBMBatchImpl::Clear() {
+  request_.Clear();
+  response_.Clear();
+  executed_ = false;
+}
+
 RemoteDBM::RemoteDBM() : impl_(nullptr) {
   impl_ = new RemoteDBMImpl();
 }
@@ -1443,8 +3634,58 @@ void RemoteDBM::InjectStub(void* stub) {
   impl_->InjectStub(stub);
 }
 
-Status RemoteDBM::Connect(const std::string& address, double timeout) {
-  return impl_->Connect(address, timeout);
+Status RemoteDBM::InjectReplicaStubs(const std::vector<void*>& stubs,
+                                     double max_staleness, double heartbeat_interval) {
+  return impl_->InjectReplicaStubs(stubs, max_staleness, heartbeat_interval);
+}
+
+void RemoteDBM::RegisterInProcessServer(const std::string& name, void* server) {
+  std::mutex* mutex = nullptr;
+  auto& servers = GetInProcessServers(&mutex);
+  std::lock_guard<std::mutex> lock(*mutex);
+  if (server == nullptr) {
+    servers.erase(name);
+  } else {
+    servers[name] = reinterpret_cast<grpc::Server*>(server);
+  }
+}
+
+Status RemoteDBM::Connect(const std::string& address, double timeout, int32_t num_channels) {
+  ConnectOptions options;
+  options.connect_timeout = timeout;
+  options.call_timeout = timeout;
+  options.num_channels = num_channels;
+  return impl_->Connect(address, options);
+}
+
+Status RemoteDBM::Connect(const std::string& address, const ConnectOptions& options) {
+  return impl_->Connect(address, options);
+}
+
+Status RemoteDBM::ConnectReplicas(const std::vector<std::string>& addresses,
+                                  double max_staleness, double heartbeat_interval) {
+  return impl_->ConnectReplicas(addresses, max_staleness, heartbeat_interval);
+}
+
+Status RemoteDBM::EnableCache(int64_t capacity, double max_staleness) {
+  return impl_->EnableCache(capacity, max_staleness);
+}
+
+Status RemoteDBM::SetRetryPolicy(const RetryPolicy& policy) {
+  return impl_->SetRetryPolicy(policy);
+}
+
+Status RemoteDBM::EnableBatching(double window, int32_t max_batch_size) {
+  return impl_->EnableBatching(window, max_batch_size);
+}
+
+Status RemoteDBM::EnableIteratorPrefetch(int32_t window) {
+  return impl_->EnableIteratorPrefetch(window);
+}
+
+Status RemoteDBM::EnableAutoReconnect(
+    int32_t max_attempts, double initial_backoff, double max_backoff) {
+  return impl_->EnableAutoReconnect(max_attempts, initial_backoff, max_backoff);
 }
 
 Status RemoteDBM::Disconnect() {
@@ -1455,6 +3696,14 @@ Status RemoteDBM::SetDBMIndex(int32_t dbm_index) {
   return impl_->SetDBMIndex(dbm_index);
 }
 
+Status RemoteDBM::SetMinTimestamp(int64_t min_timestamp) {
+  return impl_->SetMinTimestamp(min_timestamp);
+}
+
+int64_t RemoteDBM::GetLastTimestamp() {
+  return impl_->GetLastTimestamp();
+}
+
 Status RemoteDBM::Echo(std::string_view message, std::string* echo) {
   return impl_->Echo(message, echo);
 }
@@ -1463,6 +3712,10 @@ Status RemoteDBM::Inspect(std::vector<std::pair<std::string, std::string>>* reco
   return impl_->Inspect(records);
 }
 
+Status RemoteDBM::InspectClient(std::vector<std::pair<std::string, std::string>>* records) {
+  return impl_->InspectClient(records);
+}
+
 Status RemoteDBM::Get(std::string_view key, std::string* value) {
   return impl_->Get(key, value);
 }
@@ -1514,6 +3767,11 @@ Status RemoteDBM::CompareExchangeMulti(
   return impl_->CompareExchangeMulti(expected, desired);
 }
 
+Status RemoteDBM::ExecuteBatch(Batch* batch, bool atomic) {
+  assert(batch != nullptr);
+  return impl_->ExecuteBatch(batch->impl_, atomic);
+}
+
 Status RemoteDBM::Count(int64_t* count) {
   return impl_->Count(count);
 }
@@ -1548,6 +3806,116 @@ Status RemoteDBM::ChangeMaster(std::string_view master, double timestamp_skew) {
   return impl_->ChangeMaster(master, timestamp_skew);
 }
 
+Status RemoteDBM::SetAsyncThreads(int32_t num_threads) {
+  return impl_->SetAsyncThreads(num_threads);
+}
+
+std::future<std::pair<Status, std::string>> RemoteDBM::GetAsync(std::string_view key) {
+  auto promise = std::make_shared<std::promise<std::pair<Status, std::string>>>();
+  auto future = promise->get_future();
+  impl_->GetAsync(key, [promise](const Status& status, const std::string& value) {
+    promise->set_value(std::make_pair(status, value));
+  });
+  return future;
+}
+
+void RemoteDBM::GetAsync(
+    std::string_view key, std::function<void(const Status&, const std::string&)> callback) {
+  impl_->GetAsync(key, std::move(callback));
+}
+
+std::future<std::pair<Status, std::map<std::string, std::string>>> RemoteDBM::GetMultiAsync(
+    const std::vector<std::string_view>& keys) {
+  auto promise =
+      std::make_shared<std::promise<std::pair<Status, std::map<std::string, std::string>>>>();
+  auto future = promise->get_future();
+  impl_->GetMultiAsync(
+      keys, [promise](const Status& status, const std::map<std::string, std::string>& records) {
+        promise->set_value(std::make_pair(status, records));
+      });
+  return future;
+}
+
+void RemoteDBM::GetMultiAsync(
+    const std::vector<std::string_view>& keys,
+    std::function<void(const Status&, const std::map<std::string, std::string>&)> callback) {
+  impl_->GetMultiAsync(keys, std::move(callback));
+}
+
+std::future<Status> RemoteDBM::SetAsync(
+    std::string_view key, std::string_view value, bool overwrite) {
+  auto promise = std::make_shared<std::promise<Status>>();
+  auto future = promise->get_future();
+  impl_->SetAsync(key, value, overwrite, [promise](const Status& status) {
+    promise->set_value(status);
+  });
+  return future;
+}
+
+void RemoteDBM::SetAsync(std::string_view key, std::string_view value, bool overwrite,
+                         std::function<void(const Status&)> callback) {
+  impl_->SetAsync(key, value, overwrite, std::move(callback));
+}
+
+std::future<Status> RemoteDBM::SetMultiAsync(
+    const std::map<std::string_view, std::string_view>& records, bool overwrite) {
+  auto promise = std::make_shared<std::promise<Status>>();
+  auto future = promise->get_future();
+  impl_->SetMultiAsync(records, overwrite, [promise](const Status& status) {
+    promise->set_value(status);
+  });
+  return future;
+}
+
+void RemoteDBM::SetMultiAsync(
+    const std::map<std::string_view, std::string_view>& records, bool overwrite,
+    std::function<void(const Status&)> callback) {
+  impl_->SetMultiAsync(records, overwrite, std::move(callback));
+}
+
+std::future<Status> RemoteDBM::RemoveAsync(std::string_view key) {
+  auto promise = std::make_shared<std::promise<Status>>();
+  auto future = promise->get_future();
+  impl_->RemoveAsync(key, [promise](const Status& status) {
+    promise->set_value(status);
+  });
+  return future;
+}
+
+void RemoteDBM::RemoveAsync(std::string_view key, std::function<void(const Status&)> callback) {
+  impl_->RemoveAsync(key, std::move(callback));
+}
+
+std::future<Status> RemoteDBM::RemoveMultiAsync(const std::vector<std::string_view>& keys) {
+  auto promise = std::make_shared<std::promise<Status>>();
+  auto future = promise->get_future();
+  impl_->RemoveMultiAsync(keys, [promise](const Status& status) {
+    promise->set_value(status);
+  });
+  return future;
+}
+
+void RemoteDBM::RemoveMultiAsync(
+    const std::vector<std::string_view>& keys, std::function<void(const Status&)> callback) {
+  impl_->RemoveMultiAsync(keys, std::move(callback));
+}
+
+std::future<Status> RemoteDBM::AppendMultiAsync(
+    const std::map<std::string_view, std::string_view>& records, std::string_view delim) {
+  auto promise = std::make_shared<std::promise<Status>>();
+  auto future = promise->get_future();
+  impl_->AppendMultiAsync(records, delim, [promise](const Status& status) {
+    promise->set_value(status);
+  });
+  return future;
+}
+
+void RemoteDBM::AppendMultiAsync(
+    const std::map<std::string_view, std::string_view>& records, std::string_view delim,
+    std::function<void(const Status&)> callback) {
+  impl_->AppendMultiAsync(records, delim, std::move(callback));
+}
+
 std::unique_ptr<RemoteDBM::Stream> RemoteDBM::MakeStream() {
   std::unique_ptr<RemoteDBM::Stream> iter(new RemoteDBM::Stream(impl_));
   return iter;
@@ -1667,6 +4035,76 @@ RemoteDBM::ReplicateLog::~ReplicateLog() {
   delete[] buffer_;
 }
 
+RemoteDBM::Batch::Batch() {
+  impl_ = new RemoteDBMBatchImpl();
+}
+
+RemoteDBM::Batch::~Batch() {
+  delete impl_;
+}
+
+void RemoteDBM::Batch::SetDBMIndex(int32_t dbm_index) {
+  impl_->SetDBMIndex(dbm_index);
+}
+
+int32_t RemoteDBM::Batch::Get(std::string_view key) {
+  impl_->AddOperation(BatchOperation::OP_GET, key);
+  return impl_->GetNumOperations() - 1;
+}
+
+int32_t RemoteDBM::Batch::Set(std::string_view key, std::string_view value, bool overwrite) {
+  auto* op = impl_->AddOperation(BatchOperation::OP_SET, key);
+  op->set_value(value.data(), value.size());
+  op->set_overwrite(overwrite);
+  return impl_->GetNumOperations() - 1;
+}
+
+int32_t RemoteDBM::Batch::Remove(std::string_view key) {
+  impl_->AddOperation(BatchOperation::OP_REMOVE, key);
+  return impl_->GetNumOperations() - 1;
+}
+
+int32_t RemoteDBM::Batch::Append(
+    std::string_view key, std::string_view value, std::string_view delim) {
+  auto* op = impl_->AddOperation(BatchOperation::OP_APPEND, key);
+  op->set_value(value.data(), value.size());
+  op->set_delim(delim.data(), delim.size());
+  return impl_->GetNumOperations() - 1;
+}
+
+int32_t RemoteDBM::Batch::CompareExchange(
+    std::string_view key, std::string_view expected, std::string_view desired) {
+  auto* op = impl_->AddOperation(BatchOperation::OP_COMPARE_EXCHANGE, key);
+  if (expected.data() != nullptr) {
+    op->set_expected_existence(true);
+    op->set_expected_value(expected.data(), expected.size());
+  }
+  if (desired.data() != nullptr) {
+    op->set_desired_existence(true);
+    op->set_value(desired.data(), desired.size());
+  }
+  return impl_->GetNumOperations() - 1;
+}
+
+int32_t RemoteDBM::Batch::Increment(std::string_view key, int64_t increment, int64_t initial) {
+  auto* op = impl_->AddOperation(BatchOperation::OP_INCREMENT, key);
+  op->set_increment(increment);
+  op->set_initial(initial);
+  return impl_->GetNumOperations() - 1;
+}
+
+int32_t RemoteDBM::Batch::GetNumOperations() const {
+  return impl_->GetNumOperations();
+}
+
+Status RemoteDBM::Batch::GetResult(int32_t index, std::string* value, int64_t* current) {
+  return impl_->GetResult(index, value, current);
+}
+
+void RemoteDBM::Batch::Clear() {
+  impl_->Clear();
+}
+
 RemoteDBM::Replicator::Replicator(RemoteDBMImpl* dbm_impl) {
   impl_ = new RemoteDBMReplicatorImpl(dbm_impl);
 }
@@ -1683,8 +4121,9 @@ int32_t RemoteDBM::Replicator::GetMasterServerID() {
   return impl_->GetMasterServerID();
 }
 
-Status RemoteDBM::Replicator::Start(int64_t min_timestamp, int32_t server_id, double timeout) {
-  return impl_->Start(min_timestamp, server_id, timeout);
+Status RemoteDBM::Replicator::Start(int64_t min_timestamp, int32_t server_id, double timeout,
+                                   const std::string& address) {
+  return impl_->Start(min_timestamp, server_id, timeout, address);
 }
 
 Status RemoteDBM::Replicator::Read(int64_t* timestamp, ReplicateLog* op) {
@@ -1692,6 +4131,18 @@ Status RemoteDBM::Replicator::Read(int64_t* timestamp, ReplicateLog* op) {
   return impl_->Read(timestamp, op);
 }
 
+int64_t RemoteDBM::Replicator::GetOriginTimestamp() {
+  return impl_->GetOriginTimestamp();
+}
+
+void RemoteDBM::Replicator::GetPosition(int64_t* session_id, int64_t* sequence) {
+  impl_->GetPosition(session_id, sequence);
+}
+
+Status RemoteDBM::Replicator::Ack(int64_t timestamp, int64_t session_id, int64_t sequence) {
+  return impl_->Ack(timestamp, session_id, sequence);
+}
+
 }  // namespace tkrzw
 
 // END OF FILE
@@ -14,6 +14,8 @@
 #ifndef _TKRZW_DBM_REMOTE_H
 #define _TKRZW_DBM_REMOTE_H
 
+#include <functional>
+#include <future>
 #include <map>
 #include <string>
 #include <string_view>
@@ -31,6 +33,7 @@ class RemoteDBMImpl;
 class RemoteDBMStreamImpl;
 class RemoteDBMIteratorImpl;
 class RemoteDBMReplicatorImpl;
+class RemoteDBMBatchImpl;
 
 /**
  * RPC interface to access the database service via gRPC protocol.
@@ -377,9 +380,12 @@ class RemoteDBM final {
      * to avoid infinite loop.
      * @param wait_time The time in seconds to wait for the next log.  Zero means no wait.
      * Negative means unlimited.
+     * @param address The address where the process accepts connections of further replicas.
+     * It is shown in the topology view of the server.  Empty means not serving.
      * @return The result status.
      */
-    Status Start(int64_t min_timestamp, int32_t server_id = 0, double wait_time = -1);
+    Status Start(int64_t min_timestamp, int32_t server_id = 0, double wait_time = -1,
+                 const std::string& address = "");
 
     /**
      * Reads the next update log.
@@ -392,6 +398,41 @@ class RemoteDBM final {
      */
     Status Read(int64_t* timestamp, ReplicateLog* op);
 
+    /**
+     * Gets the timestamp given by the origin master which the update logs read so far cover.
+     * @return The timestamp in milliseconds, or -1 if it is unknown.
+     * @details If the master relays updates of its own master, the timestamps given by the
+     * Read method are of the update logs of the relaying master.  This returns the timestamp
+     * of the origin master instead, which can be compared with timestamps given by it.  If the
+     * master is the origin, this returns the same timestamp as the last call of the Read method.
+     */
+    int64_t GetOriginTimestamp();
+
+    /**
+     * Gets the position of the last update log read in the current replication session.
+     * @param session_id The pointer to a variable to store the ID of the session assigned by
+     * the master.
+     * @param sequence The pointer to a variable to store the sequence number of the last log
+     * in the session.
+     * @details The position should be taken after the log has been applied and then passed to
+     * the Ack method.
+     */
+    void GetPosition(int64_t* session_id, int64_t* sequence);
+
+    /**
+     * Acknowledges that updates up to a position have been applied.
+     * @param timestamp The timestamp in milliseconds of the latest applied update.
+     * @param session_id The ID of the session given by the GetPosition method.
+     * @param sequence The sequence number given by the GetPosition method.
+     * @return The result status.  If the session is no longer live on the master,
+     * PRECONDITION_ERROR is returned.
+     * @details This can be called only after the Start method returns success.  The master
+     * uses acknowledgements to release writers waiting for semi-synchronous replication.  It
+     * clamps them to the logs it has actually sent in the session.  This can be called by
+     * another thread than the thread doing the Read method.
+     */
+    Status Ack(int64_t timestamp, int64_t session_id, int64_t sequence);
+
     /**
      * Constructor.
      * @param dbm_impl The database implementation object.
@@ -402,6 +443,166 @@ class RemoteDBM final {
     RemoteDBMReplicatorImpl* impl_;
   };
 
+  /**
+   * Builder of a batch of operations done in one request.
+   * @details Operations on records of any DBMs are added and then they are done in the order of
+   * addition by the ExecuteBatch method of the database, which sends them to the server at once.
+   * The server locks the records of each DBM only once for the whole batch.  The result of each
+   * operation is retrieved with the index returned by the method which added it.
+   */
+  class Batch {
+    friend class tkrzw::RemoteDBM;
+   public:
+    /**
+     * Default constructor.
+     */
+    Batch();
+
+    /**
+     * Destructor.
+     */
+    ~Batch();
+
+    /**
+     * Copy and assignment are disabled.
+     */
+    explicit Batch(const Batch& rhs) = delete;
+    Batch& operator =(const Batch& rhs) = delete;
+
+    /**
+     * Sets the index of the DBM which the operations added afterwards access.
+     * @param dbm_index The index of the DBM.  The default is 0.
+     */
+    void SetDBMIndex(int32_t dbm_index);
+
+    /**
+     * Adds an operation to get the value of a record.
+     * @param key The key of the record.
+     * @return The index of the operation.
+     */
+    int32_t Get(std::string_view key);
+
+    /**
+     * Adds an operation to set a record.
+     * @param key The key of the record.
+     * @param value The value of the record.
+     * @param overwrite Whether to overwrite the existing value.
+     * @return The index of the operation.
+     */
+    int32_t Set(std::string_view key, std::string_view value, bool overwrite = true);
+
+    /**
+     * Adds an operation to remove a record.
+     * @param key The key of the record.
+     * @return The index of the operation.
+     */
+    int32_t Remove(std::string_view key);
+
+    /**
+     * Adds an operation to append data at the end of a record.
+     * @param key The key of the record.
+     * @param value The value to append.
+     * @param delim The delimiter to put after the existing record.
+     * @return The index of the operation.
+     */
+    int32_t Append(std::string_view key, std::string_view value, std::string_view delim = "");
+
+    /**
+     * Adds an operation to compare the value of a record and exchange it.
+     * @param key The key of the record.
+     * @param expected The expected value.  If the data is nullptr, no existing record is
+     * expected.
+     * @param desired The desired value.  If the data is nullptr, the record is to be removed.
+     * @return The index of the operation.
+     */
+    int32_t CompareExchange(std::string_view key, std::string_view expected,
+                            std::string_view desired);
+
+    /**
+     * Adds an operation to increment the numeric value of a record.
+     * @param key The key of the record.
+     * @param increment The incremental value.
+     * @param initial The initial value.
+     * @return The index of the operation.
+     */
+    int32_t Increment(std::string_view key, int64_t increment = 1, int64_t initial = 0);
+
+    /**
+     * Gets the number of the added operations.
+     * @return The number of the added operations.
+     */
+    int32_t GetNumOperations() const;
+
+    /**
+     * Gets the result of an operation after execution.
+     * @param index The index of the operation.
+     * @param value The pointer to a string object to contain the value got by the Get
+     * operation.  If it is nullptr, it is ignored.
+     * @param current The pointer to an integer to contain the current value of the Increment
+     * operation.  If it is nullptr, it is ignored.
+     * @return The result status of the operation.  If the batch has not been executed,
+     * PRECONDITION_ERROR is returned.
+     */
+    Status GetResult(int32_t index, std::string* value = nullptr, int64_t* current = nullptr);
+
+    /**
+     * Removes all operations and results.
+     */
+    void Clear();
+
+   private:
+    /** Pointer to the actual implementation. */
+    RemoteDBMBatchImpl* impl_;
+  };
+
+  /**
+   * Policy to retry failed retrievals and to hedge slow retrievals.
+   */
+  struct RetryPolicy {
+    /** The maximum number of attempts including the first one.  1 means no retry. */
+    int32_t max_attempts = 1;
+    /** The upper bound of the backoff time in seconds before the first retry. */
+    double initial_backoff = 0.01;
+    /** The upper bound of the backoff time in seconds before any retry. */
+    double max_backoff = 1.0;
+    /** The multiplier of the backoff time for each retry. */
+    double backoff_multiplier = 2.0;
+    /** The ratio of retries to calls allowed in the long run. */
+    double budget_ratio = 0.1;
+    /** The names of gRPC status codes to retry, like "UNAVAILABLE". */
+    std::vector<std::string> retryable_codes = {"UNAVAILABLE"};
+    /** The time in seconds to wait before sending a hedged request.  Negative disables it. */
+    double hedge_delay = -1;
+  };
+
+  /**
+   * Options of the connection to the server.
+   */
+  struct ConnectOptions {
+    /** The timeout in seconds to establish the connection.  Negative means unlimited. */
+    double connect_timeout = -1;
+    /** The timeout in seconds for each operation.  Negative means unlimited. */
+    double call_timeout = -1;
+    /** The number of channels to the server. */
+    int32_t num_channels = 1;
+    /** The maximum size of a sent message.  0 means the default.  Negative means unlimited. */
+    int32_t max_send_message_size = 0;
+    /** The maximum size of a received message.  0 means the default (4MiB).  Negative means
+        unlimited. */
+    int32_t max_receive_message_size = 0;
+    /** The interval in seconds of keepalive pings.  0 or negative disables them. */
+    double keepalive_time = 0;
+    /** The time in seconds to wait for the acknowledgement of a keepalive ping. */
+    double keepalive_timeout = 20;
+    /** Whether to send keepalive pings while there's no outstanding call. */
+    bool keepalive_without_calls = false;
+    /** The default compression algorithm: "none", "deflate", or "gzip".  Empty means none. */
+    std::string compression;
+    /** The load balancing policy, like "pick_first" and "round_robin".  Empty means the
+        default. */
+    std::string load_balancing_policy;
+  };
+
   /**
    * Constructor.
    */
@@ -426,16 +627,138 @@ class RemoteDBM final {
    */
   void InjectStub(void* stub);
 
+  /**
+   * Injects stubs of replica servers for testing.
+   * @param stubs The pointers to the DBMService::StubInterface objects.  The ownership is
+   * taken.
+   * @param max_staleness The maximum replication lag in seconds of a replica to be queried.
+   * @param heartbeat_interval The interval in seconds of heartbeats to learn the replication
+   * lag of each replica.
+   * @return The result status.
+   * @details This method is used instead of the ConnectReplicas method.
+   */
+  Status InjectReplicaStubs(const std::vector<void*>& stubs,
+                            double max_staleness = 1.0, double heartbeat_interval = 1.0);
+
+  /**
+   * Registers a server in the same process to be connected by name.
+   * @param name The name of the server.
+   * @param server The pointer to the grpc::Server object hosting the database service.  The
+   * ownership is not taken.  If it is nullptr, the registration is removed.
+   * @details A registered server is connected by the Connect method with an address like
+   * "inproc:name".  Calls are passed to the service in memory without the network stack.  The
+   * registration must be removed before the server is destroyed.
+   */
+  static void RegisterInProcessServer(const std::string& name, void* server);
+
   /**
    * Connects to the server.
    * @param address The address or the host name of the server and its port number.  For IPv4
    * address, it's like "127.0.0.1:1978".  For IPv6, it's like "[::1]:1978".  For UNIX domain
-   * sockets, it's like "unix:/path/to/file".
+   * sockets, it's like "unix:/path/to/file".  For a server registered in the same process
+   * with the RegisterInProcessServer method, it's like "inproc:name".
    * @param timeout The timeout in seconds for connection and each operation.  Negative means
    * unlimited.
+   * @param num_channels The number of channels to the server.  Each channel has its own
+   * connection and calls are distributed among them in a round-robin manner.
+   * @return The result status.
+   */
+  Status Connect(const std::string& address, double timeout = -1, int32_t num_channels = 1);
+
+  /**
+   * Connects to the server with detailed options.
+   * @param address The address of the server, in the same format as the other Connect method.
+   * @param options The options of the connection.  The channel arguments are also used for
+   * connections to replicas.
+   * @return The result status.
+   */
+  Status Connect(const std::string& address, const ConnectOptions& options);
+
+  /**
+   * Connects to replica servers to share retrieval queries.
+   * @param addresses The addresses of the replica servers.
+   * @param max_staleness The maximum replication lag in seconds of a replica to be queried.
+   * @param heartbeat_interval The interval in seconds of heartbeats to learn the replication
+   * lag of each replica.
+   * @return The result status.
+   * @details This must be called after the Connect method connects to the master.  Updating
+   * queries are always sent to the master.  Retrieval queries by the Get, GetMulti, Count, and
+   * SearchModal methods are sent to the least-loaded replica whose lag is within the bound.  If
+   * there's no such replica, or if the replica fails, the master is queried.
+   */
+  Status ConnectReplicas(const std::vector<std::string>& addresses,
+                         double max_staleness = 1.0, double heartbeat_interval = 1.0);
+
+  /**
+   * Enables the client-side cache of records.
+   * @param capacity The maximum number of records in the cache.
+   * @param max_staleness The maximum staleness in seconds of cached records while the cache
+   * isn't synchronized with the server.
+   * @return The result status.
+   * @details This must be called after the Connect method.  The Get and GetMulti methods look
+   * up the cache first and store records retrieved from the server in it.  Updates by this
+   * object are reflected in the cache immediately.  Updates by other clients are reflected via
+   * the replication stream of update logs of the server so the server should enable update
+   * logging.  While the stream is down, cached records expire in the maximum staleness.  The
+   * cache is discarded when the stream is reconnected or the DBM index is changed.
+   */
+  Status EnableCache(int64_t capacity, double max_staleness = 1.0);
+
+  /**
+   * Sets the policy to retry and hedge retrievals.
+   * @param policy The policy.
+   * @return The result status.
+   * @details This applies to the Get, GetMulti, Count, and SearchModal methods.  A failed call
+   * whose gRPC status is retryable is retried after a random backoff time up to the current
+   * bound, which grows for each retry.  Each call earns the budget ratio of a token and each
+   * retry spends one token so that retries don't overload failing servers.  If hedging is
+   * enabled and a Get or GetMulti call doesn't finish within the hedge delay, the same request
+   * is sent to another replica or channel and the first successful response is taken.
+   */
+  Status SetRetryPolicy(const RetryPolicy& policy);
+
+  /**
+   * Enables batching of single-record operations by concurrent threads.
+   * @param window The time in seconds to wait for other calls to join a batch.
+   * @param max_batch_size The maximum number of calls in a batch.
+   * @return The result status.
+   * @details This must be called after the Connect method.  Calls of the Get method, the Set
+   * method with overwriting, and the Remove method are collected for each method.  The first
+   * call of a batch waits for the window or until the batch is full, and then sends one
+   * GetMulti, SetMulti, or RemoveMulti request on behalf of all calls in the batch.  The result
+   * of each record is passed back to each caller.  Thus, each call takes more time up to the
+   * window but the throughput of many threads increases.
+   */
+  Status EnableBatching(double window, int32_t max_batch_size = 100);
+
+  /**
+   * Enables prefetching of records by iterators.
+   * @param window The number of records to read ahead.  Zero disables prefetching.
+   * @return The result status.
+   * @details This affects iterators made after the call.  When the Next method of an iterator
+   * is called, requests to move to and get the following records are sent ahead on the stream
+   * so that the Next and Get methods in a sequential scan are served without waiting for the
+   * server.  Operations to jump, to move backward, or to update the record through the
+   * iterator discard the prefetched records.  Prefetched records can be older than updates
+   * done by other clients while they are being read.
+   */
+  Status EnableIteratorPrefetch(int32_t window);
+
+  /**
+   * Enables automatic reconnection of streams, iterators, and replicators.
+   * @param max_attempts The maximum number of attempts to reconnect.  Zero disables it.
+   * @param initial_backoff The upper bound of the first wait time in seconds.
+   * @param max_backoff The upper bound of the wait time in seconds.
    * @return The result status.
+   * @details The call on which the connection breaks still returns its error.  The next call
+   * re-establishes the connection, waiting for a random time within the bound which doubles at
+   * each attempt.  An iterator is repositioned at the last record whose key it got, or by
+   * replaying the last positioning operation and the following moves.  A replicator restarts
+   * from the timestamp of the last read update, so some updates can be read again.  If all
+   * attempts fail, NETWORK_ERROR is returned and the next call tries again.
    */
-  Status Connect(const std::string& address, double timeout = -1);
+  Status EnableAutoReconnect(
+      int32_t max_attempts, double initial_backoff = 0.01, double max_backoff = 1.0);
 
   /**
    * Disconnects the connection to the server.
@@ -450,6 +773,25 @@ class RemoteDBM final {
    */
   Status SetDBMIndex(int32_t dbm_index);
 
+  /**
+   * Sets the minimum timestamp of updates which must be applied before retrieval.
+   * @param min_timestamp The minimum timestamp in milliseconds.  Zero or negative means no
+   * constraint.
+   * @return The result status.
+   * @details The timestamp is sent with the Get and GetMulti methods.  A replica server waits
+   * until it has applied updates up to the timestamp.  If it doesn't catch up in time,
+   * INFEASIBLE_ERROR is returned.  Setting the result of GetLastTimestamp of the connection to
+   * the master realizes read-your-writes consistency on replicas.
+   */
+  Status SetMinTimestamp(int64_t min_timestamp);
+
+  /**
+   * Gets the update log timestamp of the latest update done by this object.
+   * @return The timestamp in milliseconds, or zero if no update has been done or the server
+   * doesn't log updates.
+   */
+  int64_t GetLastTimestamp();
+
   /**
    * Sends a message and gets back the echo message.
    * @param message The message to send.
@@ -466,6 +808,15 @@ class RemoteDBM final {
    */
   Status Inspect(std::vector<std::pair<std::string, std::string>>* records);
 
+  /**
+   * Inspects the client-side statistics.
+   * @param records The pointer to a map to store retrieved records.
+   * @return The result status.
+   * @details The statistics include the number of hits and misses of the cache, the number of
+   * retries, the number of hedged requests sent and won, and the number of batches.
+   */
+  Status InspectClient(std::vector<std::pair<std::string, std::string>>* records);
+
   /**
    * Gets the value of a record of a key.
    * @param key The key of the record.
@@ -717,6 +1068,17 @@ class RemoteDBM final {
       const std::vector<std::pair<std::string_view, std::string_view>>& expected,
       const std::vector<std::pair<std::string_view, std::string_view>>& desired);
 
+  /**
+   * Executes a batch of operations in one request.
+   * @param batch The pointer to the batch.  The results of the operations are stored in it.
+   * @param atomic If true, all updates are cancelled if any of them fails.  Then, all
+   * operations must access the same DBM.  Failure of Get operations doesn't cancel updates.
+   * @return The result status.  If all operations succeed, SUCCESS is returned.  Otherwise,
+   * the status of the first failed operation is returned.  If updates are cancelled, the
+   * operations which would have succeeded get INFEASIBLE_ERROR.
+   */
+  Status ExecuteBatch(Batch* batch, bool atomic = false);
+
   /**
    * Gets the number of records.
    * @param count The pointer to an integer object to contain the result count.
@@ -816,6 +1178,154 @@ class RemoteDBM final {
    */
   Status ChangeMaster(std::string_view master, double timestamp_skew = 0);
 
+  /**
+   * Sets the number of threads to drive asynchronous calls.
+   * @param num_threads The number of threads.
+   * @return The result status.
+   * @details The threads are started by the first asynchronous call after connection.  This
+   * setting is effective for threads started after it.  By default, one thread is used.
+   */
+  Status SetAsyncThreads(int32_t num_threads);
+
+  /**
+   * Gets the value of a record of a key asynchronously.
+   * @param key The key of the record.
+   * @return The future of the result status and the value.  If there's no matching record,
+   * NOT_FOUND_ERROR is returned.
+   * @details Each asynchronous method doesn't block the caller.  Any number of calls can be in
+   * flight concurrently.  Unfinished calls are cancelled when the connection is closed.
+   */
+  std::future<std::pair<Status, std::string>> GetAsync(std::string_view key);
+
+  /**
+   * Gets the value of a record of a key asynchronously, with a callback.
+   * @param key The key of the record.
+   * @param callback The function to be called with the result status and the value.  It is
+   * called by one of the driver threads so it should not block.
+   * @details A callback of this or any other asynchronous method must not call the Disconnect
+   * method of the same database object because it waits for the driver threads to finish.
+   * Calls issued by a callback while the database is being disconnected fail immediately.
+   */
+  void GetAsync(std::string_view key,
+                std::function<void(const Status&, const std::string&)> callback);
+
+  /**
+   * Gets the values of multiple records of keys asynchronously.
+   * @param keys The keys of records to retrieve.
+   * @return The future of the result status and the retrieved records.  If one or more records
+   * are missing, NOT_FOUND_ERROR is returned.
+   */
+  std::future<std::pair<Status, std::map<std::string, std::string>>> GetMultiAsync(
+      const std::vector<std::string_view>& keys);
+
+  /**
+   * Gets the values of multiple records of keys asynchronously, with a callback.
+   * @param keys The keys of records to retrieve.
+   * @param callback The function to be called with the result status and the retrieved
+   * records.  It is called by one of the driver threads so it should not block.
+   */
+  void GetMultiAsync(
+      const std::vector<std::string_view>& keys,
+      std::function<void(const Status&, const std::map<std::string, std::string>&)> callback);
+
+  /**
+   * Sets a record of a key and a value asynchronously.
+   * @param key The key of the record.
+   * @param value The value of the record.
+   * @param overwrite Whether to overwrite the existing value if there's a record with the same
+   * key.
+   * @return The future of the result status.  If overwriting is abandoned, DUPLICATION_ERROR
+   * is returned.
+   */
+  std::future<Status> SetAsync(std::string_view key, std::string_view value,
+                               bool overwrite = true);
+
+  /**
+   * Sets a record of a key and a value asynchronously, with a callback.
+   * @param key The key of the record.
+   * @param value The value of the record.
+   * @param overwrite Whether to overwrite the existing value if there's a record with the same
+   * key.
+   * @param callback The function to be called with the result status.  It is called by one of
+   * the driver threads so it should not block.
+   */
+  void SetAsync(std::string_view key, std::string_view value, bool overwrite,
+                std::function<void(const Status&)> callback);
+
+  /**
+   * Sets multiple records asynchronously.
+   * @param records The records to store.
+   * @param overwrite Whether to overwrite the existing value if there's a record with the same
+   * key.
+   * @return The future of the result status.  If there are records avoiding overwriting,
+   * DUPLICATION_ERROR is returned.
+   */
+  std::future<Status> SetMultiAsync(
+      const std::map<std::string_view, std::string_view>& records, bool overwrite = true);
+
+  /**
+   * Sets multiple records asynchronously, with a callback.
+   * @param records The records to store.
+   * @param overwrite Whether to overwrite the existing value if there's a record with the same
+   * key.
+   * @param callback The function to be called with the result status.  It is called by one of
+   * the driver threads so it should not block.
+   */
+  void SetMultiAsync(const std::map<std::string_view, std::string_view>& records,
+                     bool overwrite, std::function<void(const Status&)> callback);
+
+  /**
+   * Removes a record of a key asynchronously.
+   * @param key The key of the record.
+   * @return The future of the result status.  If there's no matching record, NOT_FOUND_ERROR
+   * is returned.
+   */
+  std::future<Status> RemoveAsync(std::string_view key);
+
+  /**
+   * Removes a record of a key asynchronously, with a callback.
+   * @param key The key of the record.
+   * @param callback The function to be called with the result status.  It is called by one of
+   * the driver threads so it should not block.
+   */
+  void RemoveAsync(std::string_view key, std::function<void(const Status&)> callback);
+
+  /**
+   * Removes records of keys asynchronously.
+   * @param keys The keys of records to remove.
+   * @return The future of the result status.  If there are missing records, NOT_FOUND_ERROR
+   * is returned.
+   */
+  std::future<Status> RemoveMultiAsync(const std::vector<std::string_view>& keys);
+
+  /**
+   * Removes records of keys asynchronously, with a callback.
+   * @param keys The keys of records to remove.
+   * @param callback The function to be called with the result status.  It is called by one of
+   * the driver threads so it should not block.
+   */
+  void RemoveMultiAsync(const std::vector<std::string_view>& keys,
+                        std::function<void(const Status&)> callback);
+
+  /**
+   * Appends data to multiple records asynchronously.
+   * @param records The records to append.
+   * @param delim The delimiter to put after the existing record.
+   * @return The future of the result status.
+   */
+  std::future<Status> AppendMultiAsync(
+      const std::map<std::string_view, std::string_view>& records, std::string_view delim = "");
+
+  /**
+   * Appends data to multiple records asynchronously, with a callback.
+   * @param records The records to append.
+   * @param delim The delimiter to put after the existing record.
+   * @param callback The function to be called with the result status.  It is called by one of
+   * the driver threads so it should not block.
+   */
+  void AppendMultiAsync(const std::map<std::string_view, std::string_view>& records,
+                        std::string_view delim, std::function<void(const Status&)> callback);
+
   /**
    * Makes a stream for intensive operations.
    * @return The stream for intensive operations.
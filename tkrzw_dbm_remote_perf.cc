@@ -15,14 +15,26 @@
 #include <cstdarg>
 #include <cstdint>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include "tkrzw_cmd_util.h"
 #include "tkrzw_dbm_remote.h"
+#include "tkrzw_hash_util.h"
 #include "tkrzw_rpc_common.h"
+#include "tkrzw_server_impl.h"
 
 namespace tkrzw {
 
@@ -37,6 +49,16 @@ static void PrintUsageAndDie() {
   P("    : Checks echoing/setting/getting/removing performance in sequence.\n");
   P("  %s wicked [options]\n", progname);
   P("    : Checks consistency with various operations.\n");
+  P("  %s workload [options]\n", progname);
+  P("    : Checks performance with a mix of operations like YCSB.\n");
+  P("  %s async [options]\n", progname);
+  P("    : Checks setting/getting/removing performance with many asynchronous calls.\n");
+  P("  %s lock [options]\n", progname);
+  P("    : Checks contention of the bare reader-writer lock types without any RPC.\n");
+  P("  %s matrix [options] [db_configs]\n", progname);
+  P("    : Runs a workload on in-process servers of various configurations.\n");
+  P("  %s compare [options] base_csv target_csv\n", progname);
+  P("    : Compares two result files in CSV and reports regressions.\n");
   P("\n");
   P("Common options:\n");
   P("  --address : The address and the port of the service (default: localhost:1978)\n");
@@ -46,7 +68,20 @@ static void PrintUsageAndDie() {
   P("  --size num : The size of each record value. (default: 8)\n");
   P("  --threads num : The number of threads. (default: 1)\n");
   P("  --separate : Use separate instances for each thread.\n");
+  P("  --channels num : The number of channels of each instance. (default: 1)\n");
+  P("  --connect_timeout num : The timeout in seconds for connection."
+    " (default: the same as --timeout)\n");
+  P("  --max_message_size num : The maximum size of sent and received messages.\n");
+  P("  --keepalive num : The interval in seconds of keepalive pings, which must not be shorter"
+    " than --keepalive_min_interval of the server.\n");
+  P("  --keepalive_idle : Sends keepalive pings even without calls.\n");
+  P("  --compression str : The default compression algorithm: none, deflate, gzip.\n");
+  P("  --lb_policy str : The load balancing policy: pick_first, round_robin.\n");
   P("  --random_seed num : The random seed or negative for real RNG. (default: 0)\n");
+  P("  --inproc str : Hosts the service in the process with the database config and connects"
+    " to it without the network.\n");
+  P("  --json str : Writes the results of the phases into the file in JSON.\n");
+  P("  --csv str : Writes the results of the phases into the file in CSV.\n");
   P("\n");
   P("Options for the sequence subcommand:\n");
   P("  --random_key : Uses random keys rather than sequential ones.\n");
@@ -58,7 +93,61 @@ static void PrintUsageAndDie() {
   P("  --remove_only : Does only removing.\n");
   P("  --stream : Uses the stream API.\n");
   P("  --ignore_result : Ignores the result status of streaming updates.\n");
-  P("  --multi num : Sets the size of a batch operation with xxxMulti methods.\n");
+  P("  --multi num : Sets the size of a batch operation with xxxMulti methods. The QPS counts"
+    " records and the latency is of each batch call.\n");
+  P("  --cache num : Enables the client-side cache of the capacity and gets twice.\n");
+  P("  --cache_staleness num : The maximum staleness of cached records. (default: 1.0)\n");
+  P("  --histogram str : Writes the latency histogram of each phase into files with the"
+    " prefix.\n");
+  P("  --rate nums : Issues operations at the comma-separated target QPS of all threads, one"
+    " run of the whole sequence for each rate.\n");
+  P("  --poisson : Makes the intervals of operations at the target rate exponential.\n");
+  P("\n");
+  P("Options for the workload subcommand:\n");
+  P("  --records num : The number of records to load. (default: 10000)\n");
+  P("  --skip_load : Skips loading the records.\n");
+  P("  --preset str : The preset mix of YCSB: a, b, c, d, e, f. (default: a)\n");
+  P("  --read num : The ratio of reading.\n");
+  P("  --update num : The ratio of updating.\n");
+  P("  --insert num : The ratio of inserting.\n");
+  P("  --scan num : The ratio of scanning.\n");
+  P("  --rmw num : The ratio of reading and then writing.\n");
+  P("  --key_dist str : The key distribution: uniform, zipfian, latest, hotspot.\n");
+  P("  --zipf_theta num : The skew of the Zipfian distribution. (default: 0.99)\n");
+  P("  --hot_data num : The ratio of hot records in the hotspot distribution. (default: 0.2)\n");
+  P("  --hot_ops num : The ratio of operations on hot records. (default: 0.8)\n");
+  P("  --value_dist str : The value size distribution: fixed, uniform, zipfian."
+    " (default: fixed)\n");
+  P("  --scan_length num : The maximum number of records of each scan. (default: 100)\n");
+  P("  --histogram str : Writes the latency histogram of each operation type into files with"
+    " the prefix.\n");
+  P("  --rate num : Issues operations at the target QPS of all threads.\n");
+  P("  --poisson : Makes the intervals of operations at the target rate exponential.\n");
+  P("\n");
+  P("Options for the async subcommand:\n");
+  P("  --connections num : The number of connections. (default: 1)\n");
+  P("  --depth num : The number of calls in flight on each connection. (default: 100)\n");
+  P("  --random_key : Uses random keys rather than sequential ones.\n");
+  P("  --set_only : Does only setting.\n");
+  P("  --get_only : Does only getting.\n");
+  P("  --remove_only : Does only removing.\n");
+  P("  --histogram str : Writes the latency histogram of each phase into files with the"
+    " prefix.\n");
+  P("\n");
+  P("Options for the lock subcommand:\n");
+  P("  --writes num : The ratio of exclusive locks among all locks. (default: 0)\n");
+  P("  --locks strs : The comma-separated lock types: spin, std, slotted."
+    " (default: spin,std,slotted)\n");
+  P("\n");
+  P("Options for the matrix subcommand:\n");
+  P("  --modes strs : The comma-separated server modes: sync, async. (default: sync,async)\n");
+  P("  --server_threads nums : The comma-separated numbers of server threads. (default: 4)\n");
+  P("  --transports strs : The comma-separated transports: tcp, unix, inproc."
+    " (default: tcp)\n");
+  P("  --workload str : The subcommand and its options to run. (default: sequence)\n");
+  P("\n");
+  P("Options for the compare subcommand:\n");
+  P("  --threshold num : The ratio of change to be a regression. (default: 0.05)\n");
   P("\n");
   P("Options for the wicked subcommand:\n");
   P("  --iterator : Uses iterators occasionally.\n");
@@ -68,15 +157,667 @@ static void PrintUsageAndDie() {
   std::exit(1);
 }
 
+// Histogram of latencies in nanoseconds, like HDR histograms.
+// Each range of powers of two is divided into sub-buckets of the same width, so the relative
+// error of recorded values is less than 1/SUB_BUCKETS in any scale.
+class LatencyHistogram final {
+ public:
+  // The number of bits for the index of the sub-buckets.
+  static constexpr int32_t SUB_BITS = 5;
+  // The number of the sub-buckets in each range.
+  static constexpr int32_t SUB_BUCKETS = 1 << SUB_BITS;
+  // The total number of the buckets to cover all positive 64-bit values.
+  static constexpr int32_t NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+  // Constructor.
+  LatencyHistogram() : counts_(NUM_BUCKETS, 0), count_(0), min_(INT64MAX), max_(0) {}
+
+  // Adds a value.
+  void Add(int64_t value) {
+    value = std::max<int64_t>(value, 0);
+    counts_[GetBucketIndex(value)]++;
+    count_++;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  // Adds all values of another histogram.
+  void Merge(const LatencyHistogram& rhs) {
+    for (int32_t i = 0; i < NUM_BUCKETS; i++) {
+      counts_[i] += rhs.counts_[i];
+    }
+    count_ += rhs.count_;
+    min_ = std::min(min_, rhs.min_);
+    max_ = std::max(max_, rhs.max_);
+  }
+
+  // Gets the number of values.
+  int64_t GetCount() const {
+    return count_;
+  }
+
+  // Gets the minimum value.
+  int64_t GetMin() const {
+    return count_ > 0 ? min_ : 0;
+  }
+
+  // Gets the maximum value.
+  int64_t GetMax() const {
+    return max_;
+  }
+
+  // Gets the value at a percentile, as the upper bound of the bucket.
+  int64_t GetPercentile(double percentile) const {
+    if (count_ < 1) {
+      return 0;
+    }
+    const int64_t rank = std::max<int64_t>(1, std::ceil(count_ * percentile / 100.0));
+    int64_t sum = 0;
+    for (int32_t i = 0; i < NUM_BUCKETS; i++) {
+      sum += counts_[i];
+      if (sum >= rank) {
+        return std::min(GetBucketLowerBound(i + 1) - 1, max_);
+      }
+    }
+    return max_;
+  }
+
+  // Makes a TSV text of the lower bound, the upper bound, the count, and the cumulative ratio
+  // of each non-empty bucket, in microseconds.
+  std::string MakeTSV() const {
+    std::string tsv = "lower_usec\tupper_usec\tcount\tcumulative_ratio\n";
+    int64_t sum = 0;
+    for (int32_t i = 0; i < NUM_BUCKETS; i++) {
+      if (counts_[i] == 0) {
+        continue;
+      }
+      sum += counts_[i];
+      tsv += SPrintF("%.3f\t%.3f\t%lld\t%.6f\n", GetBucketLowerBound(i) / 1000.0,
+                     GetBucketLowerBound(i + 1) / 1000.0, counts_[i], sum * 1.0 / count_);
+    }
+    return tsv;
+  }
+
+ private:
+  // Gets the index of the bucket of a value.
+  static int32_t GetBucketIndex(int64_t value) {
+    if (value < SUB_BUCKETS) {
+      return value;
+    }
+    int32_t exp = 0;
+    while ((value >> exp) >= SUB_BUCKETS * 2) {
+      exp++;
+    }
+    return (exp + 1) * SUB_BUCKETS + (value >> exp) - SUB_BUCKETS;
+  }
+
+  // Gets the lowest value of a bucket.
+  static int64_t GetBucketLowerBound(int32_t index) {
+    if (index < SUB_BUCKETS) {
+      return index;
+    }
+    const int32_t exp = index / SUB_BUCKETS - 1;
+    return static_cast<int64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << exp;
+  }
+
+  std::vector<int64_t> counts_;
+  int64_t count_;
+  int64_t min_;
+  int64_t max_;
+};
+
+// Gets the time in nanoseconds of the monotonic clock.
+static int64_t GetMonotonicNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Pacer to start operations at the intended times of a target rate, for open-loop load.
+// The latency is measured from the intended time, so the time which delayed operations wait
+// for the previous ones is not omitted.
+class OperationPacer final {
+ public:
+  // Constructor.  The rate is operations per second and zero means no pacing.  The phase is
+  // the ratio of the interval to delay the first operation, which spreads threads.
+  OperationPacer(double rate, bool poisson, uint32_t seed, double phase)
+      : interval_(rate > 0 ? 1000000000.0 / rate : 0), poisson_(poisson), mt_(seed),
+        dist_(1.0), next_time_(GetMonotonicNanos() + interval_ * phase) {}
+
+  // Waits for the intended time of the next operation and returns it in nanoseconds.
+  int64_t WaitNext() {
+    if (interval_ <= 0) {
+      return GetMonotonicNanos();
+    }
+    const int64_t intended_time = next_time_;
+    next_time_ += poisson_ ? interval_ * dist_(mt_) : interval_;
+    // Sleeping is not precise so the last part is waited by spinning.
+    const int64_t wait_time = intended_time - GetMonotonicNanos();
+    if (wait_time > SPIN_TIME) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(wait_time - SPIN_TIME));
+    }
+    while (GetMonotonicNanos() < intended_time) {
+      std::this_thread::yield();
+    }
+    return intended_time;
+  }
+
+ private:
+  // The time in nanoseconds to wait by spinning.
+  static constexpr int64_t SPIN_TIME = 100000;
+  double interval_;
+  bool poisson_;
+  std::mt19937 mt_;
+  std::exponential_distribution<double> dist_;
+  double next_time_;
+};
+
+// Generator of ranks in the Zipfian distribution, by the method of Gray et al.
+// Rank 0 is the most frequent.  Generating is thread-safe if each thread has its own RNG.
+class ZipfianGenerator final {
+ public:
+  // Constructor.  The theta is the skew, which must be between 0 and 1 exclusively.
+  ZipfianGenerator(int64_t num_items, double theta)
+      : num_items_(std::max<int64_t>(num_items, 1)), theta_(theta) {
+    const double zeta_two = 1.0 + std::pow(0.5, theta_);
+    zeta_ = 0;
+    for (int64_t i = 1; i <= num_items_; i++) {
+      zeta_ += 1.0 / std::pow(i, theta_);
+    }
+    alpha_ = 1.0 / (1.0 - theta_);
+    eta_ = (1.0 - std::pow(2.0 / num_items_, 1.0 - theta_)) / (1.0 - zeta_two / zeta_);
+    threshold_ = zeta_two;
+  }
+
+  // Generates a rank between 0 and the number of items minus one.
+  int64_t Generate(std::mt19937* mt) const {
+    const double uni = std::uniform_real_distribution<double>(0, 1)(*mt);
+    const double uz = uni * zeta_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < threshold_) {
+      return 1;
+    }
+    const int64_t rank = num_items_ * std::pow(eta_ * uni - eta_ + 1.0, alpha_);
+    return std::min(rank, num_items_ - 1);
+  }
+
+ private:
+  int64_t num_items_;
+  double theta_;
+  double zeta_;
+  double alpha_;
+  double eta_;
+  double threshold_;
+};
+
+// Driver to keep a number of asynchronous calls in flight on a connection.  Each call is
+// issued by the issuer function with the serial number of the call and a callback, and the
+// completion of a call issues the next one.
+class AsyncCallDriver final {
+ public:
+  // Type of the function to issue a call.
+  typedef std::function<void(int64_t, std::function<void(const Status&)>)> Issuer;
+
+  // Constructor.  The acceptable status is treated as success as well as SUCCESS.
+  AsyncCallDriver(int64_t num_calls, int32_t depth, Issuer issuer,
+                  Status::Code acceptable = Status::SUCCESS)
+      : num_calls_(num_calls), depth_(depth), issuer_(std::move(issuer)),
+        acceptable_(acceptable), next_index_(0), num_in_flight_(0),
+        status_(Status::SUCCESS) {}
+
+  // Issues the first calls.
+  void Start() {
+    for (int32_t i = 0; i < depth_; i++) {
+      IssueNext();
+    }
+  }
+
+  // Waits for all calls to finish and returns the first error.
+  Status Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [&]() { return num_in_flight_ == 0; });
+    return status_;
+  }
+
+  // Gets the histogram of the latencies.  It is valid after waiting.
+  const LatencyHistogram& GetHistogram() const {
+    return histogram_;
+  }
+
+ private:
+  // Issues the next call if any.
+  void IssueNext() {
+    int64_t index = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (next_index_ >= num_calls_ || status_ != Status::SUCCESS) {
+        return;
+      }
+      index = next_index_++;
+      num_in_flight_++;
+    }
+    const int64_t start_time = GetMonotonicNanos();
+    issuer_(index, [this, start_time](const Status& status) { Finish(start_time, status); });
+  }
+
+  // Records the result of a call and issues the next one.
+  void Finish(int64_t start_time, const Status& status) {
+    const int64_t latency = GetMonotonicNanos() - start_time;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      histogram_.Add(latency);
+      if (status != Status::SUCCESS && status != acceptable_ && status_ == Status::SUCCESS) {
+        status_ = status;
+      }
+    }
+    // The count is decremented after issuing the next call so that it is zero only at the end.
+    IssueNext();
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_in_flight_--;
+    if (num_in_flight_ == 0) {
+      cond_.notify_all();
+    }
+  }
+
+  int64_t num_calls_;
+  int32_t depth_;
+  Issuer issuer_;
+  Status::Code acceptable_;
+  int64_t next_index_;
+  int64_t num_in_flight_;
+  Status status_;
+  LatencyHistogram histogram_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+// Gets the CPU time in seconds consumed by the process.
+static double GetCPUTime() {
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+// Result of a phase, which is collected to compare configurations and written into files.
+struct PhaseResult {
+  // The label of the server configuration, which is empty unless the matrix subcommand is used.
+  std::string config;
+  // The name of the phase.
+  std::string phase;
+  // The parameters of the phase.
+  std::map<std::string, std::string> params;
+  // The elapsed time in seconds.
+  double elapsed_time;
+  // The number of operations, each of which handles a record.
+  int64_t num_ops;
+  // The number of calls whose latencies are measured, which is less than the number of
+  // operations if a call handles multiple records.
+  int64_t num_calls;
+  // The number of operations per second.
+  double qps;
+  // The CPU time in seconds of the process.
+  double cpu_time;
+  // The increase of the memory usage in bytes.
+  int64_t mem_usage;
+  // The merged latency histogram.
+  LatencyHistogram latency;
+};
+
+// Results of the phases done so far in the process.
+static std::vector<PhaseResult> g_phase_results;
+
+// Makes the parameters of phases from the subcommand name and the command arguments.
+static std::map<std::string, std::string> MakeRunParams(
+    const std::string& subcommand,
+    const std::map<std::string, std::vector<std::string>>& cmd_args) {
+  std::map<std::string, std::string> params;
+  params.emplace("subcommand", subcommand);
+  for (const auto& cmd_arg : cmd_args) {
+    if (!StrBeginsWith(cmd_arg.first, "--") || cmd_arg.first == "--json" ||
+        cmd_arg.first == "--csv") {
+      continue;
+    }
+    params.emplace(cmd_arg.first.substr(2),
+                   cmd_arg.second.empty() ? "true" : StrJoin(cmd_arg.second, " "));
+  }
+  return params;
+}
+
+// Adds the result of a phase.
+static void AddPhaseResult(
+    const std::string& phase, const std::map<std::string, std::string>& params,
+    double elapsed_time, int64_t num_ops, double cpu_time, int64_t mem_usage,
+    const LatencyHistogram& latency) {
+  g_phase_results.emplace_back(PhaseResult{
+      "", phase, params, elapsed_time, num_ops, latency.GetCount(), num_ops / elapsed_time,
+      cpu_time, mem_usage, latency});
+}
+
+// The names and the percentiles of the latency to be written into files.
+const std::vector<std::pair<std::string, double>> RESULT_PERCENTILES = {
+  {"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9},
+};
+
+// Quotes a string as a JSON string literal.
+static std::string QuoteJSON(std::string_view str) {
+  std::string quoted = "\"";
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      quoted += SPrintF("\\u%04x", c);
+    } else {
+      quoted += c;
+    }
+  }
+  quoted += "\"";
+  return quoted;
+}
+
+// Quotes a string as a CSV field.
+static std::string QuoteCSV(std::string_view str) {
+  return StrCat("\"", StrReplace(str, "\"", "\"\""), "\"");
+}
+
+// Splits a line of CSV into fields.
+static std::vector<std::string> SplitCSVLine(std::string_view line) {
+  std::vector<std::string> fields(1);
+  bool quoted = false;
+  for (size_t i = 0; i < line.size(); i++) {
+    const char c = line[i];
+    if (quoted) {
+      if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+        fields.back() += c;
+        i++;
+      } else if (c == '"') {
+        quoted = false;
+      } else {
+        fields.back() += c;
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      fields.emplace_back();
+    } else if (c != '\r') {
+      fields.back() += c;
+    }
+  }
+  return fields;
+}
+
+// Makes JSON data of the results of phases.
+static std::string MakeResultsJSON(const std::vector<PhaseResult>& results) {
+  std::string json = "[\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& result = results[i];
+    std::vector<std::string> params;
+    for (const auto& param : result.params) {
+      params.emplace_back(StrCat(QuoteJSON(param.first), ": ", QuoteJSON(param.second)));
+    }
+    std::vector<std::string> latency;
+    latency.emplace_back(SPrintF("\"min\": %.3f", result.latency.GetMin() / 1000.0));
+    for (const auto& percentile : RESULT_PERCENTILES) {
+      latency.emplace_back(SPrintF("\"%s\": %.3f", percentile.first.c_str(),
+                                   result.latency.GetPercentile(percentile.second) / 1000.0));
+    }
+    latency.emplace_back(SPrintF("\"max\": %.3f", result.latency.GetMax() / 1000.0));
+    json += StrCat("  {\"config\": ", QuoteJSON(result.config),
+                   ", \"phase\": ", QuoteJSON(result.phase),
+                   ", \"params\": {", StrJoin(params, ", "), "}");
+    json += SPrintF(", \"elapsed_time\": %.6f, \"num_ops\": %lld, \"num_calls\": %lld"
+                    ", \"qps\": %.3f, \"cpu_time\": %.6f, \"mem_usage\": %lld",
+                    result.elapsed_time, result.num_ops, result.num_calls, result.qps,
+                    result.cpu_time, result.mem_usage);
+    json += StrCat(", \"latency_usec\": {", StrJoin(latency, ", "), "}}");
+    json += i + 1 < results.size() ? ",\n" : "\n";
+  }
+  json += "]\n";
+  return json;
+}
+
+// Makes CSV data of the results of phases.
+static std::string MakeResultsCSV(const std::vector<PhaseResult>& results) {
+  std::string csv = "config,phase,params,elapsed_time,num_ops,num_calls,qps,cpu_time"
+      ",mem_usage,latency_min";
+  for (const auto& percentile : RESULT_PERCENTILES) {
+    csv += StrCat(",latency_", percentile.first);
+  }
+  csv += ",latency_max\n";
+  for (const auto& result : results) {
+    std::vector<std::string> params;
+    for (const auto& param : result.params) {
+      params.emplace_back(StrCat(param.first, "=", param.second));
+    }
+    csv += StrCat(QuoteCSV(result.config), ",", QuoteCSV(result.phase), ",",
+                  QuoteCSV(StrJoin(params, ";")));
+    csv += SPrintF(",%.6f,%lld,%lld,%.3f,%.6f,%lld,%.3f", result.elapsed_time,
+                   result.num_ops, result.num_calls, result.qps, result.cpu_time,
+                   result.mem_usage, result.latency.GetMin() / 1000.0);
+    for (const auto& percentile : RESULT_PERCENTILES) {
+      csv += SPrintF(",%.3f", result.latency.GetPercentile(percentile.second) / 1000.0);
+    }
+    csv += SPrintF(",%.3f\n", result.latency.GetMax() / 1000.0);
+  }
+  return csv;
+}
+
+// Writes the results of phases into the files given by the command arguments.
+static bool WritePhaseResults(
+    const std::map<std::string, std::vector<std::string>>& cmd_args,
+    const std::vector<PhaseResult>& results) {
+  bool ok = true;
+  const std::string json_path = GetStringArgument(cmd_args, "--json", 0, "");
+  if (!json_path.empty()) {
+    const Status status = WriteFile(json_path, MakeResultsJSON(results));
+    if (status != Status::SUCCESS) {
+      EPrintL("WriteFile failed: ", json_path, ": ", status);
+      ok = false;
+    }
+  }
+  const std::string csv_path = GetStringArgument(cmd_args, "--csv", 0, "");
+  if (!csv_path.empty()) {
+    const Status status = WriteFile(csv_path, MakeResultsCSV(results));
+    if (status != Status::SUCCESS) {
+      EPrintL("WriteFile failed: ", csv_path, ": ", status);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// Merges the histograms of the threads, prints the percentiles, and writes the histogram.
+static LatencyHistogram PrintLatency(
+    const std::vector<LatencyHistogram>& histograms, const std::string& histogram_prefix,
+    const std::string& phase, const std::string& label = "Latency") {
+  LatencyHistogram merged;
+  for (const auto& histogram : histograms) {
+    merged.Merge(histogram);
+  }
+  PrintF("%s: num_calls=%lld min=%.3f p50=%.3f p90=%.3f p99=%.3f p99.9=%.3f max=%.3f"
+         " (usec)\n", label.c_str(), merged.GetCount(), merged.GetMin() / 1000.0,
+         merged.GetPercentile(50) / 1000.0, merged.GetPercentile(90) / 1000.0,
+         merged.GetPercentile(99) / 1000.0, merged.GetPercentile(99.9) / 1000.0,
+         merged.GetMax() / 1000.0);
+  if (!histogram_prefix.empty()) {
+    const std::string path = StrCat(histogram_prefix, "-", phase, ".tsv");
+    const Status status = WriteFile(path, merged.MakeTSV());
+    if (status != Status::SUCCESS) {
+      EPrintL("WriteFile failed: ", path, ": ", status);
+    }
+  }
+  return merged;
+}
+
+// Database service hosted in the process.
+class InProcessService final {
+ public:
+  // Opens the databases and starts the service.  If the listening address is empty, the
+  // in-process channel is used.  Otherwise, the address is like "127.0.0.1:0" for TCP, where
+  // the port zero means a free port, or "unix:/tmp/perf.sock" for a UNIX domain socket.
+  Status Start(const std::vector<std::string>& dbm_exprs, const std::string& name,
+               bool with_async = false, int32_t num_threads = 1,
+               const std::string& listen_address = "") {
+    for (const auto& dbm_expr : dbm_exprs) {
+      const std::vector<std::string> fields = StrSplit(dbm_expr, "#");
+      std::map<std::string, std::string> params;
+      if (fields.size() > 1) {
+        params = StrSplitIntoMap(fields[1], ",", "=");
+      }
+      auto dbm = std::make_unique<PolyDBM>();
+      const Status status =
+          dbm->OpenAdvanced(fields.front(), true, File::OPEN_DEFAULT, params);
+      if (status != Status::SUCCESS) {
+        Stop();
+        return status;
+      }
+      dbms_.emplace_back(std::move(dbm));
+    }
+    grpc::ServerBuilder builder;
+    int32_t port = 0;
+    if (!listen_address.empty()) {
+      builder.AddListeningPort(listen_address, grpc::InsecureServerCredentials(), &port);
+    }
+    if (with_async) {
+      service_ = std::make_unique<DBMAsyncServiceImpl>(dbms_, &logger_, 1, nullptr);
+      builder.RegisterService(service_.get());
+      queues_.resize(num_threads);
+      for (auto& queue : queues_) {
+        queue = builder.AddCompletionQueue();
+      }
+    } else {
+      builder.SetSyncServerOption(
+          grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, num_threads);
+      service_ = std::make_unique<DBMServiceImpl>(dbms_, &logger_, 1, nullptr);
+      builder.RegisterService(service_.get());
+    }
+    server_ = builder.BuildAndStart();
+    if (server_ == nullptr) {
+      Stop();
+      return Status(Status::NETWORK_ERROR, "BuildAndStart failed");
+    }
+    if (listen_address.empty()) {
+      name_ = name;
+      RemoteDBM::RegisterInProcessServer(name_, server_.get());
+      address_ = StrCat("inproc:", name_);
+    } else if (StrBeginsWith(listen_address, "unix:")) {
+      socket_path_ = listen_address.substr(5);
+      address_ = listen_address;
+    } else {
+      address_ = StrCat(listen_address.substr(0, listen_address.rfind(':')), ":", port);
+    }
+    auto* async_service = dynamic_cast<DBMAsyncServiceImpl*>(service_.get());
+    for (auto& queue : queues_) {
+      grpc::ServerCompletionQueue* queue_ptr = queue.get();
+      threads_.emplace_back([this, async_service, queue_ptr]() {
+        async_service->OperateQueue(queue_ptr, &is_shutdown_);
+      });
+    }
+    return Status(Status::SUCCESS);
+  }
+
+  // Gets the address to connect to the service.
+  const std::string& GetAddress() const {
+    return address_;
+  }
+
+  // Stops the service and closes the databases.
+  void Stop() {
+    if (server_ != nullptr) {
+      if (!name_.empty()) {
+        RemoteDBM::RegisterInProcessServer(name_, nullptr);
+        name_.clear();
+      }
+      is_shutdown_ = true;
+      server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+      for (auto& thread : threads_) {
+        thread.join();
+      }
+      threads_.clear();
+      auto* async_service = dynamic_cast<DBMAsyncServiceImpl*>(service_.get());
+      for (auto& queue : queues_) {
+        async_service->ShutdownQueue(queue.get());
+      }
+      queues_.clear();
+      server_.reset(nullptr);
+      is_shutdown_ = false;
+    }
+    service_.reset(nullptr);
+    for (auto& dbm : dbms_) {
+      dbm->Close();
+    }
+    dbms_.clear();
+    if (!socket_path_.empty()) {
+      RemoveFile(socket_path_);
+      socket_path_.clear();
+    }
+    address_.clear();
+  }
+
+  // Destructor.
+  ~InProcessService() {
+    Stop();
+  }
+
+ private:
+  std::vector<std::unique_ptr<ParamDBM>> dbms_;
+  StreamLogger logger_;
+  std::unique_ptr<grpc::Service> service_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::unique_ptr<grpc::Server> server_;
+  bool is_shutdown_ = false;
+  std::string name_;
+  std::string socket_path_;
+  std::string address_;
+};
+
+// Makes the connection options from the command arguments.
+static RemoteDBM::ConnectOptions MakeConnectOptions(
+    const std::map<std::string, std::vector<std::string>>& cmd_args) {
+  RemoteDBM::ConnectOptions options;
+  options.call_timeout = GetDoubleArgument(cmd_args, "--timeout", 0, -1);
+  options.connect_timeout =
+      GetDoubleArgument(cmd_args, "--connect_timeout", 0, options.call_timeout);
+  options.num_channels = GetIntegerArgument(cmd_args, "--channels", 0, 1);
+  const int32_t max_message_size = GetIntegerArgument(cmd_args, "--max_message_size", 0, 0);
+  options.max_send_message_size = max_message_size;
+  options.max_receive_message_size = max_message_size;
+  options.keepalive_time = GetDoubleArgument(cmd_args, "--keepalive", 0, 0);
+  options.keepalive_without_calls = CheckMap(cmd_args, "--keepalive_idle");
+  options.compression = GetStringArgument(cmd_args, "--compression", 0, "");
+  options.load_balancing_policy = GetStringArgument(cmd_args, "--lb_policy", 0, "");
+  return options;
+}
+
+// Starts the in-process service if the option is given, and gets the address to connect to.
+static std::string PrepareAddress(
+    const std::map<std::string, std::vector<std::string>>& cmd_args,
+    InProcessService* inproc_service) {
+  const std::string inproc_expr = GetStringArgument(cmd_args, "--inproc", 0, "");
+  if (inproc_expr.empty()) {
+    return GetStringArgument(cmd_args, "--address", 0, "localhost:1978");
+  }
+  const Status status = inproc_service->Start({inproc_expr}, "tkrzw_dbm_remote_perf");
+  if (status != Status::SUCCESS) {
+    Die("InProcessService::Start failed: ", status);
+  }
+  return inproc_service->GetAddress();
+}
+
 // Processes the sequence subcommand.
 static int32_t ProcessSequence(int32_t argc, const char** args) {
   const std::map<std::string, int32_t>& cmd_configs = {
     {"", 0}, {"--address", 1}, {"--timeout", 1}, {"--index", 1},
-    {"--iter", 1}, {"--size", 1}, {"--threads", 1}, {"--separate", 0},
-    {"--random_seed", 1}, {"--random_key", 0}, {"--random_value", 0},
+    {"--iter", 1}, {"--size", 1}, {"--threads", 1}, {"--separate", 0}, {"--channels", 1},
+    {"--connect_timeout", 1}, {"--max_message_size", 1}, {"--keepalive", 1},
+    {"--keepalive_idle", 0}, {"--compression", 1}, {"--lb_policy", 1},
+    {"--random_seed", 1}, {"--inproc", 1}, {"--random_key", 0}, {"--random_value", 0},
     {"--echo_only", 0}, {"--set_only", 0}, {"--get_only", 0},
     {"--iter_only", 0}, {"--remove_only", 0},
     {"--stream", 0}, {"--ignore_result", 0}, {"--multi", 1},
+    {"--cache", 1}, {"--cache_staleness", 1}, {"--histogram", 1},
+    {"--rate", 1}, {"--poisson", 0},
+    {"--json", 1}, {"--csv", 1},
   };
   std::map<std::string, std::vector<std::string>> cmd_args;
   std::string cmd_error;
@@ -84,8 +825,9 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     EPrint("Invalid command: ", cmd_error, "\n\n");
     PrintUsageAndDie();
   }
-  const std::string address = GetStringArgument(cmd_args, "--address", 0, "localhost:1978");
-  const double timeout = GetDoubleArgument(cmd_args, "--timeout", 0, -1);
+  InProcessService inproc_service;
+  const std::string address = PrepareAddress(cmd_args, &inproc_service);
+  const RemoteDBM::ConnectOptions connect_options = MakeConnectOptions(cmd_args);
   const int32_t dbm_index = GetIntegerArgument(cmd_args, "--index", 0, 0);
   const int32_t num_iterations = GetIntegerArgument(cmd_args, "--iter", 0, 10000);
   const int32_t value_size = GetIntegerArgument(cmd_args, "--size", 0, 8);
@@ -102,6 +844,17 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
   const bool with_stream = CheckMap(cmd_args, "--stream");
   const bool ignore_result = CheckMap(cmd_args, "--ignore_result");
   const int32_t num_multi = GetIntegerArgument(cmd_args, "--multi", 0, 0);
+  const int64_t cache_capacity = GetIntegerArgument(cmd_args, "--cache", 0, 0);
+  const double cache_staleness = GetDoubleArgument(cmd_args, "--cache_staleness", 0, 1.0);
+  const std::string histogram_prefix = GetStringArgument(cmd_args, "--histogram", 0, "");
+  std::vector<double> rates;
+  for (const auto& rate_expr : StrSplit(GetStringArgument(cmd_args, "--rate", 0, ""), ",", true)) {
+    rates.emplace_back(StrToDouble(rate_expr));
+  }
+  if (rates.empty()) {
+    rates.emplace_back(0);
+  }
+  const bool with_poisson = CheckMap(cmd_args, "--poisson");
   if (num_iterations < 1) {
     Die("Invalid number of iterations");
   }
@@ -111,6 +864,11 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
   if (num_threads < 1) {
     Die("Invalid number of threads");
   }
+  for (const double rate : rates) {
+    if (rate < 0) {
+      Die("Invalid rate");
+    }
+  }
   if (!echo_only && !set_only && !get_only && !iter_only && !remove_only) {
     echo_only = true;
     set_only = true;
@@ -120,20 +878,51 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
   }
   const int64_t start_mem_rss = GetMemoryUsage();
   RemoteDBM dbm;
-  Status status = dbm.Connect(address, timeout);
+  Status status = dbm.Connect(address, connect_options);
   if (status != Status::SUCCESS) {
     EPrintL("Connect failed: ", status);
     return 1;
   }
   dbm.SetDBMIndex(dbm_index);
+  if (cache_capacity > 0) {
+    dbm.EnableCache(cache_capacity, cache_staleness);
+  }
   std::atomic_bool has_error(false);
   const int32_t dot_mod = std::max(num_iterations / 1000, 1);
   const int32_t fold_mod = std::max(num_iterations / 20, 1);
+  // Each thread records latencies into its own histogram, which are merged after each phase.
+  std::vector<LatencyHistogram> histograms;
+  // Each phase is done for each target rate, where zero means the closed loop.
+  double phase_rate = 0;
+  std::vector<std::string> sweep_lines;
+  auto make_phase_name = [&](const std::string& name) {
+    return rates.size() > 1 ? SPrintF("%s-%.0f", name.c_str(), phase_rate) : name;
+  };
+  auto make_rate_expr = [&]() {
+    if (phase_rate <= 0) {
+      return std::string("");
+    }
+    return SPrintF(" target_qps=%.0f arrival=%s", phase_rate, with_poisson ? "poisson" : "fixed");
+  };
+  const std::map<std::string, std::string> run_params = MakeRunParams(args[0], cmd_args);
+  auto add_phase_result = [&](const std::string& name, double elapsed_time, double cpu_time,
+                              int64_t mem_usage, const LatencyHistogram& latency) {
+    const int64_t num_ops = static_cast<int64_t>(num_iterations) * num_threads;
+    const double qps = num_ops / elapsed_time;
+    std::map<std::string, std::string> params = run_params;
+    params["target_qps"] = SPrintF("%.0f", phase_rate);
+    AddPhaseResult(make_phase_name(name), params, elapsed_time, num_ops, cpu_time, mem_usage,
+                   latency);
+    sweep_lines.emplace_back(SPrintF(
+        "%-12s %10.0f %10.0f %10.3f %10.3f %10.3f %10.3f", name.c_str(), phase_rate, qps,
+        latency.GetPercentile(50) / 1000.0, latency.GetPercentile(90) / 1000.0,
+        latency.GetPercentile(99) / 1000.0, latency.GetPercentile(99.9) / 1000.0));
+  };
   auto echoing_task = [&](int32_t id) {
     RemoteDBM stack_dbm;
     RemoteDBM* task_dbm = &dbm;
     if (with_separate && id > 0) {
-      const Status status = stack_dbm.Connect(address, timeout);
+      const Status status = stack_dbm.Connect(address, connect_options);
       if (status != Status::SUCCESS) {
         EPrintL("Connect failed: ", status);
         return;
@@ -142,6 +931,8 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     }
     const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
     std::mt19937 key_mt(mt_seed + id);
+    OperationPacer pacer(phase_rate / num_threads, with_poisson, mt_seed * 3 + id,
+                         static_cast<double>(id) / num_threads);
     std::mt19937 misc_mt(mt_seed * 2 + id + 1);
     std::uniform_int_distribution<int32_t> key_num_dist(0, num_iterations * num_threads - 1);
     std::uniform_int_distribution<int32_t> value_size_dist(0, value_size);
@@ -149,10 +940,11 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     bool midline = false;
     std::unique_ptr<tkrzw::RemoteDBM::Stream> stream;
     for (int32_t i = 0; !has_error && i < num_iterations; i++) {
+      if (with_stream && i % 100 == 0) {
+        stream = task_dbm->MakeStream();
+      }
+      const int64_t op_start_time = pacer.WaitNext();
       if (with_stream) {
-        if (i % 100 == 0) {
-          stream = task_dbm->MakeStream();
-        }
         const int32_t key_num = is_random_key ? key_num_dist(key_mt) : i * num_threads + id;
         const size_t key_size = std::sprintf(key_buf, "%08d", key_num);
         const std::string_view key(key_buf, key_size);
@@ -191,6 +983,9 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
           break;
         }
       }
+      if (with_stream || num_multi < 1 || i % num_multi == 0) {
+        histograms[id].Add(GetMonotonicNanos() - op_start_time);
+      }
       if (id == 0 && (i + 1) % dot_mod == 0) {
         PutChar('.');
         midline = true;
@@ -204,10 +999,12 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
       PrintF(" (%08d)\n", num_iterations);
     }
   };
-  if (echo_only) {
-    PrintF("Echoing: num_iterations=%d value_size=%d num_threads=%d\n",
-           num_iterations, value_size, num_threads);
+  auto run_echoing = [&]() {
+    PrintF("Echoing: num_iterations=%d value_size=%d num_threads=%d%s\n",
+           num_iterations, value_size, num_threads, make_rate_expr().c_str());
+    histograms.assign(num_threads, LatencyHistogram());
     const double start_time = GetWallTime();
+    const double start_cpu_time = GetCPUTime();
     std::vector<std::thread> threads;
     for (int32_t i = 0; i < num_threads; i++) {
       threads.emplace_back(std::thread(echoing_task, i));
@@ -217,17 +1014,21 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     }
     const double end_time = GetWallTime();
     const double elapsed_time = end_time - start_time;
+    const double cpu_time = GetCPUTime() - start_cpu_time;
     const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
     PrintF("Echoing done: elapsed_time=%.6f qps=%.0f mem=%lld\n",
            elapsed_time, num_iterations * num_threads / elapsed_time,
            mem_usage);
+    const LatencyHistogram latency =
+        PrintLatency(histograms, histogram_prefix, make_phase_name("echoing"));
+    add_phase_result("echoing", elapsed_time, cpu_time, mem_usage, latency);
     PrintL();
-  }
+  };
   auto setting_task = [&](int32_t id) {
     RemoteDBM stack_dbm;
     RemoteDBM* task_dbm = &dbm;
     if (with_separate && id > 0) {
-      const Status status = stack_dbm.Connect(address, timeout);
+      const Status status = stack_dbm.Connect(address, connect_options);
       if (status != Status::SUCCESS) {
         EPrintL("Connect failed: ", status);
         return;
@@ -236,6 +1037,8 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     }
     const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
     std::mt19937 key_mt(mt_seed + id);
+    OperationPacer pacer(phase_rate / num_threads, with_poisson, mt_seed * 3 + id,
+                         static_cast<double>(id) / num_threads);
     std::mt19937 misc_mt(mt_seed * 2 + id + 1);
     std::uniform_int_distribution<int32_t> key_num_dist(0, num_iterations * num_threads - 1);
     std::uniform_int_distribution<int32_t> value_size_dist(0, value_size);
@@ -248,10 +1051,11 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     bool midline = false;
     std::unique_ptr<tkrzw::RemoteDBM::Stream> stream;
     for (int32_t i = 0; !has_error && i < num_iterations; i++) {
+      if (with_stream && i % 100 == 0) {
+        stream = task_dbm->MakeStream();
+      }
+      const int64_t op_start_time = pacer.WaitNext();
       if (with_stream) {
-        if (i % 100 == 0) {
-          stream = task_dbm->MakeStream();
-        }
         const int32_t key_num = is_random_key ? key_num_dist(key_mt) : i * num_threads + id;
         const size_t key_size = std::sprintf(key_buf, "%08d", key_num);
         const std::string_view key(key_buf, key_size);
@@ -296,6 +1100,9 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
           break;
         }
       }
+      if (with_stream || num_multi < 1 || i % num_multi == 0) {
+        histograms[id].Add(GetMonotonicNanos() - op_start_time);
+      }
       if (id == 0 && (i + 1) % dot_mod == 0) {
         PutChar('.');
         midline = true;
@@ -310,10 +1117,12 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     }
     delete[] value_buf;
   };
-  if (set_only) {
-    PrintF("Setting: num_iterations=%d value_size=%d num_threads=%d\n",
-           num_iterations, value_size, num_threads);
+  auto run_setting = [&]() {
+    PrintF("Setting: num_iterations=%d value_size=%d num_threads=%d%s\n",
+           num_iterations, value_size, num_threads, make_rate_expr().c_str());
+    histograms.assign(num_threads, LatencyHistogram());
     const double start_time = GetWallTime();
+    const double start_cpu_time = GetCPUTime();
     std::vector<std::thread> threads;
     for (int32_t i = 0; i < num_threads; i++) {
       threads.emplace_back(std::thread(setting_task, i));
@@ -324,35 +1133,45 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     const double end_time = GetWallTime();
     const double elapsed_time = end_time - start_time;
     const int64_t num_records = dbm.CountSimple();
+    const double cpu_time = GetCPUTime() - start_cpu_time;
     const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
     PrintF("Setting done: elapsed_time=%.6f num_records=%lld qps=%.0f mem=%lld\n",
            elapsed_time, num_records, num_iterations * num_threads / elapsed_time,
            mem_usage);
+    const LatencyHistogram latency =
+        PrintLatency(histograms, histogram_prefix, make_phase_name("setting"));
+    add_phase_result("setting", elapsed_time, cpu_time, mem_usage, latency);
     PrintL();
-  }
+  };
   auto getting_task = [&](int32_t id) {
     RemoteDBM stack_dbm;
     RemoteDBM* task_dbm = &dbm;
     if (with_separate && id > 0) {
-      const Status status = stack_dbm.Connect(address, timeout);
+      const Status status = stack_dbm.Connect(address, connect_options);
       if (status != Status::SUCCESS) {
         EPrintL("Connect failed: ", status);
         return;
       }
+      if (cache_capacity > 0) {
+        stack_dbm.EnableCache(cache_capacity, cache_staleness);
+      }
       task_dbm = &stack_dbm;
     }
     const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
     std::mt19937 key_mt(mt_seed + id);
+    OperationPacer pacer(phase_rate / num_threads, with_poisson, mt_seed * 3 + id,
+                         static_cast<double>(id) / num_threads);
     std::uniform_int_distribution<int32_t> key_num_dist(0, num_iterations * num_threads - 1);
     std::uniform_int_distribution<int32_t> value_size_dist(0, value_size);
     char key_buf[32];
     bool midline = false;
     std::unique_ptr<tkrzw::RemoteDBM::Stream> stream;
     for (int32_t i = 0; !has_error && i < num_iterations; i++) {
+      if (with_stream && i % 100 == 0) {
+        stream = task_dbm->MakeStream();
+      }
+      const int64_t op_start_time = pacer.WaitNext();
       if (with_stream) {
-        if (i % 100 == 0) {
-          stream = task_dbm->MakeStream();
-        }
         const int32_t key_num = is_random_key ? key_num_dist(key_mt) : i * num_threads + id;
         const size_t key_size = std::sprintf(key_buf, "%08d", key_num);
         const std::string_view key(key_buf, key_size);
@@ -394,6 +1213,9 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
           break;
         }
       }
+      if (with_stream || num_multi < 1 || i % num_multi == 0) {
+        histograms[id].Add(GetMonotonicNanos() - op_start_time);
+      }
       if (id == 0 && (i + 1) % dot_mod == 0) {
         PutChar('.');
         midline = true;
@@ -407,10 +1229,14 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
       PrintF(" (%08d)\n", num_iterations);
     }
   };
-  if (get_only) {
-    PrintF("Getting: num_iterations=%d value_size=%d num_threads=%d\n",
-           num_iterations, value_size, num_threads);
+  // With the cache, the second round of getting measures the client-side path of cache hits.
+  const int32_t num_get_rounds = get_only ? (cache_capacity > 0 ? 2 : 1) : 0;
+  auto run_getting = [&](int32_t round) {
+    PrintF("Getting: num_iterations=%d value_size=%d num_threads=%d round=%d%s\n",
+           num_iterations, value_size, num_threads, round + 1, make_rate_expr().c_str());
+    histograms.assign(num_threads, LatencyHistogram());
     const double start_time = GetWallTime();
+    const double start_cpu_time = GetCPUTime();
     std::vector<std::thread> threads;
     for (int32_t i = 0; i < num_threads; i++) {
       threads.emplace_back(std::thread(getting_task, i));
@@ -421,17 +1247,31 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     const double end_time = GetWallTime();
     const double elapsed_time = end_time - start_time;
     const int64_t num_records = dbm.CountSimple();
+    const double cpu_time = GetCPUTime() - start_cpu_time;
     const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
     PrintF("Getting done: elapsed_time=%.6f num_records=%lld qps=%.0f mem=%lld\n",
            elapsed_time, num_records, num_iterations * num_threads / elapsed_time,
            mem_usage);
+    const std::string get_name = num_get_rounds > 1 ? StrCat("getting", round + 1) : "getting";
+    const LatencyHistogram latency =
+        PrintLatency(histograms, histogram_prefix, make_phase_name(get_name));
+    add_phase_result(get_name, elapsed_time, cpu_time, mem_usage, latency);
+    if (cache_capacity > 0) {
+      std::vector<std::pair<std::string, std::string>> client_records;
+      dbm.InspectClient(&client_records);
+      for (const auto& record : client_records) {
+        if (record.first == "cache_hit_rate") {
+          PrintL("Cache hit rate: ", record.second);
+        }
+      }
+    }
     PrintL();
-  }
+  };
   auto iterating_task = [&](int32_t id) {
     RemoteDBM stack_dbm;
     RemoteDBM* task_dbm = &dbm;
     if (with_separate && id > 0) {
-      const Status status = stack_dbm.Connect(address, timeout);
+      const Status status = stack_dbm.Connect(address, connect_options);
       if (status != Status::SUCCESS) {
         EPrintL("Connect failed: ", status);
         return;
@@ -440,6 +1280,8 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     }
     const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
     std::mt19937 key_mt(mt_seed + id);
+    OperationPacer pacer(phase_rate / num_threads, with_poisson, mt_seed * 3 + id,
+                         static_cast<double>(id) / num_threads);
     std::uniform_int_distribution<int32_t> key_num_dist(0, num_iterations * num_threads - 1);
     std::uniform_int_distribution<int32_t> value_size_dist(0, value_size);
     char key_buf[32];
@@ -449,6 +1291,7 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
       if (i % 100 == 0) {
         iter = task_dbm->MakeIterator();
       }
+      const int64_t op_start_time = pacer.WaitNext();
       const int32_t key_num = is_random_key ? key_num_dist(key_mt) : i * num_threads + id;
       const size_t key_size = std::sprintf(key_buf, "%08d", key_num);
       const std::string_view key(key_buf, key_size);
@@ -467,6 +1310,7 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
         has_error = true;
         break;
       }
+      histograms[id].Add(GetMonotonicNanos() - op_start_time);
       if (id == 0 && (i + 1) % dot_mod == 0) {
         PutChar('.');
         midline = true;
@@ -480,10 +1324,12 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
       PrintF(" (%08d)\n", num_iterations);
     }
   };
-  if (iter_only) {
-    PrintF("Iterating: num_iterations=%d value_size=%d num_threads=%d\n",
-           num_iterations, value_size, num_threads);
+  auto run_iterating = [&]() {
+    PrintF("Iterating: num_iterations=%d value_size=%d num_threads=%d%s\n",
+           num_iterations, value_size, num_threads, make_rate_expr().c_str());
+    histograms.assign(num_threads, LatencyHistogram());
     const double start_time = GetWallTime();
+    const double start_cpu_time = GetCPUTime();
     std::vector<std::thread> threads;
     for (int32_t i = 0; i < num_threads; i++) {
       threads.emplace_back(std::thread(iterating_task, i));
@@ -494,17 +1340,21 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     const double end_time = GetWallTime();
     const double elapsed_time = end_time - start_time;
     const int64_t num_records = dbm.CountSimple();
+    const double cpu_time = GetCPUTime() - start_cpu_time;
     const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
     PrintF("Iterating done: elapsed_time=%.6f num_records=%lld qps=%.0f mem=%lld\n",
            elapsed_time, num_records, num_iterations * num_threads / elapsed_time,
            mem_usage);
+    const LatencyHistogram latency =
+        PrintLatency(histograms, histogram_prefix, make_phase_name("iterating"));
+    add_phase_result("iterating", elapsed_time, cpu_time, mem_usage, latency);
     PrintL();
-  }
+  };
   auto removing_task = [&](int32_t id) {
     RemoteDBM stack_dbm;
     RemoteDBM* task_dbm = &dbm;
     if (with_separate && id > 0) {
-      const Status status = stack_dbm.Connect(address, timeout);
+      const Status status = stack_dbm.Connect(address, connect_options);
       if (status != Status::SUCCESS) {
         EPrintL("Connect failed: ", status);
         return;
@@ -513,16 +1363,19 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     }
     const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
     std::mt19937 key_mt(mt_seed + id);
+    OperationPacer pacer(phase_rate / num_threads, with_poisson, mt_seed * 3 + id,
+                         static_cast<double>(id) / num_threads);
     std::uniform_int_distribution<int32_t> key_num_dist(0, num_iterations * num_threads - 1);
     std::uniform_int_distribution<int32_t> value_size_dist(0, value_size);
     char key_buf[32];
     bool midline = false;
     std::unique_ptr<tkrzw::RemoteDBM::Stream> stream;
     for (int32_t i = 0; !has_error && i < num_iterations; i++) {
+      if (with_stream && i % 100 == 0) {
+        stream = task_dbm->MakeStream();
+      }
+      const int64_t op_start_time = pacer.WaitNext();
       if (with_stream) {
-        if (i % 100 == 0) {
-          stream = task_dbm->MakeStream();
-        }
         const int32_t key_num = is_random_key ? key_num_dist(key_mt) : i * num_threads + id;
         const size_t key_size = std::sprintf(key_buf, "%08d", key_num);
         const std::string_view key(key_buf, key_size);
@@ -558,6 +1411,9 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
           break;
         }
       }
+      if (with_stream || num_multi < 1 || i % num_multi == 0) {
+        histograms[id].Add(GetMonotonicNanos() - op_start_time);
+      }
       if (id == 0 && (i + 1) % dot_mod == 0) {
         PutChar('.');
         midline = true;
@@ -571,10 +1427,12 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
       PrintF(" (%08d)\n", num_iterations);
     }
   };
-  if (remove_only) {
-    PrintF("Removing: num_iterations=%d value_size=%d num_threads=%d\n",
-           num_iterations, value_size, num_threads);
+  auto run_removing = [&]() {
+    PrintF("Removing: num_iterations=%d value_size=%d num_threads=%d%s\n",
+           num_iterations, value_size, num_threads, make_rate_expr().c_str());
+    histograms.assign(num_threads, LatencyHistogram());
     const double start_time = GetWallTime();
+    const double start_cpu_time = GetCPUTime();
     std::vector<std::thread> threads;
     for (int32_t i = 0; i < num_threads; i++) {
       threads.emplace_back(std::thread(removing_task, i));
@@ -585,12 +1443,47 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
     const double end_time = GetWallTime();
     const double elapsed_time = end_time - start_time;
     const int64_t num_records = dbm.CountSimple();
+    const double cpu_time = GetCPUTime() - start_cpu_time;
     const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
     PrintF("Removing done: elapsed_time=%.6f num_records=%lld qps=%.0f mem=%lld\n",
            elapsed_time, num_records, num_iterations * num_threads / elapsed_time,
            mem_usage);
+    const LatencyHistogram latency =
+        PrintLatency(histograms, histogram_prefix, make_phase_name("removing"));
+    add_phase_result("removing", elapsed_time, cpu_time, mem_usage, latency);
+    PrintL();
+  };
+  // Each target rate runs the whole sequence of phases so that every rate of getting and
+  // removing operates on the records set at the same rate.
+  for (const double rate : rates) {
+    phase_rate = rate;
+    if (echo_only) {
+      run_echoing();
+    }
+    if (set_only) {
+      run_setting();
+    }
+    for (int32_t round = 0; round < num_get_rounds; round++) {
+      run_getting(round);
+    }
+    if (iter_only) {
+      run_iterating();
+    }
+    if (remove_only) {
+      run_removing();
+    }
+  }
+  if (rates.size() > 1) {
+    PrintF("%-12s %10s %10s %10s %10s %10s %10s\n", "phase", "target_qps", "qps",
+           "p50", "p90", "p99", "p99.9");
+    for (const auto& line : sweep_lines) {
+      PrintL(line);
+    }
     PrintL();
   }
+  if (!WritePhaseResults(cmd_args, g_phase_results)) {
+    has_error = true;
+  }
   return has_error ? 1 : 0;
 }
 
@@ -598,7 +1491,10 @@ static int32_t ProcessSequence(int32_t argc, const char** args) {
 static int32_t ProcessWicked(int32_t argc, const char** args) {
   const std::map<std::string, int32_t>& cmd_configs = {
     {"", 0}, {"--address", 1}, {"--timeout", 1}, {"--index", 1},
-    {"--iter", 1}, {"--size", 1}, {"--threads", 1}, {"--separate", 0}, {"--random_seed", 1},
+    {"--iter", 1}, {"--size", 1}, {"--threads", 1}, {"--separate", 0}, {"--channels", 1},
+    {"--connect_timeout", 1}, {"--max_message_size", 1}, {"--keepalive", 1},
+    {"--keepalive_idle", 0}, {"--compression", 1}, {"--lb_policy", 1},
+    {"--random_seed", 1}, {"--inproc", 1},
     {"--iterator", 0}, {"--sync", 0}, {"--clear", 0}, {"--rebuild", 0},
   };
   std::map<std::string, std::vector<std::string>> cmd_args;
@@ -607,8 +1503,9 @@ static int32_t ProcessWicked(int32_t argc, const char** args) {
     EPrint("Invalid command: ", cmd_error, "\n\n");
     PrintUsageAndDie();
   }
-  const std::string address = GetStringArgument(cmd_args, "--address", 0, "localhost:1978");
-  const double timeout = GetDoubleArgument(cmd_args, "--timeout", 0, -1);
+  InProcessService inproc_service;
+  const std::string address = PrepareAddress(cmd_args, &inproc_service);
+  const RemoteDBM::ConnectOptions connect_options = MakeConnectOptions(cmd_args);
   const int32_t dbm_index = GetIntegerArgument(cmd_args, "--index", 0, 0);
   const int32_t num_iterations = GetIntegerArgument(cmd_args, "--iter", 0, 10000);
   const int32_t value_size = GetIntegerArgument(cmd_args, "--size", 0, 8);
@@ -629,7 +1526,7 @@ static int32_t ProcessWicked(int32_t argc, const char** args) {
     Die("Invalid number of threads");
   }
   RemoteDBM dbm;
-  Status status = dbm.Connect(address, timeout);
+  Status status = dbm.Connect(address, connect_options);
   if (status != Status::SUCCESS) {
     EPrintL("Connect failed: ", status);
     return 1;
@@ -642,7 +1539,7 @@ static int32_t ProcessWicked(int32_t argc, const char** args) {
     RemoteDBM stack_dbm;
     RemoteDBM* task_dbm = &dbm;
     if (with_separate && id > 0) {
-      const Status status = stack_dbm.Connect(address, timeout);
+      const Status status = stack_dbm.Connect(address, connect_options);
       if (status != Status::SUCCESS) {
         EPrintL("Connect failed: ", status);
         return;
@@ -840,6 +1737,893 @@ static int32_t ProcessWicked(int32_t argc, const char** args) {
   return has_error ? 1 : 0;
 }
 
+// Processes the workload subcommand.
+static int32_t ProcessWorkload(int32_t argc, const char** args) {
+  const std::map<std::string, int32_t>& cmd_configs = {
+    {"", 0}, {"--address", 1}, {"--timeout", 1}, {"--index", 1},
+    {"--iter", 1}, {"--size", 1}, {"--threads", 1}, {"--separate", 0}, {"--channels", 1},
+    {"--connect_timeout", 1}, {"--max_message_size", 1}, {"--keepalive", 1},
+    {"--keepalive_idle", 0}, {"--compression", 1}, {"--lb_policy", 1},
+    {"--random_seed", 1}, {"--inproc", 1},
+    {"--records", 1}, {"--skip_load", 0}, {"--preset", 1},
+    {"--read", 1}, {"--update", 1}, {"--insert", 1}, {"--scan", 1}, {"--rmw", 1},
+    {"--key_dist", 1}, {"--zipf_theta", 1}, {"--hot_data", 1}, {"--hot_ops", 1},
+    {"--value_dist", 1}, {"--scan_length", 1}, {"--histogram", 1},
+    {"--rate", 1}, {"--poisson", 0},
+    {"--json", 1}, {"--csv", 1},
+  };
+  std::map<std::string, std::vector<std::string>> cmd_args;
+  std::string cmd_error;
+  if (!ParseCommandArguments(argc, args, cmd_configs, &cmd_args, &cmd_error)) {
+    EPrint("Invalid command: ", cmd_error, "\n\n");
+    PrintUsageAndDie();
+  }
+  InProcessService inproc_service;
+  const std::string address = PrepareAddress(cmd_args, &inproc_service);
+  const RemoteDBM::ConnectOptions connect_options = MakeConnectOptions(cmd_args);
+  const int32_t dbm_index = GetIntegerArgument(cmd_args, "--index", 0, 0);
+  const int32_t num_iterations = GetIntegerArgument(cmd_args, "--iter", 0, 10000);
+  const int32_t value_size = GetIntegerArgument(cmd_args, "--size", 0, 8);
+  const int32_t num_threads = GetIntegerArgument(cmd_args, "--threads", 0, 1);
+  const bool with_separate = CheckMap(cmd_args, "--separate");
+  const int32_t random_seed = GetIntegerArgument(cmd_args, "--random_seed", 0, 0);
+  const int64_t num_records = GetIntegerArgument(cmd_args, "--records", 0, 10000);
+  const bool skip_load = CheckMap(cmd_args, "--skip_load");
+  const std::string preset = StrLowerCase(GetStringArgument(cmd_args, "--preset", 0, "a"));
+  const double zipf_theta = GetDoubleArgument(cmd_args, "--zipf_theta", 0, 0.99);
+  const double hot_data_ratio = GetDoubleArgument(cmd_args, "--hot_data", 0, 0.2);
+  const double hot_ops_ratio = GetDoubleArgument(cmd_args, "--hot_ops", 0, 0.8);
+  const std::string value_dist = GetStringArgument(cmd_args, "--value_dist", 0, "fixed");
+  const int32_t scan_length = GetIntegerArgument(cmd_args, "--scan_length", 0, 100);
+  const std::string histogram_prefix = GetStringArgument(cmd_args, "--histogram", 0, "");
+  const std::map<std::string, std::string> run_params = MakeRunParams(args[0], cmd_args);
+  const double rate = GetDoubleArgument(cmd_args, "--rate", 0, 0);
+  const bool with_poisson = CheckMap(cmd_args, "--poisson");
+  // The operation types and the ratios of the YCSB presets.
+  enum OpType : int32_t {OP_READ, OP_UPDATE, OP_INSERT, OP_SCAN, OP_RMW, NUM_OP_TYPES};
+  const char* op_names[NUM_OP_TYPES] = {"read", "update", "insert", "scan", "rmw"};
+  const std::map<std::string, std::vector<double>> preset_ratios = {
+    {"a", {50, 50, 0, 0, 0}}, {"b", {95, 5, 0, 0, 0}}, {"c", {100, 0, 0, 0, 0}},
+    {"d", {95, 0, 5, 0, 0}}, {"e", {0, 0, 5, 95, 0}}, {"f", {50, 0, 0, 0, 50}},
+  };
+  const auto preset_it = preset_ratios.find(preset);
+  if (preset_it == preset_ratios.end()) {
+    Die("Invalid preset: ", preset);
+  }
+  std::vector<double> op_ratios = preset_it->second;
+  bool has_custom_ratio = false;
+  for (int32_t i = 0; i < NUM_OP_TYPES; i++) {
+    if (CheckMap(cmd_args, StrCat("--", op_names[i]))) {
+      has_custom_ratio = true;
+    }
+  }
+  if (has_custom_ratio) {
+    for (int32_t i = 0; i < NUM_OP_TYPES; i++) {
+      op_ratios[i] = GetDoubleArgument(cmd_args, StrCat("--", op_names[i]), 0, 0);
+    }
+  }
+  const std::string key_dist = GetStringArgument(
+      cmd_args, "--key_dist", 0, preset == "d" ? "latest" : "zipfian");
+  if (num_iterations < 1) {
+    Die("Invalid number of iterations");
+  }
+  if (value_size < 1) {
+    Die("Invalid size of a record");
+  }
+  if (num_threads < 1) {
+    Die("Invalid number of threads");
+  }
+  if (num_records < 1) {
+    Die("Invalid number of records");
+  }
+  double total_ratio = 0;
+  for (const double op_ratio : op_ratios) {
+    if (op_ratio < 0) {
+      Die("Invalid ratio of operations");
+    }
+    total_ratio += op_ratio;
+  }
+  if (total_ratio <= 0) {
+    Die("Invalid ratio of operations");
+  }
+  if (key_dist != "uniform" && key_dist != "zipfian" && key_dist != "latest" &&
+      key_dist != "hotspot") {
+    Die("Invalid key distribution: ", key_dist);
+  }
+  if (zipf_theta <= 0 || zipf_theta >= 1) {
+    Die("Invalid Zipfian theta");
+  }
+  if (hot_data_ratio <= 0 || hot_data_ratio > 1 || hot_ops_ratio < 0 || hot_ops_ratio > 1) {
+    Die("Invalid hotspot ratios");
+  }
+  if (value_dist != "fixed" && value_dist != "uniform" && value_dist != "zipfian") {
+    Die("Invalid value distribution: ", value_dist);
+  }
+  if (scan_length < 1) {
+    Die("Invalid scan length");
+  }
+  if (rate < 0) {
+    Die("Invalid rate");
+  }
+  const int64_t start_mem_rss = GetMemoryUsage();
+  RemoteDBM dbm;
+  Status status = dbm.Connect(address, connect_options);
+  if (status != Status::SUCCESS) {
+    EPrintL("Connect failed: ", status);
+    return 1;
+  }
+  dbm.SetDBMIndex(dbm_index);
+  std::atomic_bool has_error(false);
+  // Records are identified by serial numbers, whose keys are scrambled by hashing so that
+  // popular records are spread over the key space.
+  auto make_key = [](int64_t key_num) {
+    return SPrintF("user%016llx", static_cast<unsigned long long>(HashFNV(ToString(key_num))));
+  };
+  // The serial number of the next record to insert.
+  std::atomic_int64_t insert_cursor(num_records);
+  const ZipfianGenerator key_zipf(num_records, zipf_theta);
+  const ZipfianGenerator value_zipf(value_size, zipf_theta);
+  const int64_t num_hot_records =
+      std::max<int64_t>(num_records * hot_data_ratio, 1);
+  auto pick_key_num = [&](std::mt19937* mt) -> int64_t {
+    const int64_t num_current = insert_cursor.load();
+    if (key_dist == "zipfian") {
+      return key_zipf.Generate(mt) % num_current;
+    }
+    if (key_dist == "latest") {
+      return std::max<int64_t>(num_current - 1 - key_zipf.Generate(mt), 0);
+    }
+    if (key_dist == "hotspot" && num_hot_records < num_current) {
+      if (std::uniform_real_distribution<double>(0, 1)(*mt) < hot_ops_ratio) {
+        return std::uniform_int_distribution<int64_t>(0, num_hot_records - 1)(*mt);
+      }
+      return std::uniform_int_distribution<int64_t>(num_hot_records, num_current - 1)(*mt);
+    }
+    return std::uniform_int_distribution<int64_t>(0, num_current - 1)(*mt);
+  };
+  auto pick_value_size = [&](std::mt19937* mt) -> int32_t {
+    if (value_dist == "uniform") {
+      return std::uniform_int_distribution<int32_t>(1, value_size)(*mt);
+    }
+    if (value_dist == "zipfian") {
+      return value_zipf.Generate(mt) + 1;
+    }
+    return value_size;
+  };
+  // Values are views of a buffer at various offsets.
+  constexpr uint32_t value_extra = 2039U;
+  std::string value_buf(value_size + value_extra, 0);
+  for (size_t i = 0; i < value_buf.size(); i++) {
+    value_buf[i] = 'a' + i % (i % 2 ? 26 : 8);
+  }
+  auto make_value = [&](std::mt19937* mt) {
+    const uint32_t offset = std::uniform_int_distribution<uint32_t>(0, value_extra - 1)(*mt);
+    return std::string_view(value_buf.data() + offset, pick_value_size(mt));
+  };
+  auto connect_task_dbm = [&](int32_t id, RemoteDBM* stack_dbm) -> RemoteDBM* {
+    if (with_separate && id > 0) {
+      const Status status = stack_dbm->Connect(address, connect_options);
+      if (status != Status::SUCCESS) {
+        EPrintL("Connect failed: ", status);
+        has_error = true;
+        return nullptr;
+      }
+      stack_dbm->SetDBMIndex(dbm_index);
+      return stack_dbm;
+    }
+    return &dbm;
+  };
+  std::vector<LatencyHistogram> load_histograms(num_threads);
+  auto loading_task = [&](int32_t id) {
+    RemoteDBM stack_dbm;
+    RemoteDBM* task_dbm = connect_task_dbm(id, &stack_dbm);
+    if (task_dbm == nullptr) {
+      return;
+    }
+    const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
+    std::mt19937 misc_mt(mt_seed + id);
+    for (int64_t key_num = id; !has_error && key_num < num_records; key_num += num_threads) {
+      const std::string key = make_key(key_num);
+      const int64_t op_start_time = GetMonotonicNanos();
+      const Status status = task_dbm->Set(key, make_value(&misc_mt));
+      if (status != Status::SUCCESS) {
+        EPrintL("Set failed: ", status);
+        has_error = true;
+        break;
+      }
+      load_histograms[id].Add(GetMonotonicNanos() - op_start_time);
+    }
+  };
+  if (!skip_load) {
+    PrintF("Loading: num_records=%lld value_size=%d value_dist=%s num_threads=%d\n",
+           num_records, value_size, value_dist.c_str(), num_threads);
+    const double start_time = GetWallTime();
+    const double start_cpu_time = GetCPUTime();
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < num_threads; i++) {
+      threads.emplace_back(std::thread(loading_task, i));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    const double end_time = GetWallTime();
+    const double elapsed_time = end_time - start_time;
+    const double cpu_time = GetCPUTime() - start_cpu_time;
+    const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
+    PrintF("Loading done: elapsed_time=%.6f num_records=%lld qps=%.0f mem=%lld\n",
+           elapsed_time, dbm.CountSimple(), num_records / elapsed_time, mem_usage);
+    const LatencyHistogram latency = PrintLatency(load_histograms, histogram_prefix, "loading");
+    AddPhaseResult("loading", run_params, elapsed_time, num_records, cpu_time, mem_usage,
+                   latency);
+    PrintL();
+  }
+  // Each thread records latencies of each operation type into its own histogram.
+  std::vector<std::vector<LatencyHistogram>> op_histograms(
+      NUM_OP_TYPES, std::vector<LatencyHistogram>(num_threads));
+  std::vector<LatencyHistogram> all_histograms(num_threads);
+  std::atomic_int64_t num_misses(0);
+  const int32_t dot_mod = std::max(num_iterations / 1000, 1);
+  const int32_t fold_mod = std::max(num_iterations / 20, 1);
+  auto running_task = [&](int32_t id) {
+    RemoteDBM stack_dbm;
+    RemoteDBM* task_dbm = connect_task_dbm(id, &stack_dbm);
+    if (task_dbm == nullptr) {
+      return;
+    }
+    const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
+    std::mt19937 key_mt(mt_seed + id);
+    std::mt19937 misc_mt(mt_seed * 2 + id + 1);
+    OperationPacer pacer(rate / num_threads, with_poisson, mt_seed * 3 + id,
+                         static_cast<double>(id) / num_threads);
+    std::discrete_distribution<int32_t> op_dist(op_ratios.begin(), op_ratios.end());
+    std::uniform_int_distribution<int32_t> scan_length_dist(1, scan_length);
+    std::unique_ptr<RemoteDBM::Iterator> iter;
+    bool midline = false;
+    for (int32_t i = 0; !has_error && i < num_iterations; i++) {
+      const int32_t op_type = op_dist(misc_mt);
+      const int64_t key_num = op_type == OP_INSERT ? insert_cursor++ : pick_key_num(&key_mt);
+      const std::string key = make_key(key_num);
+      const int64_t op_start_time = pacer.WaitNext();
+      Status status(Status::SUCCESS);
+      std::string value;
+      switch (op_type) {
+        case OP_READ: {
+          status = task_dbm->Get(key, &value);
+          break;
+        }
+        case OP_UPDATE:
+        case OP_INSERT: {
+          status = task_dbm->Set(key, make_value(&misc_mt));
+          break;
+        }
+        case OP_SCAN: {
+          if (iter == nullptr) {
+            iter = task_dbm->MakeIterator();
+          }
+          status = iter->Jump(key);
+          for (int32_t length = scan_length_dist(misc_mt);
+               status == Status::SUCCESS && length > 0; length--) {
+            status = iter->Get(nullptr, &value);
+            if (status == Status::SUCCESS) {
+              status = iter->Next();
+            }
+          }
+          break;
+        }
+        case OP_RMW: {
+          status = task_dbm->Get(key, &value);
+          if (status == Status::SUCCESS || status == Status::NOT_FOUND_ERROR) {
+            status = task_dbm->Set(key, make_value(&misc_mt));
+          }
+          break;
+        }
+      }
+      if (status == Status::NOT_FOUND_ERROR && op_type != OP_UPDATE && op_type != OP_INSERT) {
+        // Reading a record being inserted by another thread or scanning past the end is fine.
+        num_misses++;
+      } else if (status != Status::SUCCESS) {
+        EPrintL(StrUpperCase(op_names[op_type]), " failed: ", status);
+        has_error = true;
+        break;
+      }
+      const int64_t latency = GetMonotonicNanos() - op_start_time;
+      op_histograms[op_type][id].Add(latency);
+      all_histograms[id].Add(latency);
+      if (id == 0 && (i + 1) % dot_mod == 0) {
+        PutChar('.');
+        midline = true;
+        if ((i + 1) % fold_mod == 0) {
+          PrintF(" (%08d)\n", i + 1);
+          midline = false;
+        }
+      }
+    }
+    if (midline) {
+      PrintF(" (%08d)\n", num_iterations);
+    }
+  };
+  std::string mix_expr;
+  for (int32_t i = 0; i < NUM_OP_TYPES; i++) {
+    mix_expr += SPrintF(" %s=%.2f", op_names[i], op_ratios[i] / total_ratio);
+  }
+  PrintF("Running: num_iterations=%d num_threads=%d%s key_dist=%s%s\n",
+         num_iterations, num_threads, mix_expr.c_str(), key_dist.c_str(),
+         rate > 0 ? SPrintF(" target_qps=%.0f arrival=%s", rate,
+                            with_poisson ? "poisson" : "fixed").c_str() : "");
+  const double start_time = GetWallTime();
+  const double start_cpu_time = GetCPUTime();
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < num_threads; i++) {
+    threads.emplace_back(std::thread(running_task, i));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double end_time = GetWallTime();
+  const double elapsed_time = end_time - start_time;
+  const double cpu_time = GetCPUTime() - start_cpu_time;
+  const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
+  PrintF("Running done: elapsed_time=%.6f num_records=%lld qps=%.0f num_misses=%lld mem=%lld\n",
+         elapsed_time, dbm.CountSimple(), num_iterations * num_threads / elapsed_time,
+         num_misses.load(), mem_usage);
+  const LatencyHistogram latency = PrintLatency(all_histograms, histogram_prefix, "running");
+  AddPhaseResult("running", run_params, elapsed_time, latency.GetCount(), cpu_time, mem_usage,
+                 latency);
+  for (int32_t i = 0; i < NUM_OP_TYPES; i++) {
+    if (op_ratios[i] > 0) {
+      const std::string phase = StrCat("running-", op_names[i]);
+      const LatencyHistogram op_latency = PrintLatency(
+          op_histograms[i], histogram_prefix, phase, SPrintF("  %-6s", op_names[i]));
+      AddPhaseResult(phase, run_params, elapsed_time, op_latency.GetCount(), cpu_time,
+                     mem_usage, op_latency);
+    }
+  }
+  PrintL();
+  if (!WritePhaseResults(cmd_args, g_phase_results)) {
+    has_error = true;
+  }
+  return has_error ? 1 : 0;
+}
+
+// Processes the async subcommand.
+static int32_t ProcessAsync(int32_t argc, const char** args) {
+  const std::map<std::string, int32_t>& cmd_configs = {
+    {"", 0}, {"--address", 1}, {"--timeout", 1}, {"--index", 1},
+    {"--iter", 1}, {"--size", 1}, {"--threads", 1}, {"--channels", 1},
+    {"--connect_timeout", 1}, {"--max_message_size", 1}, {"--keepalive", 1},
+    {"--keepalive_idle", 0}, {"--compression", 1}, {"--lb_policy", 1},
+    {"--random_seed", 1}, {"--inproc", 1}, {"--random_key", 0},
+    {"--set_only", 0}, {"--get_only", 0}, {"--remove_only", 0},
+    {"--connections", 1}, {"--depth", 1}, {"--histogram", 1},
+    {"--json", 1}, {"--csv", 1},
+  };
+  std::map<std::string, std::vector<std::string>> cmd_args;
+  std::string cmd_error;
+  if (!ParseCommandArguments(argc, args, cmd_configs, &cmd_args, &cmd_error)) {
+    EPrint("Invalid command: ", cmd_error, "\n\n");
+    PrintUsageAndDie();
+  }
+  InProcessService inproc_service;
+  const std::string address = PrepareAddress(cmd_args, &inproc_service);
+  const RemoteDBM::ConnectOptions connect_options = MakeConnectOptions(cmd_args);
+  const int32_t dbm_index = GetIntegerArgument(cmd_args, "--index", 0, 0);
+  const int32_t num_iterations = GetIntegerArgument(cmd_args, "--iter", 0, 10000);
+  const int32_t value_size = GetIntegerArgument(cmd_args, "--size", 0, 8);
+  const int32_t num_threads = GetIntegerArgument(cmd_args, "--threads", 0, 1);
+  const int32_t random_seed = GetIntegerArgument(cmd_args, "--random_seed", 0, 0);
+  const bool is_random_key = CheckMap(cmd_args, "--random_key");
+  bool set_only = CheckMap(cmd_args, "--set_only");
+  bool get_only = CheckMap(cmd_args, "--get_only");
+  bool remove_only = CheckMap(cmd_args, "--remove_only");
+  const int32_t num_connections = GetIntegerArgument(cmd_args, "--connections", 0, 1);
+  const int32_t depth = GetIntegerArgument(cmd_args, "--depth", 0, 100);
+  const std::string histogram_prefix = GetStringArgument(cmd_args, "--histogram", 0, "");
+  const std::map<std::string, std::string> run_params = MakeRunParams(args[0], cmd_args);
+  if (num_iterations < 1) {
+    Die("Invalid number of iterations");
+  }
+  if (value_size < 1) {
+    Die("Invalid size of a record");
+  }
+  if (num_threads < 1) {
+    Die("Invalid number of threads");
+  }
+  if (num_connections < 1) {
+    Die("Invalid number of connections");
+  }
+  if (depth < 1) {
+    Die("Invalid depth");
+  }
+  if (!set_only && !get_only && !remove_only) {
+    set_only = true;
+    get_only = true;
+    remove_only = true;
+  }
+  const int64_t start_mem_rss = GetMemoryUsage();
+  std::vector<std::unique_ptr<RemoteDBM>> dbms;
+  for (int32_t i = 0; i < num_connections; i++) {
+    auto dbm = std::make_unique<RemoteDBM>();
+    const Status status = dbm->Connect(address, connect_options);
+    if (status != Status::SUCCESS) {
+      EPrintL("Connect failed: ", status);
+      return 1;
+    }
+    dbm->SetDBMIndex(dbm_index);
+    dbm->SetAsyncThreads(num_threads);
+    dbms.emplace_back(std::move(dbm));
+  }
+  const int64_t num_keys = static_cast<int64_t>(num_iterations) * num_connections;
+  const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
+  // Keys are made in advance because the issuers are called by the driver threads.
+  std::vector<std::vector<std::string>> keys(num_connections);
+  for (int32_t i = 0; i < num_connections; i++) {
+    std::mt19937 key_mt(mt_seed + i);
+    std::uniform_int_distribution<int64_t> key_num_dist(0, num_keys - 1);
+    keys[i].reserve(num_iterations);
+    for (int32_t j = 0; j < num_iterations; j++) {
+      const int64_t key_num = is_random_key ? key_num_dist(key_mt) :
+          static_cast<int64_t>(j) * num_connections + i;
+      keys[i].emplace_back(SPrintF("%08lld", key_num));
+    }
+  }
+  const std::string value_buf(value_size, 'v');
+  bool has_error = false;
+  auto run_phase = [&](const std::string& name, const std::string& phase,
+                       std::function<AsyncCallDriver::Issuer(int32_t)> make_issuer,
+                       Status::Code acceptable) {
+    PrintF("%s: num_iterations=%d value_size=%d num_connections=%d depth=%d"
+           " num_threads=%d in_flight=%lld\n", name.c_str(), num_iterations, value_size,
+           num_connections, depth, num_threads,
+           static_cast<int64_t>(num_connections) * depth);
+    std::vector<std::unique_ptr<AsyncCallDriver>> drivers;
+    for (int32_t i = 0; i < num_connections; i++) {
+      drivers.emplace_back(std::make_unique<AsyncCallDriver>(
+          num_iterations, depth, make_issuer(i), acceptable));
+    }
+    const double start_time = GetWallTime();
+    const double start_cpu_time = GetCPUTime();
+    for (auto& driver : drivers) {
+      driver->Start();
+    }
+    std::vector<LatencyHistogram> histograms;
+    for (auto& driver : drivers) {
+      const Status status = driver->Wait();
+      if (status != Status::SUCCESS) {
+        EPrintL(name, " failed: ", status);
+        has_error = true;
+      }
+      histograms.emplace_back(driver->GetHistogram());
+    }
+    const double end_time = GetWallTime();
+    const double elapsed_time = end_time - start_time;
+    const int64_t num_records = dbms.front()->CountSimple();
+    const double cpu_time = GetCPUTime() - start_cpu_time;
+    const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
+    PrintF("%s done: elapsed_time=%.6f num_records=%lld qps=%.0f mem=%lld\n",
+           name.c_str(), elapsed_time, num_records, num_keys / elapsed_time, mem_usage);
+    const LatencyHistogram latency = PrintLatency(histograms, histogram_prefix, phase);
+    AddPhaseResult(phase, run_params, elapsed_time, num_keys, cpu_time, mem_usage, latency);
+    PrintL();
+  };
+  if (set_only) {
+    run_phase("Setting", "setting", [&](int32_t id) {
+      return [&, id](int64_t index, std::function<void(const Status&)> callback) {
+        dbms[id]->SetAsync(keys[id][index], value_buf, true, std::move(callback));
+      };
+    }, Status::SUCCESS);
+  }
+  if (get_only && !has_error) {
+    run_phase("Getting", "getting", [&](int32_t id) {
+      return [&, id](int64_t index, std::function<void(const Status&)> callback) {
+        dbms[id]->GetAsync(keys[id][index], [callback](const Status& status, const std::string&) {
+          callback(status);
+        });
+      };
+    }, is_random_key ? Status::NOT_FOUND_ERROR : Status::SUCCESS);
+  }
+  if (remove_only && !has_error) {
+    run_phase("Removing", "removing", [&](int32_t id) {
+      return [&, id](int64_t index, std::function<void(const Status&)> callback) {
+        dbms[id]->RemoveAsync(keys[id][index], std::move(callback));
+      };
+    }, is_random_key ? Status::NOT_FOUND_ERROR : Status::SUCCESS);
+  }
+  for (auto& dbm : dbms) {
+    dbm->Disconnect();
+  }
+  if (!WritePhaseResults(cmd_args, g_phase_results)) {
+    has_error = true;
+  }
+  return has_error ? 1 : 0;
+}
+
+// Processes the lock subcommand.
+static int32_t ProcessLock(int32_t argc, const char** args) {
+  const std::map<std::string, int32_t>& cmd_configs = {
+    {"", 0}, {"--iter", 1}, {"--threads", 1}, {"--random_seed", 1},
+    {"--writes", 1}, {"--locks", 1}, {"--histogram", 1},
+    {"--json", 1}, {"--csv", 1},
+  };
+  std::map<std::string, std::vector<std::string>> cmd_args;
+  std::string cmd_error;
+  if (!ParseCommandArguments(argc, args, cmd_configs, &cmd_args, &cmd_error)) {
+    EPrint("Invalid command: ", cmd_error, "\n\n");
+    PrintUsageAndDie();
+  }
+  const int32_t num_iterations = GetIntegerArgument(cmd_args, "--iter", 0, 10000);
+  const int32_t num_threads = GetIntegerArgument(cmd_args, "--threads", 0, 1);
+  const int32_t random_seed = GetIntegerArgument(cmd_args, "--random_seed", 0, 0);
+  const double write_ratio = GetDoubleArgument(cmd_args, "--writes", 0, 0);
+  const std::vector<std::string> lock_types =
+      StrSplit(GetStringArgument(cmd_args, "--locks", 0, "spin,std,slotted"), ",", true);
+  const std::string histogram_prefix = GetStringArgument(cmd_args, "--histogram", 0, "");
+  const std::map<std::string, std::string> run_params = MakeRunParams(args[0], cmd_args);
+  if (num_iterations < 1) {
+    Die("Invalid number of iterations");
+  }
+  if (num_threads < 1) {
+    Die("Invalid number of threads");
+  }
+  if (write_ratio < 0 || write_ratio > 1) {
+    Die("Invalid ratio of writes");
+  }
+  for (const auto& lock_type : lock_types) {
+    if (lock_type != "spin" && lock_type != "std" && lock_type != "slotted") {
+      Die("Unknown lock type: ", lock_type);
+    }
+  }
+  const int64_t start_mem_rss = GetMemoryUsage();
+  // The critical sections are as short as reading the stub pointer in RemoteDBM.
+  auto run_phase = [&](const std::string& name, auto* mutex) {
+    PrintF("Locking %s: num_iterations=%d num_threads=%d write_ratio=%.3f\n",
+           name.c_str(), num_iterations, num_threads, write_ratio);
+    std::vector<LatencyHistogram> histograms(num_threads);
+    std::atomic_int64_t shared_value(0);
+    auto task = [&](int32_t id) {
+      const uint32_t mt_seed = random_seed >= 0 ? random_seed : std::random_device()();
+      std::mt19937 misc_mt(mt_seed + id);
+      std::uniform_real_distribution<double> write_dist(0, 1);
+      int64_t sum = 0;
+      for (int32_t i = 0; i < num_iterations; i++) {
+        const bool is_write = write_ratio > 0 && write_dist(misc_mt) < write_ratio;
+        const int64_t op_start_time = GetMonotonicNanos();
+        if (is_write) {
+          std::lock_guard<std::remove_pointer_t<decltype(mutex)>> lock(*mutex);
+          shared_value.store(shared_value.load(std::memory_order_relaxed) + 1,
+                             std::memory_order_relaxed);
+        } else {
+          std::shared_lock<std::remove_pointer_t<decltype(mutex)>> lock(*mutex);
+          sum += shared_value.load(std::memory_order_relaxed);
+        }
+        histograms[id].Add(GetMonotonicNanos() - op_start_time);
+      }
+      if (sum < 0) {
+        EPrintL("Invalid value: ", sum);
+      }
+    };
+    const double start_time = GetWallTime();
+    const double start_cpu_time = GetCPUTime();
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < num_threads; i++) {
+      threads.emplace_back(std::thread(task, i));
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    const double elapsed_time = GetWallTime() - start_time;
+    const double cpu_time = GetCPUTime() - start_cpu_time;
+    const int64_t mem_usage = GetMemoryUsage() - start_mem_rss;
+    const int64_t num_ops = static_cast<int64_t>(num_iterations) * num_threads;
+    PrintF("Locking %s done: elapsed_time=%.6f qps=%.0f writes=%lld\n",
+           name.c_str(), elapsed_time, num_ops / elapsed_time, shared_value.load());
+    const std::string phase = StrCat("locking-", name);
+    const LatencyHistogram latency = PrintLatency(histograms, histogram_prefix, phase);
+    AddPhaseResult(phase, run_params, elapsed_time, num_ops, cpu_time, mem_usage, latency);
+    PrintL();
+  };
+  for (const auto& lock_type : lock_types) {
+    if (lock_type == "spin") {
+      SpinSharedMutex mutex;
+      run_phase(lock_type, &mutex);
+    } else if (lock_type == "std") {
+      std::shared_mutex mutex;
+      run_phase(lock_type, &mutex);
+    } else {
+      auto mutex = std::make_unique<SlottedSharedMutex>();
+      run_phase(lock_type, mutex.get());
+    }
+  }
+  return WritePhaseResults(cmd_args, g_phase_results) ? 0 : 1;
+}
+
+// Processes the matrix subcommand.
+static int32_t ProcessMatrix(int32_t argc, const char** args) {
+  const std::map<std::string, int32_t>& cmd_configs = {
+    {"--modes", 1}, {"--server_threads", 1}, {"--transports", 1}, {"--workload", 1},
+    {"--json", 1}, {"--csv", 1},
+  };
+  std::map<std::string, std::vector<std::string>> cmd_args;
+  std::string cmd_error;
+  if (!ParseCommandArguments(argc, args, cmd_configs, &cmd_args, &cmd_error)) {
+    EPrint("Invalid command: ", cmd_error, "\n\n");
+    PrintUsageAndDie();
+  }
+  std::vector<std::string> dbm_exprs = SearchMap(cmd_args, "", {});
+  if (dbm_exprs.empty()) {
+    dbm_exprs.emplace_back("#dbm=tiny");
+  }
+  const std::vector<std::string> modes =
+      StrSplit(GetStringArgument(cmd_args, "--modes", 0, "sync,async"), ",", true);
+  std::vector<int32_t> server_threads;
+  for (const auto& expr :
+           StrSplit(GetStringArgument(cmd_args, "--server_threads", 0, "4"), ",", true)) {
+    server_threads.emplace_back(StrToInt(expr));
+  }
+  const std::vector<std::string> transports =
+      StrSplit(GetStringArgument(cmd_args, "--transports", 0, "tcp"), ",", true);
+  const std::vector<std::string> workload_args =
+      StrSplit(GetStringArgument(cmd_args, "--workload", 0, "sequence"), " ", true);
+  for (const auto& mode : modes) {
+    if (mode != "sync" && mode != "async") {
+      Die("Invalid mode: ", mode);
+    }
+  }
+  for (const int32_t num_threads : server_threads) {
+    if (num_threads < 1) {
+      Die("Invalid number of server threads");
+    }
+  }
+  for (const auto& transport : transports) {
+    if (transport != "tcp" && transport != "unix" && transport != "inproc") {
+      Die("Invalid transport: ", transport);
+    }
+  }
+  if (modes.empty() || server_threads.empty() || transports.empty()) {
+    Die("Empty configurations");
+  }
+  if (workload_args.empty() || (workload_args.front() != "sequence" &&
+                                workload_args.front() != "workload" &&
+                                workload_args.front() != "async")) {
+    Die("Invalid workload: the subcommand must be sequence, workload, or async");
+  }
+  for (const auto& arg : workload_args) {
+    if (arg == "--address" || arg == "--inproc") {
+      Die("The workload must not specify the address");
+    }
+  }
+  // Each configuration runs the workload and collects the results of the phases.
+  std::vector<std::pair<std::string, std::vector<PhaseResult>>> config_results;
+  std::vector<PhaseResult> all_results;
+  bool has_error = false;
+  for (const auto& dbm_expr : dbm_exprs) {
+    for (const auto& mode : modes) {
+      for (const int32_t num_threads : server_threads) {
+        for (const auto& transport : transports) {
+          std::string listen_address;
+          if (transport == "tcp") {
+            listen_address = "127.0.0.1:0";
+          } else if (transport == "unix") {
+            listen_address = SPrintF("unix:/tmp/tkrzw_dbm_remote_perf-%08x.sock",
+                                     static_cast<uint32_t>(std::random_device()()));
+          }
+          std::string label = SPrintF("%s/%d/%s", mode.c_str(), num_threads, transport.c_str());
+          if (dbm_exprs.size() > 1) {
+            label = StrCat(dbm_expr, "/", label);
+          }
+          PrintF("Server: dbm=%s mode=%s num_threads=%d transport=%s\n", dbm_expr.c_str(),
+                 mode.c_str(), num_threads, transport.c_str());
+          InProcessService service;
+          const Status status = service.Start(
+              {dbm_expr}, "tkrzw_dbm_remote_perf_matrix", mode == "async", num_threads,
+              listen_address);
+          if (status != Status::SUCCESS) {
+            EPrintL("InProcessService::Start failed: ", status);
+            has_error = true;
+            continue;
+          }
+          PrintL();
+          std::vector<std::string> run_args = workload_args;
+          run_args.emplace_back("--address");
+          run_args.emplace_back(service.GetAddress());
+          std::vector<const char*> run_argv;
+          for (const auto& arg : run_args) {
+            run_argv.emplace_back(arg.c_str());
+          }
+          g_phase_results.clear();
+          const int32_t run_argc = run_argv.size();
+          int32_t rv = 0;
+          if (run_args.front() == "sequence") {
+            rv = ProcessSequence(run_argc, run_argv.data());
+          } else if (run_args.front() == "workload") {
+            rv = ProcessWorkload(run_argc, run_argv.data());
+          } else {
+            rv = ProcessAsync(run_argc, run_argv.data());
+          }
+          if (rv != 0) {
+            has_error = true;
+          }
+          config_results.emplace_back(label, g_phase_results);
+          for (auto result : g_phase_results) {
+            result.config = label;
+            all_results.emplace_back(std::move(result));
+          }
+        }
+      }
+    }
+  }
+  // The columns are the phases in the order of appearance.
+  std::vector<std::string> phases;
+  size_t label_width = 8;
+  for (const auto& config_result : config_results) {
+    label_width = std::max(label_width, config_result.first.size());
+    for (const auto& result : config_result.second) {
+      if (std::find(phases.begin(), phases.end(), result.phase) == phases.end()) {
+        phases.emplace_back(result.phase);
+      }
+    }
+  }
+  auto print_matrix = [&](const std::string& title,
+                          std::function<double(const PhaseResult&)> get_value,
+                          const char* format) {
+    PrintL(title, ":");
+    std::string line = SPrintF("%-*s", static_cast<int>(label_width), "server");
+    for (const auto& phase : phases) {
+      line += SPrintF(" %12s", phase.c_str());
+    }
+    PrintL(line);
+    for (const auto& config_result : config_results) {
+      line = SPrintF("%-*s", static_cast<int>(label_width), config_result.first.c_str());
+      for (const auto& phase : phases) {
+        std::string cell = "-";
+        for (const auto& result : config_result.second) {
+          if (result.phase == phase) {
+            cell = SPrintF(format, get_value(result));
+          }
+        }
+        line += SPrintF(" %12s", cell.c_str());
+      }
+      PrintL(line);
+    }
+    PrintL();
+  };
+  print_matrix("Throughput (qps)",
+               [](const PhaseResult& result) { return result.qps; }, "%.0f");
+  print_matrix("Latency p50 (usec)",
+               [](const PhaseResult& result) { return result.latency.GetPercentile(50) / 1000.0; },
+               "%.3f");
+  print_matrix("Latency p99 (usec)",
+               [](const PhaseResult& result) { return result.latency.GetPercentile(99) / 1000.0; },
+               "%.3f");
+  if (!WritePhaseResults(cmd_args, all_results)) {
+    has_error = true;
+  }
+  return has_error ? 1 : 0;
+}
+
+// Reads the results of phases from a CSV file.  Each result is a pair of the key made of the
+// configuration and the phase, and the map of the fields.
+static Status ReadResultsCSV(
+    const std::string& path,
+    std::vector<std::pair<std::string, std::map<std::string, std::string>>>* results) {
+  std::string content;
+  const Status status = ReadFile(path, &content);
+  if (status != Status::SUCCESS) {
+    return status;
+  }
+  // JSON results are not parsed, so they are rejected explicitly rather than read as CSV.
+  const size_t first_pos = content.find_first_not_of(" \t\r\n");
+  if (first_pos != std::string::npos && (content[first_pos] == '[' || content[first_pos] == '{')) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "JSON is not supported; use the --csv output");
+  }
+  std::vector<std::string> columns;
+  for (const auto& line : StrSplit(content, "\n", true)) {
+    const std::vector<std::string> fields = SplitCSVLine(line);
+    if (columns.empty()) {
+      columns = fields;
+      continue;
+    }
+    std::map<std::string, std::string> record;
+    for (size_t i = 0; i < columns.size() && i < fields.size(); i++) {
+      record.emplace(columns[i], fields[i]);
+    }
+    const std::string config = SearchMap(record, "config", "");
+    const std::string phase = SearchMap(record, "phase", "");
+    if (phase.empty()) {
+      return Status(Status::BROKEN_DATA_ERROR, "missing phase");
+    }
+    results->emplace_back(config.empty() ? phase : StrCat(config, ":", phase), record);
+  }
+  if (columns.empty()) {
+    return Status(Status::BROKEN_DATA_ERROR, "missing header");
+  }
+  return Status(Status::SUCCESS);
+}
+
+// Processes the compare subcommand.
+static int32_t ProcessCompare(int32_t argc, const char** args) {
+  const std::map<std::string, int32_t>& cmd_configs = {
+    {"", 2}, {"--threshold", 1},
+  };
+  std::map<std::string, std::vector<std::string>> cmd_args;
+  std::string cmd_error;
+  if (!ParseCommandArguments(argc, args, cmd_configs, &cmd_args, &cmd_error)) {
+    EPrint("Invalid command: ", cmd_error, "\n\n");
+    PrintUsageAndDie();
+  }
+  const std::string base_path = GetStringArgument(cmd_args, "", 0, "");
+  const std::string target_path = GetStringArgument(cmd_args, "", 1, "");
+  const double threshold = GetDoubleArgument(cmd_args, "--threshold", 0, 0.05);
+  if (threshold < 0) {
+    Die("Invalid threshold");
+  }
+  std::vector<std::pair<std::string, std::map<std::string, std::string>>> base_results;
+  Status status = ReadResultsCSV(base_path, &base_results);
+  if (status != Status::SUCCESS) {
+    EPrintL("ReadResultsCSV failed: ", base_path, ": ", status);
+    return 1;
+  }
+  std::vector<std::pair<std::string, std::map<std::string, std::string>>> target_results;
+  status = ReadResultsCSV(target_path, &target_results);
+  if (status != Status::SUCCESS) {
+    EPrintL("ReadResultsCSV failed: ", target_path, ": ", status);
+    return 1;
+  }
+  // Each metric is a pair of the column name and whether a higher value is better.
+  const std::vector<std::pair<std::string, bool>> metrics = {
+    {"qps", true}, {"latency_p50", false}, {"latency_p99", false}, {"latency_p99.9", false},
+  };
+  size_t key_width = 8;
+  for (const auto& base_result : base_results) {
+    key_width = std::max(key_width, base_result.first.size());
+  }
+  PrintF("%-*s %-14s %14s %14s %9s\n", static_cast<int>(key_width), "phase", "metric",
+         "base", "target", "change");
+  int32_t num_comparisons = 0;
+  int32_t num_regressions = 0;
+  int32_t num_missing = 0;
+  for (const auto& base_result : base_results) {
+    const std::map<std::string, std::string>* target_record = nullptr;
+    for (const auto& target_result : target_results) {
+      if (target_result.first == base_result.first) {
+        target_record = &target_result.second;
+        break;
+      }
+    }
+    if (target_record == nullptr) {
+      PrintF("%-*s missing in the target\n", static_cast<int>(key_width),
+             base_result.first.c_str());
+      num_missing++;
+      continue;
+    }
+    for (const auto& metric : metrics) {
+      const std::string base_expr = SearchMap(base_result.second, metric.first, "");
+      const std::string target_expr = SearchMap(*target_record, metric.first, "");
+      if (base_expr.empty() || target_expr.empty()) {
+        continue;
+      }
+      const double base_value = StrToDouble(base_expr);
+      const double target_value = StrToDouble(target_expr);
+      std::string change_expr = "-";
+      bool is_regression = false;
+      if (base_value > 0) {
+        const double change = (target_value - base_value) / base_value;
+        change_expr = SPrintF("%+.1f%%", change * 100);
+        is_regression = metric.second ? change < -threshold : change > threshold;
+      }
+      num_comparisons++;
+      if (is_regression) {
+        num_regressions++;
+      }
+      PrintF("%-*s %-14s %14.3f %14.3f %9s%s\n", static_cast<int>(key_width),
+             base_result.first.c_str(), metric.first.c_str(), base_value, target_value,
+             change_expr.c_str(), is_regression ? "  REGRESSION" : "");
+    }
+  }
+  PrintF("Regressions: %d of %d comparisons (threshold=%.1f%%, missing=%d)\n",
+         num_regressions, num_comparisons, threshold * 100, num_missing);
+  return num_regressions > 0 || num_missing > 0 ? 1 : 0;
+}
+
 }  // namespace tkrzw
 
 // Main routine
@@ -854,6 +2638,16 @@ int main(int argc, char** argv) {
       rv = tkrzw::ProcessSequence(argc - 1, args + 1);
     } else if (std::strcmp(args[1], "wicked") == 0) {
       rv = tkrzw::ProcessWicked(argc - 1, args + 1);
+    } else if (std::strcmp(args[1], "workload") == 0) {
+      rv = tkrzw::ProcessWorkload(argc - 1, args + 1);
+    } else if (std::strcmp(args[1], "async") == 0) {
+      rv = tkrzw::ProcessAsync(argc - 1, args + 1);
+    } else if (std::strcmp(args[1], "lock") == 0) {
+      rv = tkrzw::ProcessLock(argc - 1, args + 1);
+    } else if (std::strcmp(args[1], "matrix") == 0) {
+      rv = tkrzw::ProcessMatrix(argc - 1, args + 1);
+    } else if (std::strcmp(args[1], "compare") == 0) {
+      rv = tkrzw::ProcessCompare(argc - 1, args + 1);
     } else {
       tkrzw::PrintUsageAndDie();
     }
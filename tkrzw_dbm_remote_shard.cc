@@ -0,0 +1,421 @@
+/*************************************************************************************************
+ * Sharded remote database manager implementation based on gRPC
+ *
+ * Copyright 2020 Google LLC
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain a copy of the License at
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software distributed under the
+ * License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.  See the License for the specific language governing permissions
+ * and limitations under the License.
+ *************************************************************************************************/
+
+#include <algorithm>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+
+#include "tkrzw_dbm_remote_shard.h"
+#include "tkrzw_hash_util.h"
+#include "tkrzw_rpc_common.h"
+
+namespace tkrzw {
+
+static constexpr int32_t SHARD_NUM_VIRTUAL_NODES = 128;
+static constexpr uint64_t SHARD_HASH_SEED = 19780211;
+
+// Merges the result status of a part into the total result status.
+static void MergeShardStatus(Status* total, const Status& part) {
+  if (part == Status::SUCCESS || *total == part.GetCode()) {
+    return;
+  }
+  if (*total == Status::SUCCESS || *total == Status::NOT_FOUND_ERROR ||
+      *total == Status::DUPLICATION_ERROR) {
+    *total = part;
+  }
+}
+
+// Gets the indices of the shards whose parts are not empty.
+template <typename PART>
+static std::vector<int32_t> GetNonEmptyParts(const std::vector<PART>& parts) {
+  std::vector<int32_t> indices;
+  for (int32_t i = 0; i < static_cast<int32_t>(parts.size()); i++) {
+    if (!parts[i].empty()) {
+      indices.emplace_back(i);
+    }
+  }
+  return indices;
+}
+
+// Waits for the result status of all parts and merges them.
+static Status MergeShardFutures(std::vector<std::future<Status>>* futures) {
+  Status status(Status::SUCCESS);
+  for (auto& future : *futures) {
+    MergeShardStatus(&status, future.get());
+  }
+  return status;
+}
+
+ShardedRemoteDBM::Iterator::Iterator(ShardedRemoteDBM* dbm) : cursors_(dbm->shards_.size()) {
+  for (size_t i = 0; i < dbm->shards_.size(); i++) {
+    cursors_[i].dbm = dbm->shards_[i];
+    cursors_[i].iter = cursors_[i].dbm->MakeIterator();
+  }
+}
+
+Status ShardedRemoteDBM::Iterator::First() {
+  Status status(Status::SUCCESS);
+  for (auto& cursor : cursors_) {
+    cursor.valid = false;
+    Status part = cursor.iter->First();
+    if (part == Status::SUCCESS) {
+      part = ReadCursor(&cursor);
+    }
+    MergeShardStatus(&status, part);
+  }
+  return status;
+}
+
+Status ShardedRemoteDBM::Iterator::Jump(std::string_view key) {
+  Status status(Status::SUCCESS);
+  for (auto& cursor : cursors_) {
+    cursor.valid = false;
+    Status part = cursor.iter->Jump(key);
+    if (part == Status::SUCCESS) {
+      part = ReadCursor(&cursor);
+    }
+    MergeShardStatus(&status, part);
+  }
+  return status;
+}
+
+Status ShardedRemoteDBM::Iterator::Next() {
+  const int32_t index = FindMinimum();
+  if (index < 0) {
+    return Status(Status::NOT_FOUND_ERROR);
+  }
+  Cursor& cursor = cursors_[index];
+  cursor.valid = false;
+  const Status status = cursor.iter->Next();
+  if (status == Status::SUCCESS) {
+    return ReadCursor(&cursor);
+  }
+  // An exhausted shard is only dropped from the merge while the others go on.
+  return status == Status::NOT_FOUND_ERROR ? Status(Status::SUCCESS) : status;
+}
+
+Status ShardedRemoteDBM::Iterator::Get(std::string* key, std::string* value) {
+  const int32_t index = FindMinimum();
+  if (index < 0) {
+    return Status(Status::NOT_FOUND_ERROR);
+  }
+  const Cursor& cursor = cursors_[index];
+  if (key != nullptr) {
+    *key = cursor.key;
+  }
+  if (value != nullptr) {
+    *value = cursor.value;
+  }
+  return Status(Status::SUCCESS);
+}
+
+Status ShardedRemoteDBM::Iterator::ReadCursor(Cursor* cursor) {
+  const Status status = cursor->iter->Get(&cursor->key, &cursor->value);
+  if (status == Status::SUCCESS) {
+    cursor->valid = true;
+    return status;
+  }
+  cursor->valid = false;
+  return status == Status::NOT_FOUND_ERROR ? Status(Status::SUCCESS) : status;
+}
+
+int32_t ShardedRemoteDBM::Iterator::FindMinimum() {
+  int32_t min_index = -1;
+  for (int32_t i = 0; i < static_cast<int32_t>(cursors_.size()); i++) {
+    const Cursor& cursor = cursors_[i];
+    if (cursor.valid && (min_index < 0 || cursor.key < cursors_[min_index].key)) {
+      min_index = i;
+    }
+  }
+  return min_index;
+}
+
+ShardedRemoteDBM::ShardedRemoteDBM()
+    : shards_(), ring_(), mutex_(std::make_unique<SlottedSharedMutex>()) {}
+
+ShardedRemoteDBM::~ShardedRemoteDBM() {}
+
+void ShardedRemoteDBM::InjectStubs(const std::vector<void*>& stubs) {
+  std::lock_guard<SlottedSharedMutex> lock(*mutex_);
+  shards_.clear();
+  std::vector<std::string> names;
+  for (size_t i = 0; i < stubs.size(); i++) {
+    auto shard = std::make_shared<RemoteDBM>();
+    shard->InjectStub(stubs[i]);
+    shards_.emplace_back(std::move(shard));
+    names.emplace_back(StrCat("shard-", i));
+  }
+  BuildRing(names);
+}
+
+Status ShardedRemoteDBM::Connect(
+    const std::vector<std::string>& addresses, double timeout, int32_t num_channels) {
+  RemoteDBM::ConnectOptions options;
+  options.connect_timeout = timeout;
+  options.call_timeout = timeout;
+  options.num_channels = num_channels;
+  return Connect(addresses, options);
+}
+
+Status ShardedRemoteDBM::Connect(
+    const std::vector<std::string>& addresses, const RemoteDBM::ConnectOptions& options) {
+  std::lock_guard<SlottedSharedMutex> lock(*mutex_);
+  if (!shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "connected database");
+  }
+  if (addresses.empty()) {
+    return Status(Status::INVALID_ARGUMENT_ERROR, "no address");
+  }
+  for (const auto& address : addresses) {
+    auto shard = std::make_shared<RemoteDBM>();
+    const Status status = shard->Connect(address, options);
+    if (status != Status::SUCCESS) {
+      shards_.clear();
+      return Status(status.GetCode(), StrCat(address, ": ", status.GetMessage()));
+    }
+    shards_.emplace_back(std::move(shard));
+  }
+  BuildRing(addresses);
+  return Status(Status::SUCCESS);
+}
+
+Status ShardedRemoteDBM::Disconnect() {
+  std::lock_guard<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  Status status(Status::SUCCESS);
+  for (auto& shard : shards_) {
+    status |= shard->Disconnect();
+  }
+  // Live iterators still own the disconnected shards.
+  shards_.clear();
+  ring_.clear();
+  return status;
+}
+
+Status ShardedRemoteDBM::SetDBMIndex(int32_t dbm_index) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  Status status(Status::SUCCESS);
+  for (auto& shard : shards_) {
+    status |= shard->SetDBMIndex(dbm_index);
+  }
+  return status;
+}
+
+int32_t ShardedRemoteDBM::GetNumShards() const {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  return shards_.size();
+}
+
+int32_t ShardedRemoteDBM::GetShardIndex(std::string_view key) const {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  return LocateShard(key);
+}
+
+RemoteDBM* ShardedRemoteDBM::GetShard(int32_t index) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (index < 0 || index >= static_cast<int32_t>(shards_.size())) {
+    return nullptr;
+  }
+  return shards_[index].get();
+}
+
+Status ShardedRemoteDBM::Get(std::string_view key, std::string* value) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  return shards_[LocateShard(key)]->Get(key, value);
+}
+
+Status ShardedRemoteDBM::GetMulti(
+    const std::vector<std::string_view>& keys, std::map<std::string, std::string>* records) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  std::vector<std::vector<std::string_view>> parts(shards_.size());
+  for (const auto& key : keys) {
+    parts[LocateShard(key)].emplace_back(key);
+  }
+  std::vector<std::future<std::pair<Status, std::map<std::string, std::string>>>> futures;
+  for (const int32_t index : GetNonEmptyParts(parts)) {
+    futures.emplace_back(shards_[index]->GetMultiAsync(parts[index]));
+  }
+  Status status(Status::SUCCESS);
+  for (auto& future : futures) {
+    auto result = future.get();
+    MergeShardStatus(&status, result.first);
+    records->insert(result.second.begin(), result.second.end());
+  }
+  return status;
+}
+
+Status ShardedRemoteDBM::Set(std::string_view key, std::string_view value, bool overwrite) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  return shards_[LocateShard(key)]->Set(key, value, overwrite);
+}
+
+Status ShardedRemoteDBM::SetMulti(
+    const std::map<std::string_view, std::string_view>& records, bool overwrite) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  std::vector<std::map<std::string_view, std::string_view>> parts(shards_.size());
+  for (const auto& record : records) {
+    parts[LocateShard(record.first)].emplace(record);
+  }
+  std::vector<std::future<Status>> futures;
+  for (const int32_t index : GetNonEmptyParts(parts)) {
+    futures.emplace_back(shards_[index]->SetMultiAsync(parts[index], overwrite));
+  }
+  return MergeShardFutures(&futures);
+}
+
+Status ShardedRemoteDBM::Remove(std::string_view key) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  return shards_[LocateShard(key)]->Remove(key);
+}
+
+Status ShardedRemoteDBM::RemoveMulti(const std::vector<std::string_view>& keys) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  std::vector<std::vector<std::string_view>> parts(shards_.size());
+  for (const auto& key : keys) {
+    parts[LocateShard(key)].emplace_back(key);
+  }
+  std::vector<std::future<Status>> futures;
+  for (const int32_t index : GetNonEmptyParts(parts)) {
+    futures.emplace_back(shards_[index]->RemoveMultiAsync(parts[index]));
+  }
+  return MergeShardFutures(&futures);
+}
+
+Status ShardedRemoteDBM::Append(
+    std::string_view key, std::string_view value, std::string_view delim) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  return shards_[LocateShard(key)]->Append(key, value, delim);
+}
+
+Status ShardedRemoteDBM::AppendMulti(
+    const std::map<std::string_view, std::string_view>& records, std::string_view delim) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  std::vector<std::map<std::string_view, std::string_view>> parts(shards_.size());
+  for (const auto& record : records) {
+    parts[LocateShard(record.first)].emplace(record);
+  }
+  std::vector<std::future<Status>> futures;
+  for (const int32_t index : GetNonEmptyParts(parts)) {
+    futures.emplace_back(shards_[index]->AppendMultiAsync(parts[index], delim));
+  }
+  return MergeShardFutures(&futures);
+}
+
+Status ShardedRemoteDBM::CompareExchange(
+    std::string_view key, std::string_view expected, std::string_view desired) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  return shards_[LocateShard(key)]->CompareExchange(key, expected, desired);
+}
+
+Status ShardedRemoteDBM::Increment(
+    std::string_view key, int64_t increment, int64_t* current, int64_t initial) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  return shards_[LocateShard(key)]->Increment(key, increment, current, initial);
+}
+
+Status ShardedRemoteDBM::Count(int64_t* count) {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  // Counting has no asynchronous call so the shards are asked in turn.
+  Status status(Status::SUCCESS);
+  *count = 0;
+  for (auto& shard : shards_) {
+    int64_t part = 0;
+    MergeShardStatus(&status, shard->Count(&part));
+    *count += part;
+  }
+  return status;
+}
+
+Status ShardedRemoteDBM::Clear() {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  if (shards_.empty()) {
+    return Status(Status::PRECONDITION_ERROR, "not connected database");
+  }
+  Status status(Status::SUCCESS);
+  for (auto& shard : shards_) {
+    MergeShardStatus(&status, shard->Clear());
+  }
+  return status;
+}
+
+std::unique_ptr<ShardedRemoteDBM::Iterator> ShardedRemoteDBM::MakeIterator() {
+  std::shared_lock<SlottedSharedMutex> lock(*mutex_);
+  std::unique_ptr<ShardedRemoteDBM::Iterator> iter(new ShardedRemoteDBM::Iterator(this));
+  return iter;
+}
+
+void ShardedRemoteDBM::BuildRing(const std::vector<std::string>& names) {
+  ring_.clear();
+  for (int32_t i = 0; i < static_cast<int32_t>(names.size()); i++) {
+    for (int32_t j = 0; j < SHARD_NUM_VIRTUAL_NODES; j++) {
+      const std::string node_name = StrCat(names[i], "#", j);
+      ring_.emplace_back(std::make_pair(HashMurmur(node_name, SHARD_HASH_SEED), i));
+    }
+  }
+  std::sort(ring_.begin(), ring_.end());
+}
+
+int32_t ShardedRemoteDBM::LocateShard(std::string_view key) const {
+  if (ring_.empty()) {
+    return 0;
+  }
+  const uint64_t hash = HashMurmur(key, SHARD_HASH_SEED);
+  auto it = std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(hash, INT32MIN));
+  if (it == ring_.end()) {
+    it = ring_.begin();
+  }
+  return it->second;
+}
+
+}  // namespace tkrzw
+
+// END OF FILE
@@ -0,0 +1,361 @@
+/*************************************************************************************************
+ * Sharded remote database manager implementation based on gRPC
+ *
+ * Copyright 2020 Google LLC
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain a copy of the License at
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software distributed under the
+ * License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied.  See the License for the specific language governing permissions
+ * and limitations under the License.
+ *************************************************************************************************/
+
+#ifndef _TKRZW_DBM_REMOTE_SHARD_H
+#define _TKRZW_DBM_REMOTE_SHARD_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tkrzw_dbm_remote.h"
+#include "tkrzw_lib_common.h"
+#include "tkrzw_str_util.h"
+
+namespace tkrzw {
+
+class SlottedSharedMutex;
+
+/**
+ * RPC interface to access multiple database servers as one sharded database.
+ * @details Each record is stored in one of the servers, which is determined by consistent
+ * hashing of the key.  Adding or removing a server moves only records of the affected part of
+ * the hash ring.  Operations on multiple records are split by the servers and the parts are
+ * sent as asynchronous calls in parallel.  All operations are thread-safe.  Connection and
+ * disconnection wait for operations in flight to finish.
+ */
+class ShardedRemoteDBM final {
+ public:
+  /**
+   * Iterator for each record.
+   * @details The records of all shards are visited in ascending order of the keys, by merging
+   * the iterators of the shards.  It is meaningful only if the servers use ordered databases.
+   * The iterator keeps the shard objects alive so it is safe to use it after the database is
+   * disconnected, in which case its operations fail with PRECONDITION_ERROR.
+   */
+  class Iterator final {
+    friend class ShardedRemoteDBM;
+   public:
+    /**
+     * Destructor.
+     */
+    ~Iterator() = default;
+
+    /**
+     * Copy and assignment are disabled.
+     */
+    explicit Iterator(const Iterator& rhs) = delete;
+    Iterator& operator =(const Iterator& rhs) = delete;
+
+    /**
+     * Initializes the iterator to indicate the first record.
+     * @return The result status.
+     */
+    Status First();
+
+    /**
+     * Initializes the iterator to indicate a specific record.
+     * @param key The key of the record to look for.
+     * @return The result status.
+     * @details The iterator indicates the first record whose key is equal to or greater than
+     * the given key.
+     */
+    Status Jump(std::string_view key);
+
+    /**
+     * Moves the iterator to the next record.
+     * @return The result status.
+     */
+    Status Next();
+
+    /**
+     * Gets the key and the value of the current record of the iterator.
+     * @param key The pointer to a string object to contain the record key.  If it is nullptr,
+     * the key data is ignored.
+     * @param value The pointer to a string object to contain the record value.  If it is
+     * nullptr, the value data is ignored.
+     * @return The result status.  If there's no record to visit, NOT_FOUND_ERROR is returned.
+     */
+    Status Get(std::string* key = nullptr, std::string* value = nullptr);
+
+   private:
+    /** The cursor of each shard. */
+    struct Cursor {
+      /** The database object of the shard, which outlives the iterator. */
+      std::shared_ptr<RemoteDBM> dbm;
+      /** The iterator of the shard. */
+      std::unique_ptr<RemoteDBM::Iterator> iter;
+      /** Whether the iterator indicates a record. */
+      bool valid = false;
+      /** The key of the current record. */
+      std::string key;
+      /** The value of the current record. */
+      std::string value;
+    };
+
+    /**
+     * Constructor.
+     * @param dbm The database object.
+     */
+    explicit Iterator(ShardedRemoteDBM* dbm);
+
+    /**
+     * Reads the current record of a cursor.
+     * @param cursor The cursor.
+     * @return The result status.
+     */
+    Status ReadCursor(Cursor* cursor);
+
+    /**
+     * Finds the cursor of the minimum key.
+     * @return The index of the cursor, or -1 if there's no valid cursor.
+     */
+    int32_t FindMinimum();
+
+    /** The cursors of the shards. */
+    std::vector<Cursor> cursors_;
+  };
+
+  /**
+   * Default constructor.
+   */
+  ShardedRemoteDBM();
+
+  /**
+   * Destructor.
+   */
+  ~ShardedRemoteDBM();
+
+  /**
+   * Copy and assignment are disabled.
+   */
+  explicit ShardedRemoteDBM(const ShardedRemoteDBM& rhs) = delete;
+  ShardedRemoteDBM& operator =(const ShardedRemoteDBM& rhs) = delete;
+
+  /**
+   * Injects stubs of the shards for testing.
+   * @param stubs The pointers to the stub objects.  Their ownership is taken.
+   */
+  void InjectStubs(const std::vector<void*>& stubs);
+
+  /**
+   * Connects to the servers.
+   * @param addresses The addresses of the servers.  The order doesn't matter because the
+   * assignment of records is determined by hashing of the addresses.
+   * @param timeout The timeout in seconds for connection and each operation.  Negative means
+   * unlimited.
+   * @param num_channels The number of channels to each server.
+   * @return The result status.
+   */
+  Status Connect(const std::vector<std::string>& addresses, double timeout = -1,
+                 int32_t num_channels = 1);
+
+  /**
+   * Connects to the servers with detailed options.
+   * @param addresses The addresses of the servers.
+   * @param options The options of the connection to each server.
+   * @return The result status.
+   */
+  Status Connect(const std::vector<std::string>& addresses,
+                 const RemoteDBM::ConnectOptions& options);
+
+  /**
+   * Disconnects the connections to the servers.
+   * @return The result status.
+   */
+  Status Disconnect();
+
+  /**
+   * Sets the index of the DBM to access.
+   * @param dbm_index The index of the DBM to access.
+   * @return The result status.
+   */
+  Status SetDBMIndex(int32_t dbm_index);
+
+  /**
+   * Gets the number of shards.
+   * @return The number of shards.
+   */
+  int32_t GetNumShards() const;
+
+  /**
+   * Gets the index of the shard which a key belongs to.
+   * @param key The key of a record.
+   * @return The index of the shard.
+   */
+  int32_t GetShardIndex(std::string_view key) const;
+
+  /**
+   * Gets the database object of a shard.
+   * @param index The index of the shard.
+   * @return The database object of the shard, or nullptr if the index is out of range.  It is
+   * valid until the database is disconnected.
+   */
+  RemoteDBM* GetShard(int32_t index);
+
+  /**
+   * Gets the value of a record of a key.
+   * @param key The key of the record.
+   * @param value The pointer to a string object to contain the result value.  If it is nullptr,
+   * the value data is ignored.
+   * @return The result status.  If there's no matching record, NOT_FOUND_ERROR is returned.
+   */
+  Status Get(std::string_view key, std::string* value = nullptr);
+
+  /**
+   * Gets the value of a record of a key, in a simple way.
+   * @param key The key of the record.
+   * @param default_value The value to be returned on failure.
+   * @return The value of the matching record on success, or the default value on failure.
+   */
+  std::string GetSimple(std::string_view key, std::string_view default_value = "") {
+    std::string value;
+    return Get(key, &value) == Status::SUCCESS ? value : std::string(default_value);
+  }
+
+  /**
+   * Gets the values of multiple records of keys.
+   * @param keys The keys of records to retrieve.
+   * @param records The pointer to a map to store retrieved records.  Keys which don't match
+   * existing records are ignored.
+   * @return The result status.  If all records of the given keys are found, SUCCESS is returned.
+   * If one or more records are missing, NOT_FOUND_ERROR is returned.  Other errors take
+   * precedence over NOT_FOUND_ERROR.
+   */
+  Status GetMulti(
+      const std::vector<std::string_view>& keys, std::map<std::string, std::string>* records);
+
+  /**
+   * Sets a record of a key and a value.
+   * @param key The key of the record.
+   * @param value The value of the record.
+   * @param overwrite Whether to overwrite the existing value if there's a record with the same
+   * key.
+   * @return The result status.  If overwriting is abandoned, DUPLICATION_ERROR is returned.
+   */
+  Status Set(std::string_view key, std::string_view value, bool overwrite = true);
+
+  /**
+   * Sets multiple records.
+   * @param records The records to store.
+   * @param overwrite Whether to overwrite the existing value if there's a record with the same
+   * key.
+   * @return The result status.  If there are records avoiding overwriting, DUPLICATION_ERROR
+   * is returned.
+   */
+  Status SetMulti(
+      const std::map<std::string_view, std::string_view>& records, bool overwrite = true);
+
+  /**
+   * Removes a record of a key.
+   * @param key The key of the record.
+   * @return The result status.  If there's no matching record, NOT_FOUND_ERROR is returned.
+   */
+  Status Remove(std::string_view key);
+
+  /**
+   * Removes records of keys.
+   * @param keys The keys of records to remove.
+   * @return The result status.  If there are missing records, NOT_FOUND_ERROR is returned.
+   */
+  Status RemoveMulti(const std::vector<std::string_view>& keys);
+
+  /**
+   * Appends data at the end of a record of a key.
+   * @param key The key of the record.
+   * @param value The value to append.
+   * @param delim The delimiter to put after the existing record.
+   * @return The result status.
+   */
+  Status Append(std::string_view key, std::string_view value, std::string_view delim = "");
+
+  /**
+   * Appends data to multiple records.
+   * @param records The records to append.
+   * @param delim The delimiter to put after the existing record.
+   * @return The result status.
+   */
+  Status AppendMulti(
+      const std::map<std::string_view, std::string_view>& records, std::string_view delim = "");
+
+  /**
+   * Compares the value of a record and exchanges if the condition meets.
+   * @param key The key of the record.
+   * @param expected The expected value.  If the data is nullptr, no existing record is expected.
+   * @param desired The desired value.  If the data is nullptr, the record is to be removed.
+   * @return The result status.  If the condition doesn't meet, INFEASIBLE_ERROR is returned.
+   */
+  Status CompareExchange(std::string_view key, std::string_view expected,
+                         std::string_view desired);
+
+  /**
+   * Increments the numeric value of a record.
+   * @param key The key of the record.
+   * @param increment The incremental value.
+   * @param current The pointer to an integer to contain the current value.  If it is nullptr,
+   * it is ignored.
+   * @param initial The initial value.
+   * @return The result status.
+   */
+  Status Increment(std::string_view key, int64_t increment = 1,
+                   int64_t* current = nullptr, int64_t initial = 0);
+
+  /**
+   * Gets the number of records of all shards.
+   * @param count The pointer to an integer object to contain the result count.
+   * @return The result status.
+   */
+  Status Count(int64_t* count);
+
+  /**
+   * Removes all records of all shards.
+   * @return The result status.
+   */
+  Status Clear();
+
+  /**
+   * Makes an iterator which visits records of all shards.
+   * @return The iterator for each record.
+   */
+  std::unique_ptr<Iterator> MakeIterator();
+
+ private:
+  /**
+   * Builds the hash ring.
+   * @param names The names of the shards.
+   */
+  void BuildRing(const std::vector<std::string>& names);
+
+  /**
+   * Gets the index of the shard which a key belongs to, without locking.
+   * @param key The key of a record.
+   * @return The index of the shard.
+   */
+  int32_t LocateShard(std::string_view key) const;
+
+  /** The database objects of the shards. */
+  std::vector<std::shared_ptr<RemoteDBM>> shards_;
+  /** The hash ring of pairs of the hash value and the shard index. */
+  std::vector<std::pair<uint64_t, int32_t>> ring_;
+  /** The mutex to guard the shards and the hash ring. */
+  std::unique_ptr<SlottedSharedMutex> mutex_;
+};
+
+}  // namespace tkrzw
+
+#endif  // _TKRZW_DBM_REMOTE_SHARD_H
+
+// END OF FILE
@@ -15,10 +15,13 @@
 
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
+#include "grpcpp/alarm.h"
 #include "grpcpp/test/mock_stream.h"
 
 #include "tkrzw_dbm_remote.h"
+#include "tkrzw_dbm_remote_shard.h"
 #include "tkrzw_lib_common.h"
+#include "tkrzw_rpc_common.h"
 #include "tkrzw_rpc_mock.grpc.pb.h"
 #include "tkrzw_rpc.pb.h"
 #include "tkrzw_str_util.h"
@@ -37,6 +40,33 @@ MATCHER_P(EqualsProto, rhs, "Equality matcher for protos") {
   return google::protobuf::util::MessageDifferencer::Equivalent(arg, rhs);
 }
 
+// Makes mock readers of asynchronous calls which complete after a delay.
+class AsyncResponder {
+ public:
+  template <typename RESPONSE>
+  grpc::ClientAsyncResponseReaderInterface<RESPONSE>* Respond(
+      grpc::CompletionQueue* queue, const RESPONSE& response, const grpc::Status& status,
+      double delay = 0) {
+    auto* reader = new grpc::testing::MockClientAsyncResponseReader<RESPONSE>();
+    EXPECT_CALL(*reader, Finish(_, _, _)).WillOnce(Invoke(
+        [this, queue, response, status, delay](
+            RESPONSE* out_response, grpc::Status* out_status, void* tag) {
+          *out_response = response;
+          *out_status = status;
+          std::lock_guard<std::mutex> lock(mutex_);
+          alarms_.emplace_back(std::make_unique<grpc::Alarm>());
+          alarms_.back()->Set(queue, std::chrono::system_clock::now() +
+                              std::chrono::microseconds(static_cast<int64_t>(delay * 1000000)),
+                              tag);
+        }));
+    return reader;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<grpc::Alarm>> alarms_;
+};
+
 TEST_F(RemoteDBMTest, Echo) {
   auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
   tkrzw::EchoRequest request;
@@ -123,6 +153,240 @@ TEST_F(RemoteDBMTest, GetMulti) {
   EXPECT_EQ("value", records["key"]);
 }
 
+TEST_F(RemoteDBMTest, ReplicaRouting) {
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  auto fresh_stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  auto stale_stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::HeartbeatResponse fresh_heartbeat;
+  fresh_heartbeat.set_master("master");
+  fresh_heartbeat.set_replicating(true);
+  fresh_heartbeat.set_lag(100);
+  EXPECT_CALL(*fresh_stub, Heartbeat(_, _, _)).WillRepeatedly(
+      DoAll(SetArgPointee<2>(fresh_heartbeat), Return(grpc::Status::OK)));
+  tkrzw::HeartbeatResponse stale_heartbeat = fresh_heartbeat;
+  stale_heartbeat.set_lag(5000);
+  EXPECT_CALL(*stale_stub, Heartbeat(_, _, _)).WillRepeatedly(
+      DoAll(SetArgPointee<2>(stale_heartbeat), Return(grpc::Status::OK)));
+  tkrzw::GetRequest request;
+  request.set_key("key");
+  tkrzw::GetResponse replica_response;
+  replica_response.set_value("replica");
+  tkrzw::GetResponse infeasible_response;
+  infeasible_response.mutable_status()->set_code(tkrzw::Status::INFEASIBLE_ERROR);
+  EXPECT_CALL(*fresh_stub, Get(_, EqualsProto(request), _))
+      .WillOnce(DoAll(SetArgPointee<2>(replica_response), Return(grpc::Status::OK)))
+      .WillOnce(DoAll(SetArgPointee<2>(infeasible_response), Return(grpc::Status::OK)))
+      .WillOnce(Return(grpc::Status(grpc::StatusCode::UNAVAILABLE, "unavailable")));
+  EXPECT_CALL(*stale_stub, Get(_, _, _)).Times(0);
+  tkrzw::GetResponse master_response;
+  master_response.set_value("master");
+  EXPECT_CALL(*stub, Get(_, EqualsProto(request), _)).Times(3).WillRepeatedly(
+      DoAll(SetArgPointee<2>(master_response), Return(grpc::Status::OK)));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.InjectReplicaStubs(
+      {fresh_stub.release(), stale_stub.release()}, 1.0, 100.0));
+  EXPECT_EQ("replica", dbm.GetSimple("key"));
+  EXPECT_EQ("master", dbm.GetSimple("key"));
+  EXPECT_EQ("master", dbm.GetSimple("key"));
+  EXPECT_EQ("master", dbm.GetSimple("key"));
+}
+
+TEST_F(RemoteDBMTest, Cache) {
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  EXPECT_CALL(*stub, Heartbeat(_, _, _)).WillRepeatedly(
+      Return(grpc::Status(grpc::StatusCode::UNAVAILABLE, "unavailable")));
+  tkrzw::GetRequest get_request;
+  get_request.set_key("key");
+  tkrzw::GetResponse get_response;
+  get_response.set_value("value");
+  EXPECT_CALL(*stub, Get(_, EqualsProto(get_request), _)).Times(2).WillRepeatedly(
+      DoAll(SetArgPointee<2>(get_response), Return(grpc::Status::OK)));
+  tkrzw::SetRequest set_request;
+  set_request.set_key("key");
+  set_request.set_value("new");
+  set_request.set_overwrite(true);
+  tkrzw::SetResponse set_response;
+  EXPECT_CALL(*stub, Set(_, EqualsProto(set_request), _)).WillOnce(
+      DoAll(SetArgPointee<2>(set_response), Return(grpc::Status::OK)));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.EnableCache(10, 60));
+  EXPECT_EQ("value", dbm.GetSimple("key"));
+  EXPECT_EQ("value", dbm.GetSimple("key"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Set("key", "new"));
+  EXPECT_EQ("value", dbm.GetSimple("key"));
+  std::vector<std::pair<std::string, std::string>> records;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.InspectClient(&records));
+  std::map<std::string, std::string> stats(records.begin(), records.end());
+  EXPECT_EQ("1", stats["cache_num_records"]);
+  EXPECT_EQ("1", stats["cache_num_hits"]);
+  EXPECT_EQ("2", stats["cache_num_misses"]);
+}
+
+TEST_F(RemoteDBMTest, CacheStaleness) {
+  auto stream = std::make_unique<grpc::testing::MockClientReaderWriter<
+    tkrzw::StreamRequest, tkrzw::StreamResponse>>();
+  tkrzw::StreamRequest request_set;
+  auto* set_req = request_set.mutable_set_request();
+  set_req->set_key("key");
+  set_req->set_value("new");
+  set_req->set_overwrite(true);
+  tkrzw::StreamResponse response_set;
+  response_set.mutable_set_response()->set_timestamp(12345);
+  EXPECT_CALL(*stream, Write(EqualsProto(request_set), _)).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Read(_)).WillOnce(DoAll(SetArgPointee<0>(response_set), Return(true)));
+  EXPECT_CALL(*stream, WritesDone()).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Finish()).WillOnce(Return(grpc::Status::OK));
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  EXPECT_CALL(*stub, Heartbeat(_, _, _)).WillRepeatedly(
+      Return(grpc::Status(grpc::StatusCode::UNAVAILABLE, "unavailable")));
+  EXPECT_CALL(*stub, StreamRaw(_)).WillOnce(Return(stream.release()));
+  tkrzw::GetRequest get_request;
+  get_request.set_key("key");
+  tkrzw::GetResponse get_response;
+  get_response.set_value("value");
+  tkrzw::GetResponse new_get_response;
+  new_get_response.set_value("new");
+  EXPECT_CALL(*stub, Get(_, EqualsProto(get_request), _))
+      .WillOnce(DoAll(SetArgPointee<2>(get_response), Return(grpc::Status::OK)))
+      .WillOnce(DoAll(SetArgPointee<2>(new_get_response), Return(grpc::Status::OK)));
+  tkrzw::GetRequest fenced_get_request;
+  fenced_get_request.set_key("key");
+  fenced_get_request.set_min_timestamp(12345);
+  EXPECT_CALL(*stub, Get(_, EqualsProto(fenced_get_request), _)).Times(2).WillRepeatedly(
+      DoAll(SetArgPointee<2>(new_get_response), Return(grpc::Status::OK)));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.EnableCache(10, 60));
+  EXPECT_EQ("value", dbm.GetSimple("key"));
+  {
+    auto strm = dbm.MakeStream();
+    EXPECT_EQ(tkrzw::Status::SUCCESS, strm->Set("key", "new"));
+  }
+  EXPECT_EQ("new", dbm.GetSimple("key"));
+  EXPECT_EQ("new", dbm.GetSimple("key"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.SetMinTimestamp(12345));
+  EXPECT_EQ("new", dbm.GetSimple("key"));
+  EXPECT_EQ("new", dbm.GetSimple("key"));
+}
+
+TEST_F(RemoteDBMTest, Retry) {
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::GetRequest request;
+  request.set_key("key");
+  tkrzw::GetResponse response;
+  response.set_value("value");
+  EXPECT_CALL(*stub, Get(_, EqualsProto(request), _))
+      .WillOnce(Return(grpc::Status(grpc::StatusCode::UNAVAILABLE, "unavailable")))
+      .WillOnce(DoAll(SetArgPointee<2>(response), Return(grpc::Status::OK)));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  tkrzw::RemoteDBM::RetryPolicy policy;
+  policy.retryable_codes = {"UNKNOWN_CODE"};
+  EXPECT_EQ(tkrzw::Status::INVALID_ARGUMENT_ERROR, dbm.SetRetryPolicy(policy));
+  policy.max_attempts = 3;
+  policy.initial_backoff = 0.001;
+  policy.retryable_codes = {"UNAVAILABLE", "DEADLINE_EXCEEDED"};
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.SetRetryPolicy(policy));
+  std::string value;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Get("key", &value));
+  EXPECT_EQ("value", value);
+  std::vector<std::pair<std::string, std::string>> records;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.InspectClient(&records));
+  std::map<std::string, std::string> stats(records.begin(), records.end());
+  EXPECT_EQ("1", stats["retry_num_retries"]);
+  EXPECT_EQ("0", stats["hedge_num_sent"]);
+}
+
+TEST_F(RemoteDBMTest, Hedging) {
+  AsyncResponder responder;
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  EXPECT_CALL(*stub, Heartbeat(_, _, _)).WillRepeatedly(
+      Return(grpc::Status(grpc::StatusCode::UNAVAILABLE, "unavailable")));
+  auto replica_stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::HeartbeatResponse heartbeat;
+  heartbeat.set_master("master");
+  heartbeat.set_replicating(true);
+  EXPECT_CALL(*replica_stub, Heartbeat(_, _, _)).WillRepeatedly(
+      DoAll(SetArgPointee<2>(heartbeat), Return(grpc::Status::OK)));
+  tkrzw::GetRequest request;
+  request.set_key("key");
+  tkrzw::GetResponse replica_response;
+  replica_response.set_value("replica");
+  EXPECT_CALL(*replica_stub, AsyncGetRaw(_, EqualsProto(request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, replica_response, grpc::Status::OK, 0.5);
+      }));
+  tkrzw::GetResponse master_response;
+  master_response.set_value("master");
+  EXPECT_CALL(*stub, AsyncGetRaw(_, EqualsProto(request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, master_response, grpc::Status::OK);
+      }));
+  tkrzw::RemoteDBM::RetryPolicy policy;
+  policy.hedge_delay = 0.05;
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            dbm.InjectReplicaStubs({replica_stub.release()}, 1.0, 100.0));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.SetRetryPolicy(policy));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.EnableCache(10, 60));
+  EXPECT_EQ("master", dbm.GetSimple("key"));
+  EXPECT_EQ("master", dbm.GetSimple("key"));
+  std::vector<std::pair<std::string, std::string>> records;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.InspectClient(&records));
+  std::map<std::string, std::string> stats(records.begin(), records.end());
+  EXPECT_EQ("1", stats["hedge_num_sent"]);
+  EXPECT_EQ("1", stats["hedge_num_won"]);
+  EXPECT_EQ("1", stats["cache_num_hits"]);
+  auto single_stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  EXPECT_CALL(*single_stub, AsyncGetRaw(_, EqualsProto(request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, master_response, grpc::Status::OK, 0.1);
+      }));
+  tkrzw::RemoteDBM single_dbm;
+  single_dbm.InjectStub(single_stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, single_dbm.SetRetryPolicy(policy));
+  EXPECT_EQ("master", single_dbm.GetSimple("key"));
+  records.clear();
+  EXPECT_EQ(tkrzw::Status::SUCCESS, single_dbm.InspectClient(&records));
+  stats = std::map<std::string, std::string>(records.begin(), records.end());
+  EXPECT_EQ("0", stats["hedge_num_sent"]);
+}
+
+TEST_F(RemoteDBMTest, Batching) {
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::GetMultiRequest get_request;
+  get_request.add_keys("key");
+  tkrzw::GetMultiResponse get_response;
+  auto* record = get_response.add_records();
+  record->set_first("key");
+  record->set_second("value");
+  EXPECT_CALL(*stub, GetMulti(_, EqualsProto(get_request), _)).WillOnce(
+      DoAll(SetArgPointee<2>(get_response), Return(grpc::Status::OK)));
+  tkrzw::RemoveMultiRequest remove_request;
+  remove_request.add_keys("missing");
+  remove_request.set_report_missing(true);
+  tkrzw::RemoveMultiResponse remove_response;
+  remove_response.mutable_status()->set_code(tkrzw::Status::NOT_FOUND_ERROR);
+  remove_response.add_missing_keys("missing");
+  EXPECT_CALL(*stub, RemoveMulti(_, EqualsProto(remove_request), _)).WillOnce(
+      DoAll(SetArgPointee<2>(remove_response), Return(grpc::Status::OK)));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.EnableBatching(0, 10));
+  std::string value;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Get("key", &value));
+  EXPECT_EQ("value", value);
+  EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, dbm.Remove("missing"));
+  std::vector<std::pair<std::string, std::string>> records;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.InspectClient(&records));
+  std::map<std::string, std::string> stats(records.begin(), records.end());
+  EXPECT_EQ("2", stats["batch_num_batches"]);
+  EXPECT_EQ("2", stats["batch_num_calls"]);
+}
+
 TEST_F(RemoteDBMTest, Set) {
   auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
   tkrzw::SetRequest request;
@@ -138,6 +402,34 @@ TEST_F(RemoteDBMTest, Set) {
   EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Set("key", "value"));
 }
 
+TEST_F(RemoteDBMTest, MinTimestamp) {
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::SetRequest set_request;
+  set_request.set_key("key");
+  set_request.set_value("value");
+  set_request.set_overwrite(true);
+  tkrzw::SetResponse set_response;
+  set_response.set_timestamp(12345);
+  EXPECT_CALL(*stub, Set(_, EqualsProto(set_request), _)).WillOnce(
+      DoAll(SetArgPointee<2>(set_response), Return(grpc::Status::OK)));
+  tkrzw::GetRequest get_request;
+  get_request.set_key("key");
+  get_request.set_min_timestamp(12345);
+  tkrzw::GetResponse get_response;
+  get_response.set_value("value");
+  EXPECT_CALL(*stub, Get(_, EqualsProto(get_request), _)).WillOnce(
+      DoAll(SetArgPointee<2>(get_response), Return(grpc::Status::OK)));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(0, dbm.GetLastTimestamp());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Set("key", "value"));
+  EXPECT_EQ(12345, dbm.GetLastTimestamp());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.SetMinTimestamp(dbm.GetLastTimestamp()));
+  std::string value;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Get("key", &value));
+  EXPECT_EQ("value", value);
+}
+
 TEST_F(RemoteDBMTest, SetMulti) {
   auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
   tkrzw::SetMultiRequest request;
@@ -264,6 +556,49 @@ TEST_F(RemoteDBMTest, CompareExchangeMulti) {
   EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.CompareExchangeMulti(expected, desired));
 }
 
+TEST_F(RemoteDBMTest, Batch) {
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::BatchRequest request;
+  auto* op = request.add_operations();
+  op->set_operation(tkrzw::BatchOperation::OP_SET);
+  op->set_key("key");
+  op->set_value("value");
+  op->set_overwrite(true);
+  op = request.add_operations();
+  op->set_operation(tkrzw::BatchOperation::OP_GET);
+  op->set_dbm_index(1);
+  op->set_key("key");
+  op = request.add_operations();
+  op->set_operation(tkrzw::BatchOperation::OP_INCREMENT);
+  op->set_dbm_index(1);
+  op->set_key("num");
+  op->set_increment(5);
+  op->set_initial(100);
+  request.set_atomic(false);
+  tkrzw::BatchResponse response;
+  response.mutable_status()->set_code(tkrzw::Status::NOT_FOUND_ERROR);
+  response.add_results();
+  response.add_results()->mutable_status()->set_code(tkrzw::Status::NOT_FOUND_ERROR);
+  response.add_results()->set_current(105);
+  EXPECT_CALL(*stub, Batch(_, EqualsProto(request), _)).WillOnce(
+      DoAll(SetArgPointee<2>(response), Return(grpc::Status::OK)));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  tkrzw::RemoteDBM::Batch batch;
+  EXPECT_EQ(0, batch.Set("key", "value"));
+  batch.SetDBMIndex(1);
+  EXPECT_EQ(1, batch.Get("key"));
+  EXPECT_EQ(2, batch.Increment("num", 5, 100));
+  EXPECT_EQ(3, batch.GetNumOperations());
+  EXPECT_EQ(tkrzw::Status::PRECONDITION_ERROR, batch.GetResult(0));
+  EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, dbm.ExecuteBatch(&batch));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, batch.GetResult(0));
+  EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, batch.GetResult(1));
+  int64_t current = 0;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, batch.GetResult(2, nullptr, &current));
+  EXPECT_EQ(105, current);
+}
+
 TEST_F(RemoteDBMTest, Count) {
   auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
   tkrzw::CountRequest request;
@@ -365,6 +700,208 @@ TEST_F(RemoteDBMTest, SearchModal) {
   EXPECT_THAT(matched, UnorderedElementsAre("5", "15", "25"));
 }
 
+TEST_F(RemoteDBMTest, AsyncFuture) {
+  AsyncResponder responder;
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::GetRequest get_request;
+  get_request.set_key("one");
+  tkrzw::GetResponse get_response;
+  get_response.set_value("first");
+  EXPECT_CALL(*stub, AsyncGetRaw(_, EqualsProto(get_request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, get_response, grpc::Status::OK);
+      }));
+  tkrzw::GetMultiRequest get_multi_request;
+  get_multi_request.add_keys("one");
+  get_multi_request.add_keys("two");
+  tkrzw::GetMultiResponse get_multi_response;
+  auto* record = get_multi_response.add_records();
+  record->set_first("one");
+  record->set_second("first");
+  get_multi_response.mutable_status()->set_code(tkrzw::Status::NOT_FOUND_ERROR);
+  EXPECT_CALL(*stub, AsyncGetMultiRaw(_, EqualsProto(get_multi_request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetMultiRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, get_multi_response, grpc::Status::OK);
+      }));
+  tkrzw::SetRequest set_request;
+  set_request.set_key("two");
+  set_request.set_value("second");
+  set_request.set_overwrite(true);
+  tkrzw::SetResponse set_response;
+  set_response.set_timestamp(123);
+  EXPECT_CALL(*stub, AsyncSetRaw(_, EqualsProto(set_request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::SetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, set_response, grpc::Status::OK);
+      }));
+  tkrzw::RemoveRequest remove_request;
+  remove_request.set_key("three");
+  EXPECT_CALL(*stub, AsyncRemoveRaw(_, EqualsProto(remove_request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::RemoveRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, tkrzw::RemoveResponse(),
+                                 grpc::Status(grpc::StatusCode::UNAVAILABLE, "unavailable"));
+      }));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.SetAsyncThreads(2));
+  auto get_future = dbm.GetAsync("one");
+  auto get_multi_future = dbm.GetMultiAsync({"one", "two"});
+  auto set_future = dbm.SetAsync("two", "second");
+  auto remove_future = dbm.RemoveAsync("three");
+  const auto get_result = get_future.get();
+  EXPECT_EQ(tkrzw::Status::SUCCESS, get_result.first);
+  EXPECT_EQ("first", get_result.second);
+  const auto get_multi_result = get_multi_future.get();
+  EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, get_multi_result.first);
+  EXPECT_EQ(1, get_multi_result.second.size());
+  EXPECT_EQ("first", get_multi_result.second.at("one"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, set_future.get());
+  EXPECT_EQ(123, dbm.GetLastTimestamp());
+  EXPECT_EQ(tkrzw::Status::NETWORK_ERROR, remove_future.get());
+}
+
+TEST_F(RemoteDBMTest, AsyncCallback) {
+  AsyncResponder responder;
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::GetRequest get_request;
+  get_request.set_key("one");
+  tkrzw::GetResponse get_response;
+  get_response.set_value("first");
+  EXPECT_CALL(*stub, AsyncGetRaw(_, EqualsProto(get_request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, get_response, grpc::Status::OK);
+      }));
+  tkrzw::GetMultiRequest get_multi_request;
+  get_multi_request.add_keys("one");
+  tkrzw::GetMultiResponse get_multi_response;
+  auto* record = get_multi_response.add_records();
+  record->set_first("one");
+  record->set_second("first");
+  EXPECT_CALL(*stub, AsyncGetMultiRaw(_, EqualsProto(get_multi_request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetMultiRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, get_multi_response, grpc::Status::OK);
+      }));
+  tkrzw::SetRequest set_request;
+  set_request.set_key("one");
+  set_request.set_value("first");
+  tkrzw::SetResponse set_response;
+  set_response.mutable_status()->set_code(tkrzw::Status::DUPLICATION_ERROR);
+  EXPECT_CALL(*stub, AsyncSetRaw(_, EqualsProto(set_request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::SetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, set_response, grpc::Status::OK);
+      }));
+  tkrzw::RemoveRequest remove_request;
+  remove_request.set_key("one");
+  EXPECT_CALL(*stub, AsyncRemoveRaw(_, EqualsProto(remove_request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::RemoveRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, tkrzw::RemoveResponse(), grpc::Status::OK);
+      }));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  std::promise<std::pair<tkrzw::Status, std::string>> get_promise;
+  dbm.GetAsync("one", [&](const tkrzw::Status& status, const std::string& value) {
+    get_promise.set_value(std::make_pair(status, value));
+  });
+  const auto get_result = get_promise.get_future().get();
+  EXPECT_EQ(tkrzw::Status::SUCCESS, get_result.first);
+  EXPECT_EQ("first", get_result.second);
+  std::promise<std::map<std::string, std::string>> get_multi_promise;
+  dbm.GetMultiAsync({"one"}, [&](const tkrzw::Status& status,
+                                 const std::map<std::string, std::string>& records) {
+    EXPECT_EQ(tkrzw::Status::SUCCESS, status);
+    get_multi_promise.set_value(records);
+  });
+  const auto records = get_multi_promise.get_future().get();
+  EXPECT_EQ(1, records.size());
+  EXPECT_EQ("first", records.at("one"));
+  std::promise<tkrzw::Status> set_promise;
+  dbm.SetAsync("one", "first", false, [&](const tkrzw::Status& status) {
+    set_promise.set_value(status);
+  });
+  EXPECT_EQ(tkrzw::Status::DUPLICATION_ERROR, set_promise.get_future().get());
+  std::promise<tkrzw::Status> remove_promise;
+  dbm.RemoveAsync("one", [&](const tkrzw::Status& status) {
+    remove_promise.set_value(status);
+  });
+  EXPECT_EQ(tkrzw::Status::SUCCESS, remove_promise.get_future().get());
+}
+
+TEST_F(RemoteDBMTest, AsyncReplicaFallback) {
+  AsyncResponder responder;
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  auto replica_stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::HeartbeatResponse heartbeat;
+  heartbeat.set_master("master");
+  heartbeat.set_replicating(true);
+  EXPECT_CALL(*replica_stub, Heartbeat(_, _, _)).WillRepeatedly(
+      DoAll(SetArgPointee<2>(heartbeat), Return(grpc::Status::OK)));
+  tkrzw::GetRequest request;
+  request.set_key("one");
+  tkrzw::GetResponse replica_response;
+  replica_response.set_value("replica");
+  tkrzw::GetResponse infeasible_response;
+  infeasible_response.mutable_status()->set_code(tkrzw::Status::INFEASIBLE_ERROR);
+  EXPECT_CALL(*replica_stub, AsyncGetRaw(_, EqualsProto(request), _))
+      .WillOnce(Invoke(
+          [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+            return responder.Respond(queue, replica_response, grpc::Status::OK);
+          }))
+      .WillOnce(Invoke(
+          [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+            return responder.Respond(queue, infeasible_response, grpc::Status::OK);
+          }))
+      .WillOnce(Invoke(
+          [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+            return responder.Respond(queue, tkrzw::GetResponse(),
+                                     grpc::Status(grpc::StatusCode::UNAVAILABLE, "down"));
+          }));
+  tkrzw::GetResponse master_response;
+  master_response.set_value("master");
+  EXPECT_CALL(*stub, AsyncGetRaw(_, EqualsProto(request), _)).Times(3).WillRepeatedly(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, master_response, grpc::Status::OK);
+      }));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            dbm.InjectReplicaStubs({replica_stub.release()}, 1.0, 100.0));
+  EXPECT_EQ("replica", dbm.GetAsync("one").get().second);
+  EXPECT_EQ("master", dbm.GetAsync("one").get().second);
+  EXPECT_EQ("master", dbm.GetAsync("one").get().second);
+  EXPECT_EQ("master", dbm.GetAsync("one").get().second);
+}
+
+TEST_F(RemoteDBMTest, AsyncDisconnect) {
+  AsyncResponder responder;
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  tkrzw::GetRequest request;
+  request.set_key("one");
+  tkrzw::GetResponse response;
+  response.set_value("first");
+  EXPECT_CALL(*stub, AsyncGetRaw(_, EqualsProto(request), _)).WillOnce(Invoke(
+      [&](grpc::ClientContext*, const tkrzw::GetRequest&, grpc::CompletionQueue* queue) {
+        return responder.Respond(queue, response, grpc::Status::OK, 0.2);
+      }));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  std::promise<tkrzw::Status> chained_promise;
+  auto chained_future = chained_promise.get_future();
+  std::promise<std::string> promise;
+  auto future = promise.get_future();
+  dbm.GetAsync("one", [&](const tkrzw::Status& status, const std::string& value) {
+    // The call issued while disconnecting fails without reaching the stub.
+    dbm.GetAsync("two", [&](const tkrzw::Status& chained_status, const std::string&) {
+      chained_promise.set_value(chained_status);
+    });
+    promise.set_value(value);
+  });
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Disconnect());
+  EXPECT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(0)));
+  EXPECT_EQ("first", future.get());
+  EXPECT_EQ(std::future_status::ready, chained_future.wait_for(std::chrono::seconds(0)));
+  EXPECT_EQ(tkrzw::Status::NETWORK_ERROR, chained_future.get());
+  EXPECT_EQ(tkrzw::Status::PRECONDITION_ERROR, dbm.GetAsync("three").get().first);
+}
+
 TEST_F(RemoteDBMTest, Stream) {
   auto stream = std::make_unique<grpc::testing::MockClientReaderWriter<
     tkrzw::StreamRequest, tkrzw::StreamResponse>>();
@@ -443,6 +980,48 @@ TEST_F(RemoteDBMTest, Stream) {
   EXPECT_EQ(105, current);
 }
 
+TEST_F(RemoteDBMTest, StreamReconnect) {
+  auto broken_stream = std::make_unique<grpc::testing::MockClientReaderWriter<
+    tkrzw::StreamRequest, tkrzw::StreamResponse>>();
+  auto stream = std::make_unique<grpc::testing::MockClientReaderWriter<
+    tkrzw::StreamRequest, tkrzw::StreamResponse>>();
+  tkrzw::StreamRequest request_set;
+  auto* set_req = request_set.mutable_set_request();
+  set_req->set_key("key");
+  set_req->set_value("value");
+  set_req->set_overwrite(true);
+  tkrzw::StreamRequest request_echo;
+  request_echo.mutable_echo_request();
+  tkrzw::StreamResponse response_echo;
+  response_echo.mutable_echo_response();
+  tkrzw::StreamResponse response_set;
+  response_set.mutable_set_response();
+  EXPECT_CALL(*broken_stream, Write(EqualsProto(request_set), _)).WillOnce(Return(false));
+  EXPECT_CALL(*broken_stream, Finish()).WillOnce(
+      Return(grpc::Status(grpc::StatusCode::UNAVAILABLE, "restarting")));
+  EXPECT_CALL(*stream, Write(EqualsProto(request_echo), _)).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Write(EqualsProto(request_set), _)).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Read(_))
+      .WillOnce(DoAll(SetArgPointee<0>(response_echo), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<0>(response_set), Return(true)));
+  EXPECT_CALL(*stream, WritesDone()).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Finish()).WillOnce(Return(grpc::Status::OK));
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  EXPECT_CALL(*stub, StreamRaw(_))
+      .WillOnce(Return(broken_stream.release()))
+      .WillOnce(Return(stream.release()));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.EnableAutoReconnect(3, 0, 0));
+  auto strm = dbm.MakeStream();
+  EXPECT_EQ(tkrzw::Status::NETWORK_ERROR, strm->Set("key", "value"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, strm->Set("key", "value"));
+  std::vector<std::pair<std::string, std::string>> records;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.InspectClient(&records));
+  std::map<std::string, std::string> stats(records.begin(), records.end());
+  EXPECT_EQ("1", stats["reconnect_num_successes"]);
+}
+
 TEST_F(RemoteDBMTest, IterateMove) {
   auto stream = std::make_unique<grpc::testing::MockClientReaderWriter<
     tkrzw::IterateRequest, tkrzw::IterateResponse>>();
@@ -566,4 +1145,260 @@ TEST_F(RemoteDBMTest, IterateAction) {
   EXPECT_EQ(tkrzw::Status::SUCCESS, iter->Remove());
 }
 
+TEST_F(RemoteDBMTest, IteratePrefetch) {
+  auto stream = std::make_unique<grpc::testing::MockClientReaderWriter<
+    tkrzw::IterateRequest, tkrzw::IterateResponse>>();
+  tkrzw::IterateRequest request_first;
+  request_first.set_operation(tkrzw::IterateRequest::OP_FIRST);
+  tkrzw::IterateRequest request_next;
+  request_next.set_operation(tkrzw::IterateRequest::OP_NEXT);
+  tkrzw::IterateRequest request_get;
+  request_get.set_operation(tkrzw::IterateRequest::OP_GET);
+  tkrzw::IterateRequest request_jump;
+  request_jump.set_operation(tkrzw::IterateRequest::OP_JUMP);
+  request_jump.set_key("b");
+  tkrzw::IterateRequest request_set;
+  request_set.set_operation(tkrzw::IterateRequest::OP_SET);
+  request_set.set_value("set");
+  tkrzw::IterateResponse response;
+  tkrzw::IterateResponse response_a;
+  response_a.set_key("a");
+  response_a.set_value("A");
+  tkrzw::IterateResponse response_b;
+  response_b.set_key("b");
+  response_b.set_value("B");
+  tkrzw::IterateResponse response_none;
+  response_none.mutable_status()->set_code(tkrzw::Status::NOT_FOUND_ERROR);
+  EXPECT_CALL(*stream, Write(EqualsProto(request_first), _)).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Write(EqualsProto(request_next), _)).Times(3).WillRepeatedly(Return(true));
+  EXPECT_CALL(*stream, Write(EqualsProto(request_get), _)).Times(3).WillRepeatedly(Return(true));
+  EXPECT_CALL(*stream, Write(EqualsProto(request_jump), _)).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Write(EqualsProto(request_set), _)).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Read(_))
+      .WillOnce(DoAll(SetArgPointee<0>(response), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<0>(response), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<0>(response_a), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<0>(response), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<0>(response_b), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<0>(response_none), Return(true)))
+      .WillOnce(DoAll(SetArgPointee<0>(response_none), Return(true)))
+      .WillRepeatedly(DoAll(SetArgPointee<0>(response), Return(true)));
+  EXPECT_CALL(*stream, WritesDone()).WillOnce(Return(true));
+  EXPECT_CALL(*stream, Finish()).WillOnce(Return(grpc::Status::OK));
+  auto stub = std::make_unique<tkrzw::MockDBMServiceStub>();
+  EXPECT_CALL(*stub, IterateRaw(_)).WillRepeatedly(Return(stream.release()));
+  tkrzw::RemoteDBM dbm;
+  dbm.InjectStub(stub.release());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.EnableIteratorPrefetch(2));
+  auto iter = dbm.MakeIterator();
+  EXPECT_EQ(tkrzw::Status::SUCCESS, iter->First());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, iter->Next());
+  std::string key, value;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, iter->Get(&key, &value));
+  EXPECT_EQ("a", key);
+  EXPECT_EQ("A", value);
+  EXPECT_EQ(tkrzw::Status::SUCCESS, iter->Next());
+  EXPECT_EQ("b", iter->GetKey());
+  EXPECT_EQ("B", iter->GetValue());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, iter->Set("set"));
+}
+
+TEST_F(RemoteDBMTest, Sharded) {
+  AsyncResponder responder;
+  auto stub_first = std::make_unique<tkrzw::MockDBMServiceStub>();
+  auto stub_second = std::make_unique<tkrzw::MockDBMServiceStub>();
+  std::vector<tkrzw::MockDBMServiceStub*> raw_stubs = {stub_first.get(), stub_second.get()};
+  tkrzw::ShardedRemoteDBM dbm;
+  dbm.InjectStubs({stub_first.release(), stub_second.release()});
+  EXPECT_EQ(2, dbm.GetNumShards());
+  std::vector<std::string> shard_keys(2);
+  for (int32_t i = 0; shard_keys[0].empty() || shard_keys[1].empty(); i++) {
+    const std::string key = tkrzw::ToString(i);
+    shard_keys[dbm.GetShardIndex(key)] = key;
+  }
+  // Each shard iterates its own records in order.  The first shard fails to move past its
+  // last record while the second one just reaches the end.
+  std::vector<std::vector<std::string>> iter_keys(2);
+  for (int32_t i = 0; i < 10; i++) {
+    const std::string key = tkrzw::StrCat("key-", i);
+    iter_keys[dbm.GetShardIndex(key)].emplace_back(key);
+  }
+  std::vector<int32_t> iter_positions(2, -1);
+  std::vector<tkrzw::IterateRequest::OpType> iter_ops(2, tkrzw::IterateRequest::OP_NONE);
+  std::vector<std::unique_ptr<grpc::testing::MockClientReaderWriter<
+    tkrzw::IterateRequest, tkrzw::IterateResponse>>> iter_streams;
+  for (int32_t i = 0; i < 2; i++) {
+    std::sort(iter_keys[i].begin(), iter_keys[i].end());
+    auto stream = std::make_unique<grpc::testing::MockClientReaderWriter<
+      tkrzw::IterateRequest, tkrzw::IterateResponse>>();
+    EXPECT_CALL(*stream, Write(_, _)).WillRepeatedly(Invoke(
+        [&, i](const tkrzw::IterateRequest& request, grpc::WriteOptions) {
+          iter_ops[i] = request.operation();
+          if (request.operation() == tkrzw::IterateRequest::OP_FIRST) {
+            iter_positions[i] = 0;
+          } else if (request.operation() == tkrzw::IterateRequest::OP_NEXT) {
+            iter_positions[i]++;
+          }
+          return true;
+        }));
+    EXPECT_CALL(*stream, Read(_)).WillRepeatedly(Invoke(
+        [&, i](tkrzw::IterateResponse* response) {
+          response->Clear();
+          const int32_t position = iter_positions[i];
+          const bool valid = position >= 0 && position < static_cast<int32_t>(iter_keys[i].size());
+          if (iter_ops[i] == tkrzw::IterateRequest::OP_GET) {
+            if (valid) {
+              response->set_key(iter_keys[i][position]);
+              response->set_value(tkrzw::StrCat("value-of-", iter_keys[i][position]));
+            } else {
+              response->mutable_status()->set_code(tkrzw::Status::NOT_FOUND_ERROR);
+            }
+          } else if (iter_ops[i] == tkrzw::IterateRequest::OP_NEXT && i == 0 && !valid) {
+            response->mutable_status()->set_code(tkrzw::Status::NOT_FOUND_ERROR);
+          }
+          return true;
+        }));
+    iter_streams.emplace_back(std::move(stream));
+  }
+  tkrzw::CountRequest count_request;
+  for (int32_t i = 0; i < 2; i++) {
+    tkrzw::CountResponse count_response;
+    count_response.set_count((i + 1) * 10);
+    EXPECT_CALL(*raw_stubs[i], Count(_, EqualsProto(count_request), _)).WillOnce(
+        DoAll(SetArgPointee<2>(count_response), Return(grpc::Status::OK)));
+    tkrzw::GetRequest get_request;
+    get_request.set_key(shard_keys[i]);
+    tkrzw::GetResponse get_response;
+    get_response.set_value(tkrzw::StrCat("value-", i));
+    EXPECT_CALL(*raw_stubs[i], Get(_, EqualsProto(get_request), _)).WillOnce(
+        DoAll(SetArgPointee<2>(get_response), Return(grpc::Status::OK)));
+    tkrzw::GetMultiRequest get_multi_request;
+    get_multi_request.add_keys(shard_keys[i]);
+    tkrzw::GetMultiResponse get_multi_response;
+    auto* record = get_multi_response.add_records();
+    record->set_first(shard_keys[i]);
+    record->set_second(tkrzw::StrCat("multi-", i));
+    EXPECT_CALL(*raw_stubs[i], AsyncGetMultiRaw(_, EqualsProto(get_multi_request), _))
+        .WillOnce(Invoke([&responder, get_multi_response](
+            grpc::ClientContext*, const tkrzw::GetMultiRequest&, grpc::CompletionQueue* queue) {
+          return responder.Respond(queue, get_multi_response, grpc::Status::OK);
+        }));
+    tkrzw::SetMultiRequest set_multi_request;
+    auto* set_record = set_multi_request.add_records();
+    set_record->set_first(shard_keys[i]);
+    set_record->set_second("new");
+    set_multi_request.set_overwrite(true);
+    tkrzw::SetMultiResponse set_multi_response;
+    if (i == 1) {
+      set_multi_response.mutable_status()->set_code(tkrzw::Status::DUPLICATION_ERROR);
+    }
+    EXPECT_CALL(*raw_stubs[i], AsyncSetMultiRaw(_, EqualsProto(set_multi_request), _))
+        .WillOnce(Invoke([&responder, set_multi_response](
+            grpc::ClientContext*, const tkrzw::SetMultiRequest&, grpc::CompletionQueue* queue) {
+          return responder.Respond(queue, set_multi_response, grpc::Status::OK);
+        }));
+    auto stream = std::make_unique<grpc::testing::MockClientReaderWriter<
+      tkrzw::IterateRequest, tkrzw::IterateResponse>>();
+    EXPECT_CALL(*raw_stubs[i], IterateRaw(_))
+        .WillOnce(Return(iter_streams[i].release()))
+        .WillOnce(Return(stream.release()));
+  }
+  int64_t count = 0;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Count(&count));
+  EXPECT_EQ(30, count);
+  EXPECT_EQ("value-0", dbm.GetSimple(shard_keys[0]));
+  EXPECT_EQ("value-1", dbm.GetSimple(shard_keys[1]));
+  std::map<std::string, std::string> records;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.GetMulti({shard_keys[0], shard_keys[1]}, &records));
+  EXPECT_EQ(2, records.size());
+  EXPECT_EQ("multi-0", records[shard_keys[0]]);
+  EXPECT_EQ("multi-1", records[shard_keys[1]]);
+  EXPECT_EQ(tkrzw::Status::DUPLICATION_ERROR,
+            dbm.SetMulti({{shard_keys[0], "new"}, {shard_keys[1], "new"}}));
+  {
+    auto iter = dbm.MakeIterator();
+    EXPECT_EQ(tkrzw::Status::SUCCESS, iter->First());
+    std::vector<std::string> keys;
+    std::string key, value;
+    while (iter->Get(&key, &value) == tkrzw::Status::SUCCESS) {
+      EXPECT_EQ(tkrzw::StrCat("value-of-", key), value);
+      keys.emplace_back(key);
+      EXPECT_EQ(tkrzw::Status::SUCCESS, iter->Next());
+    }
+    EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, iter->Next());
+    std::vector<std::string> expected_keys = iter_keys[0];
+    expected_keys.insert(expected_keys.end(), iter_keys[1].begin(), iter_keys[1].end());
+    std::sort(expected_keys.begin(), expected_keys.end());
+    EXPECT_EQ(expected_keys, keys);
+  }
+  EXPECT_NE(nullptr, dbm.GetShard(1));
+  EXPECT_EQ(nullptr, dbm.GetShard(2));
+  EXPECT_EQ(nullptr, dbm.GetShard(-1));
+  auto iter = dbm.MakeIterator();
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Disconnect());
+  EXPECT_EQ(0, dbm.GetNumShards());
+  EXPECT_EQ(tkrzw::Status::PRECONDITION_ERROR, iter->First());
+  EXPECT_EQ(tkrzw::Status::PRECONDITION_ERROR, dbm.Get(shard_keys[0]));
+}
+
+TEST_F(RemoteDBMTest, SlottedSharedMutex) {
+  tkrzw::SlottedSharedMutex mutex;
+  // More readers than slots are alive at once so that some of them use the overflow lock.
+  constexpr int32_t num_readers = tkrzw::SlottedSharedMutex::NUM_SLOTS + 8;
+  constexpr int32_t num_writers = 2;
+  std::atomic_int32_t num_ready(0);
+  std::atomic_int32_t num_sharing(0);
+  std::atomic_bool exclusive(false);
+  std::atomic_int32_t num_violations(0);
+  auto wait_ready = [&]() {
+    num_ready.fetch_add(1);
+    while (num_ready.load() < num_readers + num_writers) {
+      std::this_thread::yield();
+    }
+  };
+  auto read = [&]() {
+    {
+      std::shared_lock<tkrzw::SlottedSharedMutex> lock(mutex);
+    }
+    wait_ready();
+    for (int32_t i = 0; i < 200; i++) {
+      std::shared_lock<tkrzw::SlottedSharedMutex> lock(mutex);
+      std::shared_lock<tkrzw::SlottedSharedMutex> nested_lock(mutex);
+      num_sharing.fetch_add(1);
+      if (exclusive.load()) {
+        num_violations.fetch_add(1);
+      }
+      std::this_thread::yield();
+      num_sharing.fetch_sub(1);
+    }
+  };
+  auto write = [&]() {
+    wait_ready();
+    for (int32_t i = 0; i < 100; i++) {
+      std::lock_guard<tkrzw::SlottedSharedMutex> lock(mutex);
+      if (exclusive.exchange(true) || num_sharing.load() != 0) {
+        num_violations.fetch_add(1);
+      }
+      std::this_thread::yield();
+      if (num_sharing.load() != 0) {
+        num_violations.fetch_add(1);
+      }
+      exclusive.store(false);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < num_readers; i++) {
+    threads.emplace_back(read);
+  }
+  for (int32_t i = 0; i < num_writers; i++) {
+    threads.emplace_back(write);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, num_violations.load());
+  EXPECT_EQ(0, num_sharing.load());
+  std::lock_guard<tkrzw::SlottedSharedMutex> lock(mutex);
+}
+
 // END OF FILE
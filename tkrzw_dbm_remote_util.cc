@@ -17,6 +17,8 @@
 #include <cstdint>
 
 #include <iostream>
+#include <map>
+#include <set>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -58,6 +60,8 @@ static void PrintUsageAndDie() {
   P("    : Changes the master of replication.\n");
   P("  %s replicate [options] [db_configs...]\n", progname);
   P("    : Replicates updates to local databases.\n");
+  P("  %s topology [options]\n", progname);
+  P("    : Prints the tree of replication which the server belongs to.\n");
   P("\n");
   P("Common options:\n");
   P("  --version : Prints the version number and exits.\n");
@@ -102,6 +106,9 @@ static void PrintUsageAndDie() {
   P("  --items num : The number of items to print. (default: unlimited)\n");
   P("  --escape : C-style escape is applied to the TSV data.\n");
   P("\n");
+  P("Options for the topology subcommand:\n");
+  P("  --self : Prints the tree from the server itself, not from the root master.\n");
+  P("\n");
   std::exit(1);
 }
 
@@ -889,6 +896,92 @@ static int32_t ProcessReplicate(int32_t argc, const char** args) {
   return ok ? 0 : 1;
 }
 
+// Reads the server-wide inspection records of a server.
+static bool InspectServer(const std::string& address, double timeout,
+                          std::map<std::string, std::string>* records) {
+  RemoteDBM dbm;
+  if (dbm.Connect(address, timeout) != Status::SUCCESS) {
+    return false;
+  }
+  dbm.SetDBMIndex(-1);
+  std::vector<std::pair<std::string, std::string>> tmp_records;
+  const Status status = dbm.Inspect(&tmp_records);
+  dbm.Disconnect();
+  if (status != Status::SUCCESS) {
+    return false;
+  }
+  records->clear();
+  records->insert(tmp_records.begin(), tmp_records.end());
+  return true;
+}
+
+// Prints a server and its replicas recursively.
+static void PrintTopology(const std::string& address, double timeout, const std::string& indent,
+                          const std::string& attrs, std::set<std::string>* visited) {
+  std::map<std::string, std::string> records;
+  if (!InspectServer(address, timeout, &records)) {
+    PrintL(indent, address, "\tunreachable", attrs);
+    return;
+  }
+  PrintL(indent, address, "\tserver_id=", SearchMap(records, "server_id", ""),
+         "\tulog_timestamp=", SearchMap(records, "ulog_timestamp", "-"), attrs);
+  if (!visited->emplace(address).second) {
+    return;
+  }
+  for (const auto& record : records) {
+    if (!StrBeginsWith(record.first, "replica_") || !StrEndsWith(record.first, "_address") ||
+        record.second.empty()) {
+      continue;
+    }
+    const std::string prefix = record.first.substr(0, record.first.size() - 7);
+    const std::string server_id = prefix.substr(8, prefix.size() - 9);
+    const std::string child_attrs = StrCat(
+        "\tconnected=", SearchMap(records, prefix + "connected", ""),
+        "\tacked_timestamp=", SearchMap(records, prefix + "acked_timestamp", ""),
+        "\tlag=", SearchMap(records, prefix + "lag", ""));
+    if (visited->find(record.second) != visited->end()) {
+      PrintL(indent, "  ", record.second, "\tserver_id=", server_id, child_attrs, "\tloop");
+      continue;
+    }
+    PrintTopology(record.second, timeout, indent + "  ", child_attrs, visited);
+  }
+}
+
+// Processes the topology subcommand.
+static int32_t ProcessTopology(int32_t argc, const char** args) {
+  const std::map<std::string, int32_t>& cmd_configs = {
+    {"--address", 1}, {"--timeout", 1}, {"--self", 0},
+  };
+  std::map<std::string, std::vector<std::string>> cmd_args;
+  std::string cmd_error;
+  if (!ParseCommandArguments(argc, args, cmd_configs, &cmd_args, &cmd_error)) {
+    EPrint("Invalid command: ", cmd_error, "\n\n");
+    PrintUsageAndDie();
+  }
+  const std::string address = GetStringArgument(cmd_args, "--address", 0, "localhost:1978");
+  const double timeout = GetDoubleArgument(cmd_args, "--timeout", 0, -1);
+  const bool from_self = CheckMap(cmd_args, "--self");
+  std::map<std::string, std::string> records;
+  if (!InspectServer(address, timeout, &records)) {
+    EPrintL("Inspect failed: ", address);
+    return 1;
+  }
+  std::string root = address;
+  std::set<std::string> visited;
+  while (!from_self) {
+    visited.emplace(root);
+    const std::string master = SearchMap(records, "repl_master", "");
+    if (master.empty() || visited.find(master) != visited.end() ||
+        !InspectServer(master, timeout, &records)) {
+      break;
+    }
+    root = master;
+  }
+  visited.clear();
+  PrintTopology(root, timeout, "", "", &visited);
+  return 0;
+}
+
 }  // namespace tkrzw
 
 // Main routine
@@ -925,6 +1018,8 @@ int main(int argc, char** argv) {
       rv = tkrzw::ProcessChangeMaster(argc - 1, args + 1);
     } else if (std::strcmp(args[1], "replicate") == 0) {
       rv = tkrzw::ProcessReplicate(argc - 1, args + 1);
+    } else if (std::strcmp(args[1], "topology") == 0) {
+      rv = tkrzw::ProcessTopology(argc - 1, args + 1);
     } else {
       tkrzw::PrintUsageAndDie();
     }
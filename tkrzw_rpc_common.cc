@@ -21,6 +21,9 @@
 #include <sys/wait.h>
 #include <fcntl.h>
 
+#include <mutex>
+#include <set>
+
 #include <grpc/impl/codegen/log.h>
 #include <grpc/impl/codegen/port_platform.h>
 
@@ -101,6 +104,52 @@ Status DaemonizeProcess() {
   return Status(Status::SUCCESS);
 }
 
+// Registry of the slot indices which are not owned by live threads.
+struct SlotIndexRegistry final {
+  std::mutex mutex;
+  std::set<int32_t> free_indices;
+  int32_t next_index = 0;
+};
+
+static SlotIndexRegistry& GetSlotIndexRegistry() {
+  static SlotIndexRegistry registry;
+  return registry;
+}
+
+// Owner of a slot index, which returns the index to the registry when the thread exits.
+class SlotIndexOwner final {
+ public:
+  SlotIndexOwner() : index_(0) {
+    SlotIndexRegistry& registry = GetSlotIndexRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    // The smallest index is reused so that live threads fit in the slots as far as possible.
+    if (registry.free_indices.empty()) {
+      index_ = registry.next_index++;
+    } else {
+      index_ = *registry.free_indices.begin();
+      registry.free_indices.erase(registry.free_indices.begin());
+    }
+  }
+
+  ~SlotIndexOwner() {
+    SlotIndexRegistry& registry = GetSlotIndexRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.free_indices.emplace(index_);
+  }
+
+  int32_t Get() const {
+    return index_;
+  }
+
+ private:
+  int32_t index_;
+};
+
+int32_t SlottedSharedMutex::GetSlotIndex() {
+  thread_local SlotIndexOwner owner;
+  return owner.Get();
+}
+
 }  // namespace tkrzw
 
 // END OF FILE
@@ -14,7 +14,13 @@
 #ifndef _TKRZW_RPC_COMMON_H
 #define _TKRZW_RPC_COMMON_H
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 #include "tkrzw_cmd_util.h"
+#include "tkrzw_thread_util.h"
 
 namespace tkrzw {
 
@@ -36,6 +42,131 @@ void SetGlobalLogger(tkrzw::Logger* logger);
  */
 Status DaemonizeProcess();
 
+/**
+ * Reader-writer lock whose shared lock writes only a slot owned by the calling thread.
+ * @details Each live thread owns a distinct slot on its own cache line, so concurrent readers
+ * neither share a lock word nor do read-modify-write operations.  A writer raises the flag
+ * and waits until every slot is released, yielding at first and then sleeping for longer and
+ * longer.  Threads beyond the number of slots share a spin lock instead.  The shared lock can
+ * be taken recursively by the same thread.
+ */
+class SlottedSharedMutex final {
+ public:
+  /** The number of slots. */
+  static constexpr int32_t NUM_SLOTS = 128;
+  /** The number of times a waiting writer yields before it starts sleeping. */
+  static constexpr int32_t MAX_WRITER_YIELDS = 16;
+  /** The maximum time in microseconds a waiting writer sleeps at once. */
+  static constexpr int32_t MAX_WRITER_SLEEP_USEC = 1024;
+
+  /**
+   * Default constructor.
+   */
+  SlottedSharedMutex() : slots_(), writing_(false), writer_mutex_(), overflow_mutex_() {}
+
+  /**
+   * Copy and assignment are disabled.
+   */
+  explicit SlottedSharedMutex(const SlottedSharedMutex& rhs) = delete;
+  SlottedSharedMutex& operator =(const SlottedSharedMutex& rhs) = delete;
+
+  /**
+   * Gets exclusive ownership of the lock.
+   */
+  void lock() {
+    writer_mutex_.lock();
+    writing_.store(true);
+    int32_t num_waits = 0;
+    for (auto& slot : slots_) {
+      while (slot.count.load() > 0) {
+        if (num_waits < MAX_WRITER_YIELDS) {
+          std::this_thread::yield();
+          num_waits++;
+        } else {
+          const int32_t sleep_usec = 1 << (num_waits - MAX_WRITER_YIELDS);
+          std::this_thread::sleep_for(std::chrono::microseconds(sleep_usec));
+          if (sleep_usec < MAX_WRITER_SLEEP_USEC) {
+            num_waits++;
+          }
+        }
+      }
+    }
+    overflow_mutex_.lock();
+  }
+
+  /**
+   * Releases exclusive ownership of the lock.
+   */
+  void unlock() {
+    overflow_mutex_.unlock();
+    writing_.store(false);
+    writer_mutex_.unlock();
+  }
+
+  /**
+   * Gets shared ownership of the lock.
+   */
+  void lock_shared() {
+    const int32_t index = GetSlotIndex();
+    if (index >= NUM_SLOTS) {
+      overflow_mutex_.lock_shared();
+      return;
+    }
+    std::atomic_int32_t& count = slots_[index].count;
+    const int32_t num_held = count.load(std::memory_order_relaxed);
+    if (num_held > 0) {
+      count.store(num_held + 1, std::memory_order_relaxed);
+      return;
+    }
+    while (true) {
+      // The sequentially consistent store and load pair with those of the writer.
+      count.store(1);
+      if (!writing_.load()) {
+        return;
+      }
+      count.store(0);
+      while (writing_.load()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /**
+   * Releases shared ownership of the lock.
+   */
+  void unlock_shared() {
+    const int32_t index = GetSlotIndex();
+    if (index >= NUM_SLOTS) {
+      overflow_mutex_.unlock_shared();
+      return;
+    }
+    std::atomic_int32_t& count = slots_[index].count;
+    count.store(count.load(std::memory_order_relaxed) - 1, std::memory_order_release);
+  }
+
+ private:
+  /** The slot of a thread. */
+  struct alignas(64) Slot {
+    /** The number of shared locks held by the thread. */
+    std::atomic_int32_t count{0};
+  };
+
+  /**
+   * Gets the index of the slot owned by the calling thread.
+   * @return The index which is unique among live threads.
+   */
+  static int32_t GetSlotIndex();
+
+  /** The slots of the threads. */
+  Slot slots_[NUM_SLOTS];
+  /** Whether a writer holds or waits for the lock. */
+  std::atomic_bool writing_;
+  /** The mutex to serialize writers. */
+  std::mutex writer_mutex_;
+  /** The lock of threads without their own slots. */
+  SpinSharedMutex overflow_mutex_;
+};
+
 }  // namespace tkrzw
 
 #endif  // _TKRZW_RPC_COMMON_H
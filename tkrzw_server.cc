@@ -42,6 +42,10 @@ static void PrintUsageAndDie() {
   P("  --version : Prints the version number and exits.\n");
   P("  --address str : The address/hostname and the port of the server"
     " (default: 0.0.0.0:1978)\n");
+  P("    : \"unix:/path/to/file\" for a UNIX domain socket."
+    " Multiple addresses can be separated by commas.\n");
+  P("  --advertise_address str : The address told to the master for further replicas."
+    " (default: the first address)\n");
   P("  --async : Uses the asynchronous API on ths server.\n");
   P("  --threads num : The maximum number of worker threads. (default: 1)\n");
   P("  --log_file str : The file path of the log file. (default: /dev/stdout)\n");
@@ -54,15 +58,40 @@ static void PrintUsageAndDie() {
   P("  --ulog_prefix str : The prefix of the update log files.\n");
   P("  --ulog_max_file_size num : The maximum file size of each update log file."
     " (default: 1Gi)\n");
+  P("  --ulog_retention_time num : The minimum time in seconds to retain each update log file."
+    " Negative disables removal of old files. (default: -1)\n");
+  P("  --ulog_retention_size num : The minimum total size of the retained update log files."
+    " (default: 0)\n");
+  P("  --ulog_replica_grace num : The time in seconds after which disconnected replicas stop"
+    " holding old update log files.  Negative means forever. (default: -1)\n");
   P("  --repl_ts_file str : The replication timestamp file.\n");
   P("  --repl_ts_from_dbm : Uses the database timestamp if the timestamp file doesn't exist.\n");
   P("  --repl_ts_skew num : Skews the timestamp by a value.\n");
   P("  --repl_wait num : The time in seconds to wait for the next log. (default: 1)\n");
+  P("  --semisync_replicas num : The number of replicas which must acknowledge each update"
+    " before the response.  Not available with --async. (default: 0)\n");
+  P("  --semisync_timeout num : The time in seconds to wait for the acknowledgements."
+    " (default: 1)\n");
+  P("  --fence_timeout num : The time in seconds for a retrieval with the minimum timestamp"
+    " to wait for replication. (default: 1)\n");
+  P("  --repl_compaction_horizon num : Sends updates older than the time in seconds to"
+    " catching-up replicas as compacted. (default: 0=disabled)\n");
+  P("  --repl_compaction_chunk num : The maximum size of update logs compacted at once."
+    " (default: 64Mi)\n");
   P("  --pid_file str : The file path of the store the process ID.\n");
   P("  --daemon : Runs the process as a daemon process.\n");
   P("  --shutdown_wait num : Time in seconds to wait for the service shutdown gracefully."
     " (default: 5.0)\n");
   P("  --read_only : Opens the databases in the read-only mode.\n");
+  P("  --max_message_size num : The maximum size of sent and received messages."
+    " Negative means unlimited. (default: 4Mi for receiving)\n");
+  P("  --keepalive_time num : The interval in seconds of keepalive pings. (default: 0=disabled)\n");
+  P("  --keepalive_timeout num : The time in seconds to wait for the acknowledgement of a"
+    " keepalive ping. (default: 20)\n");
+  P("  --keepalive_min_interval num : The minimum interval in seconds of client pings to be"
+    " accepted, even without calls. (default: 0=gRPC's default)\n");
+  P("  --compression str : The default compression algorithm: none, deflate, gzip."
+    " (default: none)\n");
   P("\n");
   P("A database config is in \"path#params\" format.\n");
   P("e.g.: \"casket.tkh#num_buckets=1000000,align_pow=4\"\n");
@@ -135,13 +164,19 @@ void ShutdownServer(int signum) {
 // Processes the command.
 static int32_t Process(int32_t argc, const char** args) {
   const std::map<std::string, int32_t>& cmd_configs = {
-    {"--version", 0}, {"--address", 1}, {"--async", 0}, {"--threads", 1},
+    {"--version", 0}, {"--address", 1}, {"--advertise_address", 1},
+    {"--async", 0}, {"--threads", 1},
     {"--log_file", 1}, {"--log_level", 1}, {"--log_date", 1}, {"--log_td", 1},
     {"--server_id", 1}, {"--ulog_prefix", 1}, {"--ulog_max_file_size", 1},
+    {"--ulog_retention_time", 1}, {"--ulog_retention_size", 1}, {"--ulog_replica_grace", 1},
     {"--repl_master", 1}, {"--repl_ts_file", 1}, {"--repl_ts_from_dbm", 1},
     {"--repl_ts_skew", 1}, {"--repl_wait", 1},
+    {"--semisync_replicas", 1}, {"--semisync_timeout", 1}, {"--fence_timeout", 1},
+    {"--repl_compaction_horizon", 1}, {"--repl_compaction_chunk", 1},
     {"--pid_file", 1}, {"--daemon", 0}, {"--shutdown_wait", 1},
     {"--read_only", 0},
+    {"--max_message_size", 1}, {"--keepalive_time", 1}, {"--keepalive_timeout", 1},
+    {"--keepalive_min_interval", 1}, {"--compression", 1},
   };
   std::map<std::string, std::vector<std::string>> cmd_args;
   std::string cmd_error;
@@ -153,7 +188,10 @@ static int32_t Process(int32_t argc, const char** args) {
     PrintL("Tkrzw-RPC server ", RPC_PACKAGE_VERSION);
     return 0;
   }
-  const std::string address = GetStringArgument(cmd_args, "--address", 0, "0.0.0.0:1978");
+  const std::string address_expr =
+      GetStringArgument(cmd_args, "--address", 0, "0.0.0.0:1978");
+  const std::string advertise_address =
+      GetStringArgument(cmd_args, "--advertise_address", 0, "");
   const bool with_async = CheckMap(cmd_args, "--async");
   const int32_t num_threads = GetIntegerArgument(cmd_args, "--threads", 0, 1);
   const std::string log_file = GetStringArgument(cmd_args, "--log_file", 0, "/dev/stdout");
@@ -164,25 +202,75 @@ static int32_t Process(int32_t argc, const char** args) {
   const std::string ulog_prefix = GetStringArgument(cmd_args, "--ulog_prefix", 0, "");
   const int64_t ulog_max_file_size =
       GetIntegerArgument(cmd_args, "--ulog_max_file_size", 0, 1LL << 30);
+  const double ulog_retention_time =
+      GetDoubleArgument(cmd_args, "--ulog_retention_time", 0, -1);
+  const int64_t ulog_retention_size =
+      GetIntegerArgument(cmd_args, "--ulog_retention_size", 0, 0);
+  const double ulog_replica_grace =
+      GetDoubleArgument(cmd_args, "--ulog_replica_grace", 0, -1);
   const std::string repl_master = GetStringArgument(cmd_args, "--repl_master", 0, "");
   const std::string repl_ts_file = GetStringArgument(cmd_args, "--repl_ts_file", 0, "");
   const bool repl_ts_from_dbm = CheckMap(cmd_args, "--repl_ts_from_dbm");
   const int64_t repl_ts_skew = GetIntegerArgument(cmd_args, "--repl_ts_set", 0, 0);
   const double repl_wait_time = GetDoubleArgument(cmd_args, "--repl_wait_time", 0, 1.0);
+  const int32_t semisync_replicas = GetIntegerArgument(cmd_args, "--semisync_replicas", 0, 0);
+  const double semisync_timeout = GetDoubleArgument(cmd_args, "--semisync_timeout", 0, 1.0);
+  const double fence_timeout = GetDoubleArgument(cmd_args, "--fence_timeout", 0, 1.0);
+  const double repl_compaction_horizon =
+      GetDoubleArgument(cmd_args, "--repl_compaction_horizon", 0, 0);
+  const int64_t repl_compaction_chunk =
+      GetIntegerArgument(cmd_args, "--repl_compaction_chunk", 0, 64LL << 20);
   const std::string pid_file = GetStringArgument(cmd_args, "--pid_file", 0, "");
   const bool as_daemon = CheckMap(cmd_args, "--daemon");
   g_shutdown_wait = GetDoubleArgument(cmd_args, "--shutdown_wait", 0, 5.0);
   const bool read_only = CheckMap(cmd_args, "--read_only");
+  const int64_t max_message_size = GetIntegerArgument(cmd_args, "--max_message_size", 0, 0);
+  const double keepalive_time = GetDoubleArgument(cmd_args, "--keepalive_time", 0, 0);
+  const double keepalive_timeout = GetDoubleArgument(cmd_args, "--keepalive_timeout", 0, 20);
+  const double keepalive_min_interval =
+      GetDoubleArgument(cmd_args, "--keepalive_min_interval", 0, 0);
+  const std::string compression = GetStringArgument(cmd_args, "--compression", 0, "");
   auto dbm_exprs = SearchMap(cmd_args, "", {});
-  if (address.find(":") == std::string::npos) {
+  const std::vector<std::string> addresses = StrSplit(address_expr, ",", true);
+  if (addresses.empty()) {
     Die("Invalid address");
   }
+  for (const auto& address : addresses) {
+    if (address.find(":") == std::string::npos) {
+      Die("Invalid address: ", address);
+    }
+  }
+  // The address is told to the master so that the topology view can reach this server.
+  const std::string& address =
+      advertise_address.empty() ? addresses.front() : advertise_address;
+  if (address.find(":") == std::string::npos) {
+    Die("Invalid advertise address: ", address);
+  }
   if (num_threads < 1) {
     Die("Invalid number of threads");
   }
   if (server_id < 1) {
     Die("Invalid server ID");
   }
+  if (max_message_size > INT32MAX) {
+    Die("Invalid maximum message size");
+  }
+  grpc_compression_algorithm compression_algorithm = GRPC_COMPRESS_NONE;
+  if (compression == "deflate") {
+    compression_algorithm = GRPC_COMPRESS_DEFLATE;
+  } else if (compression == "gzip") {
+    compression_algorithm = GRPC_COMPRESS_GZIP;
+  } else if (!compression.empty() && compression != "none") {
+    Die("Invalid compression algorithm");
+  }
+  if (semisync_replicas > 0 && ulog_prefix.empty()) {
+    Die("Semi-synchronous replication requires the update logs");
+  }
+  // The asynchronous server runs all calls on a fixed number of threads.  Writers waiting for
+  // acknowledgements would occupy them and block the acknowledgements themselves.
+  if (semisync_replicas > 0 && with_async) {
+    Die("Semi-synchronous replication is not supported by the asynchronous API");
+  }
   if (dbm_exprs.empty()) {
     dbm_exprs.emplace_back("#dbm=tiny");
   }
@@ -281,12 +369,39 @@ static int32_t Process(int32_t argc, const char** args) {
   }
   repl_min_timestamp = std::max<int64_t>(0, repl_min_timestamp + repl_ts_skew);
   ReplicationParameters repl_params(
-      repl_master, repl_min_timestamp, repl_wait_time, repl_ts_file);
+      repl_master, repl_min_timestamp, repl_wait_time, repl_ts_file,
+      semisync_replicas, semisync_timeout, fence_timeout,
+      ulog_prefix, ulog_retention_time, ulog_retention_size, repl_compaction_horizon,
+      ulog_prefix.empty() ? "" : address, ulog_replica_grace, repl_compaction_chunk);
   logger.LogCat(Logger::LEVEL_INFO,
                 "Building the ", (with_async > 0 ? "async" : "sync"),
-                " server: address=", address, ", id=", server_id);
+                " server: address=", address_expr, ", id=", server_id);
   grpc::ServerBuilder builder;
-  builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+  for (const auto& listen_address : addresses) {
+    builder.AddListeningPort(listen_address, grpc::InsecureServerCredentials());
+  }
+  if (max_message_size != 0) {
+    const int32_t size = std::max<int64_t>(max_message_size, -1);
+    builder.SetMaxReceiveMessageSize(size);
+    builder.SetMaxSendMessageSize(size);
+  }
+  if (keepalive_time > 0) {
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIME_MS,
+                               static_cast<int>(keepalive_time * 1000));
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIMEOUT_MS,
+                               static_cast<int>(keepalive_timeout * 1000));
+  }
+  if (keepalive_min_interval > 0) {
+    // Clients sending pings more frequently than this are disconnected by the server.
+    builder.AddChannelArgument(GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS,
+                               static_cast<int>(keepalive_min_interval * 1000));
+  }
+  if (keepalive_time > 0 || keepalive_min_interval > 0) {
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+  }
+  if (compression_algorithm != GRPC_COMPRESS_NONE) {
+    builder.SetDefaultCompressionAlgorithm(compression_algorithm);
+  }
   std::unique_ptr<grpc::Service> service;
   std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> async_queues;
   if (with_async) {
@@ -306,7 +421,7 @@ static int32_t Process(int32_t argc, const char** args) {
   }
   std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
   if (server == nullptr) {
-    logger.LogCat(Logger::LEVEL_FATAL, "ServerBuilder::BuildAndStart failed: ", address);
+    logger.LogCat(Logger::LEVEL_FATAL, "ServerBuilder::BuildAndStart failed: ", address_expr);
     has_error = true;
   } else {
     g_server.store(server.get());
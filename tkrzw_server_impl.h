@@ -18,11 +18,17 @@
 #include <cstdarg>
 #include <cstdint>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include <google/protobuf/message.h>
@@ -34,6 +40,7 @@
 
 #include "tkrzw_cmd_util.h"
 #include "tkrzw_dbm_remote.h"
+#include "tkrzw_file_util.h"
 #include "tkrzw_rpc_common.h"
 #include "tkrzw_rpc.grpc.pb.h"
 #include "tkrzw_rpc.pb.h"
@@ -41,17 +48,379 @@
 namespace tkrzw {
 
 static constexpr int64_t TIMESTAMP_FILE_SYNC_FREQ = 1000;
+static constexpr double ULOG_RETENTION_CHECK_INTERVAL = 10.0;
+static constexpr double ACK_RETRY_MIN_BACKOFF = 0.1;
+static constexpr double ACK_RETRY_MAX_BACKOFF = 5.0;
+static constexpr double SEMISYNC_POLL_INTERVAL = 0.05;
+static constexpr size_t MAX_REPLICA_CHECKPOINTS = 1 << 16;
+static constexpr size_t MAX_ORIGIN_MARKS = 1 << 16;
 
 struct ReplicationParameters {
   std::string master;
   int64_t min_timestamp;
   double wait_time;
   std::string ts_file;
+  int32_t semisync_replicas;
+  double semisync_timeout;
+  double fence_timeout;
+  std::string ulog_prefix;
+  double ulog_retention_time;
+  int64_t ulog_retention_size;
+  double compaction_horizon;
+  std::string address;
+  double ulog_replica_grace;
+  int64_t compaction_chunk_size;
   ReplicationParameters(
       const std::string& master = "", int64_t min_timestamp = 0,
-      double wait_time = 0, const std::string& ts_file = "")
+      double wait_time = 0, const std::string& ts_file = "",
+      int32_t semisync_replicas = 0, double semisync_timeout = 1.0,
+      double fence_timeout = 1.0, const std::string& ulog_prefix = "",
+      double ulog_retention_time = -1, int64_t ulog_retention_size = 0,
+      double compaction_horizon = 0, const std::string& address = "",
+      double ulog_replica_grace = -1, int64_t compaction_chunk_size = 64LL << 20)
       : master(master), min_timestamp(min_timestamp),
-        wait_time(wait_time), ts_file(ts_file) {}
+        wait_time(wait_time), ts_file(ts_file),
+        semisync_replicas(semisync_replicas), semisync_timeout(semisync_timeout),
+        fence_timeout(fence_timeout), ulog_prefix(ulog_prefix),
+        ulog_retention_time(ulog_retention_time),
+        ulog_retention_size(ulog_retention_size),
+        compaction_horizon(compaction_horizon), address(address),
+        ulog_replica_grace(ulog_replica_grace), compaction_chunk_size(compaction_chunk_size) {}
+};
+
+class ThroughputMeter {
+ public:
+  explicit ThroughputMeter(double window = 1.0)
+      : window_(window), start_time_(0), count_(0), rate_(0) {}
+
+  void Add(int64_t count, double now) {
+    if (start_time_ <= 0) {
+      start_time_ = now;
+    }
+    count_ += count;
+    const double elapsed = now - start_time_;
+    if (elapsed >= window_) {
+      rate_ = count_ / elapsed;
+      start_time_ = now;
+      count_ = 0;
+    }
+  }
+
+  double GetRate(double now) const {
+    if (start_time_ <= 0) {
+      return 0;
+    }
+    const double elapsed = now - start_time_;
+    return elapsed >= window_ ? count_ / elapsed : rate_;
+  }
+
+ private:
+  double window_;
+  double start_time_;
+  int64_t count_;
+  double rate_;
+};
+
+struct ReplicaState {
+  int32_t num_sessions;
+  int64_t sent_timestamp;
+  int64_t acked_timestamp;
+  int64_t num_sent;
+  ThroughputMeter send_meter;
+  std::string address;
+  int64_t session_id;
+  int64_t sent_sequence;
+  int64_t acked_sequence;
+  int64_t acked_position;
+  // The wall time when the last session finished.
+  double disconnected_time;
+  // Pairs of the sequence number of each message sent in the session and the position in the
+  // update log which is covered once the replica acknowledges the message.
+  std::deque<std::pair<int64_t, int64_t>> checkpoints;
+  ReplicaState()
+      : num_sessions(0), sent_timestamp(-1), acked_timestamp(-1), num_sent(0),
+        send_meter(), address(), session_id(0), sent_sequence(0), acked_sequence(0),
+        acked_position(0), disconnected_time(0), checkpoints() {}
+};
+
+struct ReplicateSession {
+  std::unique_ptr<MessageQueue::Reader> reader;
+  std::deque<ReplicateResponse> pending;
+  int64_t id = 0;
+  int64_t num_sent = 0;
+  // The timestamp up to which updates are compacted, or -1 if the compaction is done.
+  int64_t compaction_timestamp = -1;
+  // The number of update logs written by this process which the reader has read, or -1 if
+  // it is unknown yet.
+  int64_t position = -1;
+};
+
+class SequencedUpdateLogger : public DBM::UpdateLogger {
+ public:
+  SequencedUpdateLogger(MessageQueue* mq, int32_t server_id, int32_t dbm_index,
+                        std::mutex* mutex, std::atomic_int64_t* position)
+      : ulog_(mq, server_id, dbm_index), mutex_(mutex), position_(position) {}
+
+  Status WriteSet(std::string_view key, std::string_view value) override {
+    std::lock_guard<std::mutex> lock(*mutex_);
+    return Count(ulog_.WriteSet(key, value));
+  }
+
+  Status WriteRemove(std::string_view key) override {
+    std::lock_guard<std::mutex> lock(*mutex_);
+    return Count(ulog_.WriteRemove(key));
+  }
+
+  Status WriteClear() override {
+    std::lock_guard<std::mutex> lock(*mutex_);
+    return Count(ulog_.WriteClear());
+  }
+
+  Status Synchronize(bool hard) override {
+    return ulog_.Synchronize(hard);
+  }
+
+  static int64_t GetThreadPosition() {
+    return thread_position_;
+  }
+
+ private:
+  Status Count(const Status& status) {
+    if (status == Status::SUCCESS) {
+      thread_position_ = position_->fetch_add(1) + 1;
+    }
+    return status;
+  }
+
+  DBMUpdateLoggerMQ ulog_;
+  std::mutex* mutex_;
+  std::atomic_int64_t* position_;
+  inline static thread_local int64_t thread_position_ = 0;
+};
+
+class ReplicationAcker {
+ public:
+  ReplicationAcker(RemoteDBM::Replicator* repl, Logger* logger)
+      : repl_(repl), logger_(logger), alive_(true), applied_timestamp_(-1),
+        applied_session_id_(0), applied_sequence_(0), mutex_(), cond_(), thread_() {
+    thread_ = std::thread([&]{ SendAcks(); });
+  }
+
+  ~ReplicationAcker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      alive_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+  }
+
+  void Notify(int64_t timestamp) {
+    int64_t session_id = 0;
+    int64_t sequence = 0;
+    repl_->GetPosition(&session_id, &sequence);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      applied_timestamp_ = std::max(applied_timestamp_, timestamp);
+      applied_session_id_ = session_id;
+      applied_sequence_ = sequence;
+    }
+    cond_.notify_one();
+  }
+
+  void SendAcks() {
+    int64_t acked_timestamp = -1;
+    int64_t acked_session_id = 0;
+    int64_t acked_sequence = 0;
+    double backoff = 0;
+    while (true) {
+      int64_t timestamp = 0;
+      int64_t session_id = 0;
+      int64_t sequence = 0;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const auto is_pending = [&]() {
+          return applied_timestamp_ > acked_timestamp || applied_session_id_ != acked_session_id ||
+              applied_sequence_ > acked_sequence;
+        };
+        if (backoff > 0) {
+          cond_.wait_for(lock, std::chrono::microseconds(static_cast<int64_t>(backoff * 1000000)),
+                         [&]() { return !alive_; });
+        }
+        cond_.wait(lock, [&]() { return !alive_ || is_pending(); });
+        if (!alive_) {
+          break;
+        }
+        timestamp = applied_timestamp_;
+        session_id = applied_session_id_;
+        sequence = applied_sequence_;
+      }
+      // A failed ack is retried with the latest position after a backoff.  The ack thread
+      // keeps running until the replication session ends.
+      const Status status = repl_->Ack(timestamp, session_id, sequence);
+      if (status != Status::SUCCESS) {
+        logger_->LogCat(Logger::LEVEL_WARN, "replication ack error: ", status);
+        backoff = std::min(std::max(backoff * 2, ACK_RETRY_MIN_BACKOFF), ACK_RETRY_MAX_BACKOFF);
+        continue;
+      }
+      backoff = 0;
+      acked_timestamp = timestamp;
+      acked_session_id = session_id;
+      acked_sequence = sequence;
+    }
+  }
+
+ private:
+  RemoteDBM::Replicator* repl_;
+  Logger* logger_;
+  bool alive_;
+  int64_t applied_timestamp_;
+  int64_t applied_session_id_;
+  int64_t applied_sequence_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::thread thread_;
+};
+
+struct BatchRecordState {
+  bool loaded = false;
+  bool existence = false;
+  bool modified = false;
+  std::string value;
+};
+
+class BatchChecker : public DBM::RecordProcessor {
+ public:
+  BatchChecker(const BatchOperation& op, BatchRecordState* state, BatchResult* result,
+               bool atomic, bool* aborted)
+      : op_(op), state_(state), result_(result), atomic_(atomic), aborted_(aborted) {}
+
+  std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+    if (!state_->loaded) {
+      state_->loaded = true;
+      state_->existence = true;
+      state_->value = value;
+    }
+    Check();
+    return NOOP;
+  }
+
+  std::string_view ProcessEmpty(std::string_view key) override {
+    state_->loaded = true;
+    Check();
+    return NOOP;
+  }
+
+ private:
+  void Check() {
+    Status status(Status::SUCCESS);
+    switch (op_.operation()) {
+      case BatchOperation::OP_GET: {
+        if (state_->existence) {
+          result_->set_value(state_->value);
+        } else {
+          status = Status(Status::NOT_FOUND_ERROR);
+        }
+        break;
+      }
+      case BatchOperation::OP_SET: {
+        if (state_->existence && !op_.overwrite()) {
+          status = Status(Status::DUPLICATION_ERROR);
+        } else {
+          Update(true, op_.value());
+        }
+        break;
+      }
+      case BatchOperation::OP_REMOVE: {
+        if (state_->existence) {
+          Update(false, "");
+        } else {
+          status = Status(Status::NOT_FOUND_ERROR);
+        }
+        break;
+      }
+      case BatchOperation::OP_APPEND: {
+        if (state_->existence) {
+          Update(true, StrCat(state_->value, op_.delim(), op_.value()));
+        } else {
+          Update(true, op_.value());
+        }
+        break;
+      }
+      case BatchOperation::OP_COMPARE_EXCHANGE: {
+        const bool matched = op_.expected_existence() ?
+            state_->existence && state_->value == op_.expected_value() : !state_->existence;
+        if (!matched) {
+          status = Status(Status::INFEASIBLE_ERROR);
+        } else if (op_.desired_existence() || state_->existence) {
+          Update(op_.desired_existence(), op_.desired_existence() ? op_.value() : "");
+        }
+        break;
+      }
+      case BatchOperation::OP_INCREMENT: {
+        int64_t current = state_->existence ?
+            StrToIntBigEndian(state_->value) : op_.initial();
+        if (op_.increment() != INT64MIN) {
+          current += op_.increment();
+          Update(true, IntToStrBigEndian(current));
+        }
+        result_->set_current(current);
+        break;
+      }
+      default: {
+        status = Status(Status::INVALID_ARGUMENT_ERROR, "unknown operation");
+        break;
+      }
+    }
+    result_->mutable_status()->set_code(status.GetCode());
+    result_->mutable_status()->set_message(status.GetMessage());
+    if (atomic_ && status != Status::SUCCESS && op_.operation() != BatchOperation::OP_GET) {
+      *aborted_ = true;
+    }
+  }
+
+  void Update(bool existence, std::string_view value) {
+    state_->existence = existence;
+    state_->value = value;
+    state_->modified = true;
+  }
+
+  const BatchOperation& op_;
+  BatchRecordState* state_;
+  BatchResult* result_;
+  bool atomic_;
+  bool* aborted_;
+};
+
+class BatchApplier : public DBM::RecordProcessor {
+ public:
+  BatchApplier(const BatchRecordState* state, const bool* aborted)
+      : state_(state), aborted_(aborted), applied_(false) {}
+
+  std::string_view ProcessFull(std::string_view key, std::string_view value) override {
+    return Apply();
+  }
+
+  std::string_view ProcessEmpty(std::string_view key) override {
+    return Apply();
+  }
+
+  bool IsApplied() const {
+    return applied_;
+  }
+
+ private:
+  std::string_view Apply() {
+    if (*aborted_ || !state_->modified) {
+      return NOOP;
+    }
+    applied_ = true;
+    return state_->existence ? std::string_view(state_->value) : REMOVE;
+  }
+
+  const BatchRecordState* state_;
+  const bool* aborted_;
+  bool applied_;
 };
 
 class DBMServiceBase {
@@ -62,21 +431,53 @@ class DBMServiceBase {
       const ReplicationParameters& repl_params = {})
       : dbms_(dbms), logger_(logger), server_id_(server_id), mq_(mq),
         repl_params_(repl_params), repl_ts_skew_(0),
-        alive_(true), thread_repl_manager_(), refresh_repl_manager_(true), mutex_() {
+        alive_(true), thread_repl_manager_(), thread_ulog_manager_(),
+        refresh_repl_manager_(true), mutex_(),
+        replicas_(), ack_mutex_(), ack_cond_(), ulogs_(), ulog_mutex_(), ulog_position_(0),
+        replicate_session_count_(0),
+        repl_connected_(false), repl_cascaded_(false), origin_marks_(), origin_mutex_(),
+        repl_applied_timestamp_(-1), repl_lag_(0),
+        repl_num_applied_(0), repl_apply_rate_(0),
+        applied_mutex_(), applied_cond_(),
+        semisync_num_waits_(0), semisync_num_timeouts_(0),
+        semisync_total_wait_usec_(0), semisync_max_wait_usec_(0),
+        ulog_num_files_(0), ulog_retained_bytes_(0), ulog_oldest_timestamp_(0),
+        compaction_num_sessions_(0), compaction_num_read_(0), compaction_num_sent_(0) {
+    // With semi-sync replication, updates are logged in order of their positions so that
+    // each writer can wait for the acknowledgement of its own update log.
+    if (mq_ != nullptr && repl_params_.semisync_replicas > 0) {
+      for (int32_t i = 0; i < static_cast<int32_t>(dbms_.size()); i++) {
+        ulogs_.emplace_back(std::make_unique<SequencedUpdateLogger>(
+            mq_, server_id_, i, &ulog_mutex_, &ulog_position_));
+        dbms_[i]->SetUpdateLogger(ulogs_.back().get());
+      }
+    }
     StartManager();
   }
 
   ~DBMServiceBase() {
     StopManager();
+    if (!ulogs_.empty()) {
+      for (auto& dbm : dbms_) {
+        dbm->SetUpdateLogger(nullptr);
+      }
+    }
   }
 
   void StartManager() {
     thread_repl_manager_ = std::thread([&]{ ManageReplication(); });
+    if (mq_ != nullptr && !repl_params_.ulog_prefix.empty() &&
+        repl_params_.ulog_retention_time >= 0) {
+      thread_ulog_manager_ = std::thread([&]{ ManageUpdateLogs(); });
+    }
   }
 
   void StopManager() {
     alive_.store(false);
     thread_repl_manager_.join();
+    if (thread_ulog_manager_.joinable()) {
+      thread_ulog_manager_.join();
+    }
   }
 
   void ManageReplication() {
@@ -103,11 +504,115 @@ class DBMServiceBase {
         }
       }
       success = DoReplicationSession(&params, success);
+      repl_connected_.store(false);
       max_timestamp = std::max(max_timestamp, params.min_timestamp);
     }
     logger_->Log(Logger::LEVEL_DEBUG, "The replicatin manager finished");
   }
 
+  void ManageUpdateLogs() {
+    logger_->Log(Logger::LEVEL_DEBUG, "Starting the update log manager");
+    double last_check_time = 0;
+    while (alive_.load()) {
+      SleepThread(1.0);
+      const double now = GetWallTime();
+      if (now - last_check_time < ULOG_RETENTION_CHECK_INTERVAL) {
+        continue;
+      }
+      last_check_time = now;
+      RemoveOldUpdateLogs(now);
+    }
+    logger_->Log(Logger::LEVEL_DEBUG, "The update log manager finished");
+  }
+
+  void RemoveOldUpdateLogs(double now) {
+    std::vector<std::string> paths;
+    Status status = MessageQueue::FindFiles(repl_params_.ulog_prefix, &paths);
+    if (status != Status::SUCCESS) {
+      logger_->LogCat(Logger::LEVEL_ERROR, "unable to find the update log files: ", status);
+      return;
+    }
+    struct UpdateLogFile {
+      int64_t file_id;
+      int64_t timestamp;
+      int64_t file_size;
+      bool operator <(const UpdateLogFile& rhs) const {
+        return file_id < rhs.file_id;
+      }
+    };
+    std::vector<UpdateLogFile> files;
+    int64_t total_size = 0;
+    for (const auto& path : paths) {
+      UpdateLogFile file;
+      // The timestamp in the metadata is of the last message in the file.
+      if (MessageQueue::ReadFileMetadata(
+              path, &file.file_id, &file.timestamp, &file.file_size) == Status::SUCCESS) {
+        files.emplace_back(file);
+        total_size += file.file_size;
+      }
+    }
+    std::sort(files.begin(), files.end());
+    int64_t min_acked_timestamp = INT64MAX;
+    bool has_replica = false;
+    {
+      std::lock_guard<std::mutex> lock(ack_mutex_);
+      for (const auto& replica : replicas_) {
+        // Negative server IDs are of observers like client caches, which don't need old logs.
+        if (replica.first < 0) {
+          continue;
+        }
+        has_replica = true;
+        // Replicas which have been disconnected longer than the grace period don't hold logs.
+        const auto& state = replica.second;
+        if (state.num_sessions < 1 && repl_params_.ulog_replica_grace >= 0 &&
+            now - state.disconnected_time > repl_params_.ulog_replica_grace) {
+          continue;
+        }
+        min_acked_timestamp = std::min(min_acked_timestamp, state.acked_timestamp);
+      }
+    }
+    // Nothing is removed until a replica has connected so that it can catch up from the start.
+    if (!has_replica) {
+      min_acked_timestamp = -1;
+    }
+    const int64_t min_age_timestamp = (now - repl_params_.ulog_retention_time) * 1000;
+    size_t num_removed = 0;
+    int64_t threshold = -1;
+    // The latest file is being written so it is never removed.
+    while (num_removed + 1 < files.size()) {
+      const UpdateLogFile& file = files[num_removed];
+      if (file.timestamp >= min_acked_timestamp || file.timestamp > min_age_timestamp ||
+          total_size - file.file_size < repl_params_.ulog_retention_size) {
+        break;
+      }
+      threshold = file.timestamp;
+      total_size -= file.file_size;
+      num_removed++;
+    }
+    if (num_removed > 0) {
+      // The message queue removes the files under its lock so that live readers are not broken.
+      status = mq_->RemoveOldFiles(threshold, true);
+      if (status != Status::SUCCESS) {
+        logger_->LogCat(Logger::LEVEL_ERROR, "unable to remove old update log files: ", status);
+        return;
+      }
+      logger_->LogCat(Logger::LEVEL_INFO, "Removed ", num_removed,
+                      " old update log files up to the timestamp ", threshold);
+    }
+    // The metadata only has the timestamp of the last message so the first retained message
+    // is read to know the oldest timestamp.
+    auto reader = mq_->MakeReader(0);
+    int64_t oldest_timestamp = 0;
+    std::string message;
+    if (reader->Read(&oldest_timestamp, &message, 0) == Status::SUCCESS) {
+      ulog_oldest_timestamp_.store(oldest_timestamp);
+    } else if (num_removed > 0) {
+      ulog_oldest_timestamp_.store(std::max(ulog_oldest_timestamp_.load(), threshold + 1));
+    }
+    ulog_num_files_.store(files.size() - num_removed);
+    ulog_retained_bytes_.store(total_size);
+  }
+
   void SaveTimestamp(const ReplicationParameters& params) {
     if (params.ts_file.empty()) {
       return;
@@ -132,14 +637,33 @@ class DBMServiceBase {
                       " with the min_timestamp ", params->min_timestamp);
     }
     auto repl = master.MakeReplicator();
-    status = repl->Start(params->min_timestamp, server_id_, params->wait_time);
+    status = repl->Start(params->min_timestamp, server_id_, params->wait_time, params->address);
     if (status != Status::SUCCESS) {
       logger_->LogCat(Logger::LEVEL_WARN, "replication error: ", status);
       return false;
     }
     const int32_t master_id = repl->GetMasterServerID();
+    // Whether the master relays updates of another master is only shown for inspection.  The
+    // applied timestamp is given by the origin master in any case.
+    bool cascaded = false;
+    std::vector<std::pair<std::string, std::string>> master_records;
+    master.SetDBMIndex(-1);
+    if (master.Inspect(&master_records) == Status::SUCCESS) {
+      for (const auto& record : master_records) {
+        if (record.first == "repl_master") {
+          cascaded = true;
+        }
+      }
+    }
+    repl_cascaded_.store(cascaded);
+    repl_connected_.store(true);
+    ReplicationAcker acker(repl.get(), logger_);
+    ThroughputMeter apply_meter;
     RemoteDBM::ReplicateLog op;
     int64_t count = 0;
+    // The timestamp of the master's update logs is used to resume and acknowledge while the
+    // timestamp of the origin master is used to tell what has been applied.
+    int64_t origin_applied = repl_applied_timestamp_.load();
     while (alive_.load() && !refresh_repl_manager_.load()) {
       int64_t timestamp = 0;
       status = repl->Read(&timestamp, &op);
@@ -163,7 +687,7 @@ class DBMServiceBase {
             logger_->LogCat(Logger::LEVEL_DEBUG, "replication: ts=", timestamp,
                             ", server_id=", op.server_id, ", dbm_index=", op.dbm_index,
                             ", op=SET");
-            DBMUpdateLoggerMQ::OverwriteThreadServerID(master_id);
+            DBMUpdateLoggerMQ::OverwriteThreadServerID(op.server_id);
             status = dbm->Set(op.key, op.value);
             DBMUpdateLoggerMQ::OverwriteThreadServerID(-1);
             if (status != Status::SUCCESS) {
@@ -176,7 +700,7 @@ class DBMServiceBase {
             logger_->LogCat(Logger::LEVEL_DEBUG, "replication: ts=", timestamp,
                             ", server_id=", op.server_id, ", dbm_index=", op.dbm_index,
                             ", op=REMOVE");
-            DBMUpdateLoggerMQ::OverwriteThreadServerID(master_id);
+            DBMUpdateLoggerMQ::OverwriteThreadServerID(op.server_id);
             status = dbm->Remove(op.key);
             DBMUpdateLoggerMQ::OverwriteThreadServerID(-1);
             if (status != Status::SUCCESS && status != Status::NOT_FOUND_ERROR) {
@@ -189,7 +713,7 @@ class DBMServiceBase {
             logger_->LogCat(Logger::LEVEL_DEBUG, "replication: ts=", timestamp,
                             ", server_id=", op.server_id, ", dbm_index=", op.dbm_index,
                             ", op=CLEAR");
-            DBMUpdateLoggerMQ::OverwriteThreadServerID(master_id);
+            DBMUpdateLoggerMQ::OverwriteThreadServerID(op.server_id);
             status = dbm->Clear();
             DBMUpdateLoggerMQ::OverwriteThreadServerID(-1);
             if (status != Status::SUCCESS) {
@@ -205,8 +729,29 @@ class DBMServiceBase {
           SaveTimestamp(*params);
         }
         count++;
+        acker.Notify(params->min_timestamp);
+        const int64_t origin_timestamp = repl->GetOriginTimestamp();
+        origin_applied = std::max(origin_applied, origin_timestamp);
+        RecordOriginTimestamp(origin_applied);
+        const double now = GetWallTime();
+        apply_meter.Add(1, now);
+        if (origin_timestamp >= 0) {
+          repl_lag_.store(std::max<int64_t>(0, now * 1000 - origin_timestamp));
+        }
+        repl_num_applied_.fetch_add(1);
+        repl_apply_rate_.store(apply_meter.GetRate(now));
+        SetAppliedTimestamp(origin_applied);
       } else if (status == Status::INFEASIBLE_ERROR) {
         params->min_timestamp = std::max(timestamp, params->min_timestamp);
+        acker.Notify(params->min_timestamp);
+        const int64_t origin_timestamp = repl->GetOriginTimestamp();
+        origin_applied = std::max(origin_applied, origin_timestamp);
+        const double now = GetWallTime();
+        if (origin_timestamp >= 0) {
+          repl_lag_.store(std::max<int64_t>(0, now * 1000 - origin_timestamp));
+        }
+        repl_apply_rate_.store(apply_meter.GetRate(now));
+        SetAppliedTimestamp(origin_applied);
       } else {
         logger_->LogCat(Logger::LEVEL_WARN, "replication error: ", status);
         break;
@@ -216,6 +761,110 @@ class DBMServiceBase {
     return true;
   }
 
+  // Records that the update logs written so far cover a timestamp given by the origin master.
+  void RecordOriginTimestamp(int64_t origin_timestamp) {
+    if (mq_ == nullptr || origin_timestamp < 0) {
+      return;
+    }
+    const int64_t timestamp = mq_->GetTimestamp();
+    std::lock_guard<std::mutex> lock(origin_mutex_);
+    if (!origin_marks_.empty() && origin_marks_.back().first >= timestamp) {
+      origin_marks_.back().second = std::max(origin_marks_.back().second, origin_timestamp);
+      return;
+    }
+    if (origin_marks_.size() >= MAX_ORIGIN_MARKS) {
+      origin_marks_.pop_front();
+    }
+    origin_marks_.emplace_back(timestamp, origin_timestamp);
+  }
+
+  // Gets the timestamp given by the origin master which the update logs before a timestamp
+  // cover, or -1 if it is unknown.  Unless the server is a replica, it is the same timestamp.
+  int64_t GetOriginTimestamp(int64_t timestamp) {
+    {
+      std::lock_guard<SpinMutex> lock(mutex_);
+      if (repl_params_.master.empty()) {
+        return timestamp;
+      }
+    }
+    std::lock_guard<std::mutex> lock(origin_mutex_);
+    const auto it = std::lower_bound(origin_marks_.begin(), origin_marks_.end(),
+                                     std::make_pair(timestamp, INT64MIN));
+    return it == origin_marks_.begin() ? -1 : std::prev(it)->second;
+  }
+
+  void SetAppliedTimestamp(int64_t timestamp) {
+    {
+      std::lock_guard<std::mutex> lock(applied_mutex_);
+      repl_applied_timestamp_.store(timestamp);
+    }
+    applied_cond_.notify_all();
+  }
+
+  bool WaitForAppliedTimestamp(int64_t timestamp) {
+    if (timestamp <= 0) {
+      return true;
+    }
+    {
+      std::lock_guard<SpinMutex> lock(mutex_);
+      if (repl_params_.master.empty()) {
+        return true;
+      }
+    }
+    if (repl_applied_timestamp_.load() >= timestamp) {
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(applied_mutex_);
+    return applied_cond_.wait_for(
+        lock, std::chrono::microseconds(
+            static_cast<int64_t>(repl_params_.fence_timeout * 1000000)),
+        [&]() { return repl_applied_timestamp_.load() >= timestamp; });
+  }
+
+  int64_t ConfirmUpdate() {
+    if (mq_ == nullptr) {
+      return 0;
+    }
+    const int64_t timestamp = mq_->GetTimestamp();
+    if (repl_params_.semisync_replicas > 0) {
+      WaitForReplicas(SequencedUpdateLogger::GetThreadPosition());
+    }
+    return timestamp;
+  }
+
+  void WaitForReplicas(int64_t position) {
+    const double start_time = GetWallTime();
+    bool acked = false;
+    {
+      std::unique_lock<std::mutex> lock(ack_mutex_);
+      acked = ack_cond_.wait_for(
+          lock, std::chrono::microseconds(
+              static_cast<int64_t>(repl_params_.semisync_timeout * 1000000)),
+          [&]() { return CountAckedReplicas(position) >= repl_params_.semisync_replicas; });
+    }
+    const int64_t wait_usec = (GetWallTime() - start_time) * 1000000;
+    semisync_num_waits_.fetch_add(1);
+    semisync_total_wait_usec_.fetch_add(wait_usec);
+    int64_t max_wait_usec = semisync_max_wait_usec_.load();
+    while (wait_usec > max_wait_usec &&
+           !semisync_max_wait_usec_.compare_exchange_weak(max_wait_usec, wait_usec)) {}
+    if (!acked) {
+      semisync_num_timeouts_.fetch_add(1);
+      logger_->LogCat(Logger::LEVEL_WARN, "semi-sync replication timed out: position=",
+                      position);
+    }
+  }
+
+  int32_t CountAckedReplicas(int64_t position) {
+    int32_t num_acked = 0;
+    for (const auto& replica : replicas_) {
+      if (replica.first >= 0 && replica.second.acked_position >= position) {
+        num_acked++;
+      }
+    }
+    return num_acked;
+  }
+
   void LogRequest(grpc::ServerContext* context, const char* name,
                   const google::protobuf::Message* proto) {
     if (!logger_->CheckLevel(Logger::LEVEL_DEBUG)) {
@@ -296,10 +945,126 @@ class DBMServiceBase {
       out_record = response->add_records();
       out_record->set_first("memory_capacity");
       out_record->set_second(ToString(GetMemoryCapacity()));
+      InspectReplication(response);
+      if (repl_params_.semisync_replicas > 0) {
+        const int64_t num_waits = semisync_num_waits_.load();
+        const int64_t total_wait_usec = semisync_total_wait_usec_.load();
+        out_record = response->add_records();
+        out_record->set_first("semisync_replicas");
+        out_record->set_second(ToString(repl_params_.semisync_replicas));
+        out_record = response->add_records();
+        out_record->set_first("semisync_num_waits");
+        out_record->set_second(ToString(num_waits));
+        out_record = response->add_records();
+        out_record->set_first("semisync_num_timeouts");
+        out_record->set_second(ToString(semisync_num_timeouts_.load()));
+        out_record = response->add_records();
+        out_record->set_first("semisync_mean_wait_time");
+        out_record->set_second(SPrintF(
+            "%.6f", num_waits > 0 ? total_wait_usec / 1000000.0 / num_waits : 0.0));
+        out_record = response->add_records();
+        out_record->set_first("semisync_max_wait_time");
+        out_record->set_second(SPrintF("%.6f", semisync_max_wait_usec_.load() / 1000000.0));
+      }
     }
     return grpc::Status::OK;
   }
 
+  void InspectReplication(InspectResponse* response) {
+    auto* out_record = response->add_records();
+    out_record->set_first("server_id");
+    out_record->set_second(ToString(server_id_));
+    if (mq_ != nullptr) {
+      const int64_t ulog_timestamp = mq_->GetTimestamp();
+      out_record = response->add_records();
+      out_record->set_first("ulog_timestamp");
+      out_record->set_second(ToString(ulog_timestamp));
+      if (thread_ulog_manager_.joinable()) {
+        out_record = response->add_records();
+        out_record->set_first("ulog_num_files");
+        out_record->set_second(ToString(ulog_num_files_.load()));
+        out_record = response->add_records();
+        out_record->set_first("ulog_retained_bytes");
+        out_record->set_second(ToString(ulog_retained_bytes_.load()));
+        out_record = response->add_records();
+        out_record->set_first("ulog_oldest_timestamp");
+        out_record->set_second(ToString(ulog_oldest_timestamp_.load()));
+      }
+      if (repl_params_.compaction_horizon > 0) {
+        out_record = response->add_records();
+        out_record->set_first("compaction_num_sessions");
+        out_record->set_second(ToString(compaction_num_sessions_.load()));
+        out_record = response->add_records();
+        out_record->set_first("compaction_num_read");
+        out_record->set_second(ToString(compaction_num_read_.load()));
+        out_record = response->add_records();
+        out_record->set_first("compaction_num_sent");
+        out_record->set_second(ToString(compaction_num_sent_.load()));
+      }
+      const double now = GetWallTime();
+      std::lock_guard<std::mutex> lock(ack_mutex_);
+      int32_t num_observers = 0;
+      for (const auto& replica : replicas_) {
+        if (replica.first < 0) {
+          num_observers += replica.second.num_sessions;
+          continue;
+        }
+        const std::string prefix = StrCat("replica_", replica.first, "_");
+        const ReplicaState& state = replica.second;
+        out_record = response->add_records();
+        out_record->set_first(prefix + "connected");
+        out_record->set_second(ToString(state.num_sessions > 0 ? 1 : 0));
+        out_record = response->add_records();
+        out_record->set_first(prefix + "address");
+        out_record->set_second(state.address);
+        out_record = response->add_records();
+        out_record->set_first(prefix + "sent_timestamp");
+        out_record->set_second(ToString(state.sent_timestamp));
+        out_record = response->add_records();
+        out_record->set_first(prefix + "acked_timestamp");
+        out_record->set_second(ToString(state.acked_timestamp));
+        out_record = response->add_records();
+        out_record->set_first(prefix + "lag");
+        out_record->set_second(ToString(
+            std::max<int64_t>(0, ulog_timestamp - state.acked_timestamp)));
+        out_record = response->add_records();
+        out_record->set_first(prefix + "num_sent");
+        out_record->set_second(ToString(state.num_sent));
+        out_record = response->add_records();
+        out_record->set_first(prefix + "send_rate");
+        out_record->set_second(SPrintF("%.3f", state.send_meter.GetRate(now)));
+      }
+      out_record = response->add_records();
+      out_record->set_first("num_observers");
+      out_record->set_second(ToString(num_observers));
+    }
+    std::string master;
+    {
+      std::lock_guard<SpinMutex> lock(mutex_);
+      master = repl_params_.master;
+    }
+    if (!master.empty()) {
+      out_record = response->add_records();
+      out_record->set_first("repl_master");
+      out_record->set_second(master);
+      out_record = response->add_records();
+      out_record->set_first("repl_applied_timestamp");
+      out_record->set_second(ToString(repl_applied_timestamp_.load()));
+      out_record = response->add_records();
+      out_record->set_first("repl_lag");
+      out_record->set_second(ToString(repl_lag_.load()));
+      out_record = response->add_records();
+      out_record->set_first("repl_cascaded");
+      out_record->set_second(ToString(repl_cascaded_.load() ? 1 : 0));
+      out_record = response->add_records();
+      out_record->set_first("repl_num_applied");
+      out_record->set_second(ToString(repl_num_applied_.load()));
+      out_record = response->add_records();
+      out_record->set_first("repl_apply_rate");
+      out_record->set_second(SPrintF("%.3f", repl_apply_rate_.load()));
+    }
+  }
+
   grpc::Status GetImpl(
       grpc::ServerContext* context, const GetRequest* request,
       GetResponse* response) {
@@ -307,6 +1072,11 @@ class DBMServiceBase {
     if (request->dbm_index() < 0 || request->dbm_index() >= static_cast<int32_t>(dbms_.size())) {
       return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "dbm_index is out of range");
     }
+    if (!WaitForAppliedTimestamp(request->min_timestamp())) {
+      response->mutable_status()->set_code(Status::INFEASIBLE_ERROR);
+      response->mutable_status()->set_message("the minimum timestamp is not applied yet");
+      return grpc::Status::OK;
+    }
     auto& dbm = *dbms_[request->dbm_index()];
     std::string value;
     const Status status = dbm.Get(request->key(), request->omit_value() ? nullptr : &value);
@@ -325,6 +1095,11 @@ class DBMServiceBase {
     if (request->dbm_index() < 0 || request->dbm_index() >= static_cast<int32_t>(dbms_.size())) {
       return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "dbm_index is out of range");
     }
+    if (!WaitForAppliedTimestamp(request->min_timestamp())) {
+      response->mutable_status()->set_code(Status::INFEASIBLE_ERROR);
+      response->mutable_status()->set_message("the minimum timestamp is not applied yet");
+      return grpc::Status::OK;
+    }
     auto& dbm = *dbms_[request->dbm_index()];
     std::vector<std::string_view> keys;
     keys.reserve(request->keys_size());
@@ -352,6 +1127,9 @@ class DBMServiceBase {
     }
     auto& dbm = *dbms_[request->dbm_index()];
     const Status status = dbm.Set(request->key(), request->value(), request->overwrite());
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -370,6 +1148,9 @@ class DBMServiceBase {
       records.emplace(std::string_view(record.first()), std::string_view(record.second()));
     }
     const Status status = dbm.SetMulti(records, request->overwrite());
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -384,6 +1165,9 @@ class DBMServiceBase {
     }
     auto& dbm = *dbms_[request->dbm_index()];
     const Status status = dbm.Remove(request->key());
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -397,12 +1181,39 @@ class DBMServiceBase {
       return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "dbm_index is out of range");
     }
     auto& dbm = *dbms_[request->dbm_index()];
+    if (request->report_missing()) {
+      Status status(Status::SUCCESS);
+      bool removed = false;
+      for (const auto& key : request->keys()) {
+        const Status part = dbm.Remove(key);
+        if (part == Status::SUCCESS) {
+          removed = true;
+        } else if (part == Status::NOT_FOUND_ERROR) {
+          response->add_missing_keys(key);
+          if (status == Status::SUCCESS) {
+            status = part;
+          }
+        } else {
+          status = part;
+          break;
+        }
+      }
+      if (removed) {
+        response->set_timestamp(ConfirmUpdate());
+      }
+      response->mutable_status()->set_code(status.GetCode());
+      response->mutable_status()->set_message(status.GetMessage());
+      return grpc::Status::OK;
+    }
     std::vector<std::string_view> keys;
     keys.reserve(request->keys_size());
     for (const auto& key : request->keys()) {
       keys.emplace_back(key);
     }
     const Status status = dbm.RemoveMulti(keys);
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -417,6 +1228,9 @@ class DBMServiceBase {
     }
     auto& dbm = *dbms_[request->dbm_index()];
     const Status status = dbm.Append(request->key(), request->value(), request->delim());
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -435,6 +1249,9 @@ class DBMServiceBase {
       records.emplace(std::string_view(record.first()), std::string_view(record.second()));
     }
     const Status status = dbm.AppendMulti(records, request->delim());
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -457,6 +1274,9 @@ class DBMServiceBase {
       desired = request->desired_value();
     }
     const Status status = dbm.CompareExchange(request->key(), expected, desired);
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -473,6 +1293,9 @@ class DBMServiceBase {
     int64_t current = 0;
     const Status status =
         dbm.Increment(request->key(), request->increment(), &current, request->initial());
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     if (status == Status::SUCCESS) {
@@ -504,6 +1327,98 @@ class DBMServiceBase {
           record.existence() ? std::string_view(record.value()) : std::string_view()));
     }
     const Status status = dbm.CompareExchangeMulti(expected, desired);
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
+    response->mutable_status()->set_code(status.GetCode());
+    response->mutable_status()->set_message(status.GetMessage());
+    return grpc::Status::OK;
+  }
+
+  grpc::Status BatchImpl(
+      grpc::ServerContext* context, const BatchRequest* request,
+      BatchResponse* response) {
+    LogRequest(context, "Batch", request);
+    // The operations are grouped by the DBM and each group is done with one ProcessMulti call,
+    // which locks the records once.  All checkers run before appliers to allow cancellation.
+    std::map<int32_t, std::vector<int32_t>> groups;
+    for (int32_t i = 0; i < request->operations_size(); i++) {
+      const int32_t dbm_index = request->operations(i).dbm_index();
+      if (dbm_index < 0 || dbm_index >= static_cast<int32_t>(dbms_.size())) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "dbm_index is out of range");
+      }
+      groups[dbm_index].emplace_back(i);
+      response->add_results();
+    }
+    if (request->atomic() && groups.size() > 1) {
+      return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                          "an atomic batch must access only one DBM");
+    }
+    Status status(Status::SUCCESS);
+    bool aborted = false;
+    bool updated = false;
+    for (const auto& group : groups) {
+      auto& dbm = *dbms_[group.first];
+      std::map<std::string_view, BatchRecordState> states;
+      std::vector<std::string_view> state_keys;
+      std::vector<std::unique_ptr<BatchChecker>> checkers;
+      bool writable = false;
+      for (const int32_t op_index : group.second) {
+        const auto& op = request->operations(op_index);
+        auto it = states.find(op.key());
+        if (it == states.end()) {
+          it = states.emplace(op.key(), BatchRecordState()).first;
+          state_keys.emplace_back(op.key());
+        }
+        checkers.emplace_back(std::make_unique<BatchChecker>(
+            op, &it->second, response->mutable_results(op_index), request->atomic(), &aborted));
+        if (op.operation() != BatchOperation::OP_GET) {
+          writable = true;
+        }
+      }
+      std::vector<std::unique_ptr<BatchApplier>> appliers;
+      std::vector<std::pair<std::string_view, DBM::RecordProcessor*>> key_proc_pairs;
+      for (size_t i = 0; i < checkers.size(); i++) {
+        key_proc_pairs.emplace_back(request->operations(group.second[i]).key(),
+                                    checkers[i].get());
+      }
+      if (writable) {
+        for (const auto& key : state_keys) {
+          appliers.emplace_back(std::make_unique<BatchApplier>(&states[key], &aborted));
+          key_proc_pairs.emplace_back(key, appliers.back().get());
+        }
+      }
+      const Status part = dbm.ProcessMulti(key_proc_pairs, writable);
+      if (part != Status::SUCCESS) {
+        status = part;
+        break;
+      }
+      for (const auto& applier : appliers) {
+        updated |= applier->IsApplied();
+      }
+    }
+    if (status == Status::SUCCESS) {
+      for (const auto& result : response->results()) {
+        if (result.status().code() != Status::SUCCESS) {
+          status = Status(Status::Code(result.status().code()), result.status().message());
+          break;
+        }
+      }
+    }
+    if (aborted) {
+      for (int32_t i = 0; i < response->results_size(); i++) {
+        auto* result = response->mutable_results(i);
+        if (result->status().code() == Status::SUCCESS &&
+            request->operations(i).operation() != BatchOperation::OP_GET) {
+          result->mutable_status()->set_code(Status::INFEASIBLE_ERROR);
+          result->mutable_status()->set_message("aborted by a failed operation");
+          result->clear_current();
+        }
+      }
+    }
+    if (updated) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -554,6 +1469,9 @@ class DBMServiceBase {
     }
     auto& dbm = *dbms_[request->dbm_index()];
     const Status status = dbm.Clear();
+    if (status == Status::SUCCESS) {
+      response->set_timestamp(ConfirmUpdate());
+    }
     response->mutable_status()->set_code(status.GetCode());
     response->mutable_status()->set_message(status.GetMessage());
     return grpc::Status::OK;
@@ -855,13 +1773,25 @@ class DBMServiceBase {
         break;
       }
       case IterateRequest::OP_SET: {
+        std::string key;
+        (*iter)->Get(&key);
         const Status status = (*iter)->Set(request.value());
+        if (status == Status::SUCCESS) {
+          ConfirmUpdate();
+          response->set_key(key);
+        }
         response->mutable_status()->set_code(status.GetCode());
         response->mutable_status()->set_message(status.GetMessage());
         break;
       }
       case IterateRequest::OP_REMOVE: {
+        std::string key;
+        (*iter)->Get(&key);
         const Status status = (*iter)->Remove();
+        if (status == Status::SUCCESS) {
+          ConfirmUpdate();
+          response->set_key(key);
+        }
         response->mutable_status()->set_code(status.GetCode());
         response->mutable_status()->set_message(status.GetMessage());
         break;
@@ -876,28 +1806,37 @@ class DBMServiceBase {
   grpc::Status ReplicateImpl(
       grpc::ServerContext* context, const tkrzw::ReplicateRequest* request,
       grpc::ServerWriter<tkrzw::ReplicateResponse>* writer) {
-    std::unique_ptr<MessageQueue::Reader> reader;
+    ReplicateSession session;
     while (true) {
       if (context->IsCancelled()) {
+        if (session.reader != nullptr) {
+          FinishReplicateSession(request->server_id());
+        }
         return grpc::Status(grpc::StatusCode::CANCELLED, "cancelled");
       }
       tkrzw::ReplicateResponse response;
       const grpc::Status status = ReplicateProcessOne(
-          &reader, context, *request, &response);
+          &session, context, *request, &response);
       if (!status.ok()) {
+        if (session.reader != nullptr) {
+          FinishReplicateSession(request->server_id());
+        }
         return status;
       }
       if (!writer->Write(response)) {
         break;
       }
     }
+    if (session.reader != nullptr) {
+      FinishReplicateSession(request->server_id());
+    }
     return grpc::Status::OK;
   }
 
   grpc::Status ReplicateProcessOne(
-      std::unique_ptr<MessageQueue::Reader>* reader, grpc::ServerContext* context,
+      ReplicateSession* session, grpc::ServerContext* context,
       const tkrzw::ReplicateRequest& request, tkrzw::ReplicateResponse* response) {
-    if (*reader == nullptr) {
+    if (session->reader == nullptr) {
       LogRequest(context, "Replicate", &request);
       if (mq_ == nullptr) {
         return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "disabled update logging");
@@ -905,19 +1844,71 @@ class DBMServiceBase {
       if (request.server_id() == server_id_) {
         return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "self server ID");
       }
-      *reader = mq_->MakeReader(request.min_timestamp());
+      session->reader = mq_->MakeReader(request.min_timestamp());
+      if (repl_params_.compaction_horizon > 0) {
+        const int64_t horizon_timestamp =
+            (GetWallTime() - repl_params_.compaction_horizon) * 1000;
+        if (request.min_timestamp() < horizon_timestamp) {
+          session->compaction_timestamp = horizon_timestamp;
+          compaction_num_sessions_.fetch_add(1);
+        }
+      }
+      session->id = replicate_session_count_.fetch_add(1) + 1;
+      {
+        std::lock_guard<std::mutex> lock(ack_mutex_);
+        auto& replica = replicas_[request.server_id()];
+        replica.num_sessions++;
+        replica.sent_timestamp = request.min_timestamp();
+        replica.acked_timestamp = request.min_timestamp();
+        replica.address = ResolveReplicaAddress(context->peer(), request.address());
+        replica.session_id = session->id;
+        replica.sent_sequence = 0;
+        replica.acked_sequence = 0;
+        replica.checkpoints.clear();
+      }
       response->set_op_type(ReplicateResponse::OP_NOOP);
       response->set_server_id(server_id_);
+      response->set_session_id(session->id);
+      return grpc::Status::OK;
+    }
+    // Old updates are compacted chunk by chunk so that the memory usage is bounded.
+    while (session->pending.empty() && session->compaction_timestamp >= 0) {
+      CompactReplicateLogs(session, request);
+    }
+    if (!session->pending.empty()) {
+      *response = std::move(session->pending.front());
+      session->pending.pop_front();
+      RecordReplicaSent(session, request.server_id(), response, 1);
       return grpc::Status::OK;
     }
+    const bool semisync = repl_params_.semisync_replicas > 0;
     int64_t timestamp = 0;
     std::string message;
     double wait_time = request.wait_time();
+    // With semi-sync replication, the reader polls first and then waits in short slices so
+    // that the position of the reader is located soon after it has read all updates.
+    double read_wait = semisync ? 0 : wait_time;
     while (true) {
       if (context->IsCancelled()) {
         return grpc::Status(grpc::StatusCode::CANCELLED, "cancelled");
       }
-      Status status = (*reader)->Read(&timestamp, &message, wait_time);
+      // Until the position is known, polling is done while no update is logged so that the
+      // position is the number of logged updates if nothing is left to read.
+      std::unique_lock<std::mutex> ulog_lock(ulog_mutex_, std::defer_lock);
+      if (semisync && session->position < 0 && read_wait <= 0) {
+        ulog_lock.lock();
+      }
+      // If all logs are read, they cover what had been applied from the master before.
+      const int64_t applied_timestamp = repl_applied_timestamp_.load();
+      Status status = session->reader->Read(&timestamp, &message, read_wait);
+      if (ulog_lock.owns_lock()) {
+        if (status == Status::INFEASIBLE_ERROR) {
+          session->position = ulog_position_.load();
+        }
+        ulog_lock.unlock();
+      } else if (status == Status::SUCCESS && session->position >= 0) {
+        session->position++;
+      }
       if (status == Status::SUCCESS) {
         response->set_timestamp(timestamp);
         DBMUpdateLoggerMQ::UpdateLog op;
@@ -926,31 +1917,29 @@ class DBMServiceBase {
           if (op.server_id == request.server_id()) {
             continue;
           }
-          switch (op.op_type) {
-            case DBMUpdateLoggerMQ::OP_SET:
-              response->set_op_type(ReplicateResponse::OP_SET);
-              break;
-            case DBMUpdateLoggerMQ::OP_REMOVE:
-              response->set_op_type(ReplicateResponse::OP_REMOVE);
-              break;
-            case DBMUpdateLoggerMQ::OP_CLEAR:
-              response->set_op_type(ReplicateResponse::OP_CLEAR);
-              break;
-            default:
-              break;
-          }
-          response->set_server_id(op.server_id);
-          response->set_dbm_index(op.dbm_index);
-          response->set_key(op.key.data(), op.key.size());
-          response->set_value(op.value.data(), op.value.size());
+          SetReplicateOp(op, response);
+          response->set_origin_timestamp(GetOriginTimestamp(timestamp));
+          RecordReplicaSent(session, request.server_id(), response, 1);
         }
       } else if (status == Status::INFEASIBLE_ERROR) {
+        if (semisync && (wait_time < 0 || read_wait < wait_time)) {
+          if (wait_time > 0) {
+            wait_time -= read_wait;
+          }
+          read_wait = wait_time < 0 ?
+              SEMISYNC_POLL_INTERVAL : std::min(wait_time, SEMISYNC_POLL_INTERVAL);
+          continue;
+        }
         if (wait_time > 0) {
           mq_->UpdateTimestamp(-1);
           wait_time = 0;
+          read_wait = 0;
           continue;
         }
         response->set_timestamp(timestamp);
+        response->set_origin_timestamp(
+            std::max(GetOriginTimestamp(timestamp), applied_timestamp));
+        RecordReplicaSent(session, request.server_id(), response, 0);
       }
       response->mutable_status()->set_code(status.GetCode());
       response->mutable_status()->set_message(status.GetMessage());
@@ -959,6 +1948,210 @@ class DBMServiceBase {
     return grpc::Status::OK;
   }
 
+  static std::string ResolveReplicaAddress(
+      const std::string& peer, const std::string& address) {
+    const size_t port_pos = address.rfind(':');
+    if (port_pos == std::string::npos) {
+      return address;
+    }
+    const std::string host = address.substr(0, port_pos);
+    if (!host.empty() && host != "0.0.0.0" && host != "[::]") {
+      return address;
+    }
+    std::string peer_host = peer;
+    if (StrBeginsWith(peer_host, "ipv4:") || StrBeginsWith(peer_host, "ipv6:")) {
+      peer_host = peer_host.substr(5);
+    }
+    const size_t peer_port_pos = peer_host.rfind(':');
+    if (peer_port_pos != std::string::npos) {
+      peer_host = peer_host.substr(0, peer_port_pos);
+    }
+    return peer_host + address.substr(port_pos);
+  }
+
+  static void SetReplicateOp(
+      const DBMUpdateLoggerMQ::UpdateLog& op, tkrzw::ReplicateResponse* response) {
+    switch (op.op_type) {
+      case DBMUpdateLoggerMQ::OP_SET:
+        response->set_op_type(ReplicateResponse::OP_SET);
+        break;
+      case DBMUpdateLoggerMQ::OP_REMOVE:
+        response->set_op_type(ReplicateResponse::OP_REMOVE);
+        break;
+      case DBMUpdateLoggerMQ::OP_CLEAR:
+        response->set_op_type(ReplicateResponse::OP_CLEAR);
+        break;
+      default:
+        break;
+    }
+    response->set_server_id(op.server_id);
+    response->set_dbm_index(op.dbm_index);
+    response->set_key(op.key.data(), op.key.size());
+    response->set_value(op.value.data(), op.value.size());
+  }
+
+  void CompactReplicateLogs(
+      ReplicateSession* session, const tkrzw::ReplicateRequest& request) {
+    struct CompactedDBM {
+      std::unique_ptr<ReplicateResponse> clear;
+      std::map<std::string, ReplicateResponse> records;
+    };
+    std::map<int32_t, CompactedDBM> compacted;
+    std::unique_ptr<ReplicateResponse> next_op;
+    int64_t chunk_timestamp = -1;
+    int64_t chunk_origin_timestamp = -1;
+    int64_t chunk_size = 0;
+    int64_t num_read = 0;
+    int64_t timestamp = 0;
+    std::string message;
+    bool done = true;
+    while (session->reader->Read(&timestamp, &message, 0) == Status::SUCCESS) {
+      DBMUpdateLoggerMQ::UpdateLog op;
+      if (DBMUpdateLoggerMQ::ParseUpdateLog(message, &op) != Status::SUCCESS) {
+        continue;
+      }
+      auto entry = std::make_unique<ReplicateResponse>();
+      entry->set_timestamp(timestamp);
+      SetReplicateOp(op, entry.get());
+      if (timestamp >= session->compaction_timestamp) {
+        entry->set_origin_timestamp(GetOriginTimestamp(timestamp));
+        if (op.server_id != request.server_id()) {
+          next_op = std::move(entry);
+        }
+        break;
+      }
+      num_read++;
+      // The compacted records are sent with the timestamp of the first update in the chunk,
+      // which is not less than the minimum timestamp of the request.  Thus, the applied
+      // timestamp of the replica never goes backward and the replica resumes from the
+      // beginning of the chunk if the catch-up is interrupted.
+      if (chunk_timestamp < 0) {
+        chunk_timestamp = std::max<int64_t>(timestamp, request.min_timestamp());
+        chunk_origin_timestamp = GetOriginTimestamp(chunk_timestamp);
+      }
+      entry->set_timestamp(chunk_timestamp);
+      entry->set_origin_timestamp(chunk_origin_timestamp);
+      auto& dbm = compacted[op.dbm_index];
+      if (op.op_type == DBMUpdateLoggerMQ::OP_CLEAR) {
+        dbm.records.clear();
+        dbm.clear = std::move(entry);
+      } else if (op.op_type == DBMUpdateLoggerMQ::OP_SET ||
+                 op.op_type == DBMUpdateLoggerMQ::OP_REMOVE) {
+        dbm.records[std::string(op.key)] = std::move(*entry);
+      }
+      chunk_size += message.size();
+      if (chunk_size >= repl_params_.compaction_chunk_size) {
+        done = false;
+        break;
+      }
+    }
+    if (done) {
+      session->compaction_timestamp = -1;
+    }
+    const size_t num_pending = session->pending.size();
+    for (auto& dbm : compacted) {
+      if (dbm.second.clear != nullptr &&
+          dbm.second.clear->server_id() != request.server_id()) {
+        session->pending.emplace_back(std::move(*dbm.second.clear));
+      }
+      for (auto& record : dbm.second.records) {
+        if (record.second.server_id() != request.server_id()) {
+          session->pending.emplace_back(std::move(record.second));
+        }
+      }
+    }
+    const int64_t num_sent = session->pending.size() - num_pending;
+    if (next_op != nullptr) {
+      session->pending.emplace_back(std::move(*next_op));
+    }
+    compaction_num_read_.fetch_add(num_read);
+    compaction_num_sent_.fetch_add(num_sent);
+    logger_->LogCat(Logger::LEVEL_INFO, "Compacted update logs for server ",
+                    request.server_id(), ": read=", num_read, ", sent=", num_sent,
+                    done ? "" : ", continued");
+  }
+
+  void RecordReplicaSent(ReplicateSession* session, int32_t server_id,
+                         tkrzw::ReplicateResponse* response, int64_t num_ops) {
+    response->set_session_id(session->id);
+    response->set_sequence(++session->num_sent);
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    auto& replica = replicas_[server_id];
+    if (replica.session_id == session->id) {
+      replica.sent_timestamp = std::max(replica.sent_timestamp, response->timestamp());
+      replica.sent_sequence = session->num_sent;
+      // Each message gets a checkpoint so that its acknowledgement releases the writers of the
+      // updates read so far.  Old checkpoints are dropped if the replica doesn't acknowledge
+      // because later ones cover them.
+      if (repl_params_.semisync_replicas > 0 && session->position > replica.acked_position) {
+        if (replica.checkpoints.size() >= MAX_REPLICA_CHECKPOINTS) {
+          replica.checkpoints.pop_front();
+        }
+        replica.checkpoints.emplace_back(session->num_sent, session->position);
+      }
+    }
+    replica.num_sent += num_ops;
+    replica.send_meter.Add(num_ops, GetWallTime());
+  }
+
+  void FinishReplicateSession(int32_t server_id) {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    auto& replica = replicas_[server_id];
+    replica.num_sessions = std::max(0, replica.num_sessions - 1);
+    if (replica.num_sessions == 0) {
+      replica.disconnected_time = GetWallTime();
+    }
+  }
+
+  grpc::Status ReplicateAckImpl(
+      grpc::ServerContext* context, const ReplicateAckRequest* request,
+      ReplicateAckResponse* response) {
+    LogRequest(context, "ReplicateAck", request);
+    {
+      std::lock_guard<std::mutex> lock(ack_mutex_);
+      auto it = replicas_.find(request->server_id());
+      if (it == replicas_.end() || it->second.num_sessions < 1 ||
+          it->second.session_id != request->session_id()) {
+        response->mutable_status()->set_code(Status::PRECONDITION_ERROR);
+        response->mutable_status()->set_message("no live replication session");
+        return grpc::Status::OK;
+      }
+      // Acknowledgements are clamped to what has actually been sent in the session.
+      auto& replica = it->second;
+      replica.acked_timestamp = std::max(
+          replica.acked_timestamp, std::min(request->timestamp(), replica.sent_timestamp));
+      replica.acked_sequence = std::max(
+          replica.acked_sequence, std::min(request->sequence(), replica.sent_sequence));
+      while (!replica.checkpoints.empty() &&
+             replica.checkpoints.front().first <= replica.acked_sequence) {
+        replica.acked_position =
+            std::max(replica.acked_position, replica.checkpoints.front().second);
+        replica.checkpoints.pop_front();
+      }
+    }
+    ack_cond_.notify_all();
+    return grpc::Status::OK;
+  }
+
+  grpc::Status HeartbeatImpl(
+      grpc::ServerContext* context, const HeartbeatRequest* request,
+      HeartbeatResponse* response) {
+    LogRequest(context, "Heartbeat", request);
+    response->set_server_id(server_id_);
+    {
+      std::lock_guard<SpinMutex> lock(mutex_);
+      response->set_master(repl_params_.master);
+    }
+    response->set_replicating(repl_connected_.load());
+    response->set_applied_timestamp(repl_applied_timestamp_.load());
+    response->set_lag(repl_lag_.load());
+    response->set_cascaded(repl_cascaded_.load());
+    if (mq_ != nullptr) {
+      response->set_ulog_timestamp(mq_->GetTimestamp());
+    }
+    return grpc::Status::OK;
+  }
+
   grpc::Status ChangeMasterImpl(
       grpc::ServerContext* context, const ChangeMasterRequest* request,
       ChangeMasterResponse* response) {
@@ -979,8 +2172,36 @@ class DBMServiceBase {
   int64_t repl_ts_skew_;
   std::atomic_bool alive_;
   std::thread thread_repl_manager_;
+  std::thread thread_ulog_manager_;
   std::atomic_bool refresh_repl_manager_;
   SpinMutex mutex_;
+  std::map<int32_t, ReplicaState> replicas_;
+  std::mutex ack_mutex_;
+  std::condition_variable ack_cond_;
+  std::vector<std::unique_ptr<SequencedUpdateLogger>> ulogs_;
+  std::mutex ulog_mutex_;
+  std::atomic_int64_t ulog_position_;
+  std::atomic_int64_t replicate_session_count_;
+  std::atomic_bool repl_connected_;
+  std::atomic_bool repl_cascaded_;
+  std::deque<std::pair<int64_t, int64_t>> origin_marks_;
+  std::mutex origin_mutex_;
+  std::atomic_int64_t repl_applied_timestamp_;
+  std::atomic_int64_t repl_lag_;
+  std::atomic_int64_t repl_num_applied_;
+  std::atomic<double> repl_apply_rate_;
+  std::mutex applied_mutex_;
+  std::condition_variable applied_cond_;
+  std::atomic_int64_t semisync_num_waits_;
+  std::atomic_int64_t semisync_num_timeouts_;
+  std::atomic_int64_t semisync_total_wait_usec_;
+  std::atomic_int64_t semisync_max_wait_usec_;
+  std::atomic_int64_t ulog_num_files_;
+  std::atomic_int64_t ulog_retained_bytes_;
+  std::atomic_int64_t ulog_oldest_timestamp_;
+  std::atomic_int64_t compaction_num_sessions_;
+  std::atomic_int64_t compaction_num_read_;
+  std::atomic_int64_t compaction_num_sent_;
 };
 
 class DBMServiceImpl : public DBMServiceBase, public DBMService::Service {
@@ -1069,6 +2290,12 @@ class DBMServiceImpl : public DBMServiceBase, public DBMService::Service {
     return CompareExchangeMultiImpl(context, request, response);
   }
 
+  grpc::Status Batch(
+      grpc::ServerContext* context, const BatchRequest* request,
+      BatchResponse* response) override {
+    return BatchImpl(context, request, response);
+  }
+
   grpc::Status Count(
       grpc::ServerContext* context, const CountRequest* request,
       CountResponse* response) override {
@@ -1129,6 +2356,18 @@ class DBMServiceImpl : public DBMServiceBase, public DBMService::Service {
     return ReplicateImpl(context, request, writer);
   }
 
+  grpc::Status ReplicateAck(
+      grpc::ServerContext* context, const ReplicateAckRequest* request,
+      ReplicateAckResponse* response) override {
+    return ReplicateAckImpl(context, request, response);
+  }
+
+  grpc::Status Heartbeat(
+      grpc::ServerContext* context, const HeartbeatRequest* request,
+      HeartbeatResponse* response) override {
+    return HeartbeatImpl(context, request, response);
+  }
+
   grpc::Status ChangeMaster(
       grpc::ServerContext* context, const ChangeMasterRequest* request,
       ChangeMasterResponse* response) override {
@@ -1416,10 +2655,16 @@ class AsyncDBMProcessorReplicate : public AsyncDBMProcessorInterface {
       DBMAsyncServiceImpl* service, grpc::ServerCompletionQueue* queue)
       : service_(service), queue_(queue),
         context_(), stream_(&context_), proc_state_(CREATE),
-        reader_(nullptr), rpc_status_(grpc::Status::OK) {
+        session_(), rpc_status_(grpc::Status::OK) {
     Proceed();
   }
 
+  ~AsyncDBMProcessorReplicate() {
+    if (session_.reader != nullptr) {
+      service_->FinishReplicateSession(request_.server_id());
+    }
+  }
+
   void Proceed() override {
     if (proc_state_ == CREATE) {
       context_.grpc::ServerContext::AsyncNotifyWhenDone(nullptr);
@@ -1430,7 +2675,7 @@ class AsyncDBMProcessorReplicate : public AsyncDBMProcessorInterface {
         new AsyncDBMProcessorReplicate(service_, queue_);
       }
       response_.Clear();
-      rpc_status_ = service_->ReplicateProcessOne(&reader_, &context_, request_, &response_);
+      rpc_status_ = service_->ReplicateProcessOne(&session_, &context_, request_, &response_);
       if (rpc_status_.ok()) {
         proc_state_ = WRITE;
         stream_.Write(response_, this);
@@ -1460,7 +2705,7 @@ class AsyncDBMProcessorReplicate : public AsyncDBMProcessorInterface {
   grpc::ServerContext context_;
   grpc::ServerAsyncWriter<ReplicateResponse> stream_;
   ProcState proc_state_;
-  std::unique_ptr<MessageQueue::Reader> reader_;
+  ReplicateSession session_;
   tkrzw::ReplicateRequest request_;
   tkrzw::ReplicateResponse response_;
   grpc::Status rpc_status_;
@@ -1508,6 +2753,9 @@ inline void DBMAsyncServiceImpl::OperateQueue(
   new AsyncDBMProcessor<CompareExchangeMultiRequest, CompareExchangeMultiResponse>(
       this, queue, &DBMAsyncServiceImpl::RequestCompareExchangeMulti,
       &DBMServiceBase::CompareExchangeMultiImpl);
+  new AsyncDBMProcessor<BatchRequest, BatchResponse>(
+      this, queue, &DBMAsyncServiceImpl::RequestBatch,
+      &DBMServiceBase::BatchImpl);
   new AsyncDBMProcessor<CountRequest, CountResponse>(
       this, queue, &DBMAsyncServiceImpl::RequestCount,
       &DBMServiceBase::CountImpl);
@@ -1532,6 +2780,12 @@ inline void DBMAsyncServiceImpl::OperateQueue(
   new AsyncDBMProcessorStream(this, queue);
   new AsyncDBMProcessorIterate(this, queue);
   new AsyncDBMProcessorReplicate(this, queue);
+  new AsyncDBMProcessor<ReplicateAckRequest, ReplicateAckResponse>(
+      this, queue, &DBMAsyncServiceImpl::RequestReplicateAck,
+      &DBMServiceBase::ReplicateAckImpl);
+  new AsyncDBMProcessor<HeartbeatRequest, HeartbeatResponse>(
+      this, queue, &DBMAsyncServiceImpl::RequestHeartbeat,
+      &DBMServiceBase::HeartbeatImpl);
   new AsyncDBMProcessor<ChangeMasterRequest, ChangeMasterResponse>(
       this, queue, &DBMAsyncServiceImpl::RequestChangeMaster,
       &DBMServiceBase::ChangeMasterImpl);
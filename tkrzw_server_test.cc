@@ -292,6 +292,55 @@ TEST_F(ServerTest, Basic) {
     EXPECT_EQ(105, response.current());
     EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Remove("num"));
   }
+  {
+    tkrzw::BatchRequest request;
+    auto* op = request.add_operations();
+    op->set_operation(tkrzw::BatchOperation::OP_SET);
+    op->set_key("one");
+    op->set_value("ichi");
+    op->set_overwrite(true);
+    op = request.add_operations();
+    op->set_operation(tkrzw::BatchOperation::OP_APPEND);
+    op->set_dbm_index(1);
+    op->set_key("two");
+    op->set_value("ni");
+    op = request.add_operations();
+    op->set_operation(tkrzw::BatchOperation::OP_INCREMENT);
+    op->set_key("num");
+    op->set_increment(2);
+    op->set_initial(10);
+    *request.add_operations() = request.operations(2);
+    op = request.add_operations();
+    op->set_operation(tkrzw::BatchOperation::OP_GET);
+    op->set_key("one");
+    op = request.add_operations();
+    op->set_operation(tkrzw::BatchOperation::OP_REMOVE);
+    op->set_key("missing");
+    tkrzw::BatchResponse response;
+    grpc::Status status = server.Batch(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, response.status().code());
+    ASSERT_EQ(6, response.results_size());
+    EXPECT_EQ(12, response.results(2).current());
+    EXPECT_EQ(14, response.results(3).current());
+    EXPECT_EQ("ichi", response.results(4).value());
+    EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, response.results(5).status().code());
+    EXPECT_EQ("ichi", dbms[0]->GetSimple("one", "*"));
+    EXPECT_EQ("ni", dbms[1]->GetSimple("two", "*"));
+    EXPECT_EQ(tkrzw::IntToStrBigEndian(14), dbms[0]->GetSimple("num", "*"));
+    request.set_atomic(true);
+    status = server.Batch(&context, &request, &response);
+    EXPECT_FALSE(status.ok());
+    request.mutable_operations()->DeleteSubrange(1, 1);
+    response.Clear();
+    status = server.Batch(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, response.status().code());
+    EXPECT_EQ(tkrzw::Status::INFEASIBLE_ERROR, response.results(0).status().code());
+    EXPECT_EQ(tkrzw::IntToStrBigEndian(14), dbms[0]->GetSimple("num", "*"));
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Clear());
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[1]->Clear());
+  }
   for (int32_t i = 0; i < 30; i++) {
     const std::string expr = tkrzw::SPrintF("%08d", i);
     EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set(expr, expr));
@@ -528,4 +577,582 @@ TEST_F(ServerTest, Iterator) {
   EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Close());
 }
 
+TEST_F(ServerTest, SemiSync) {
+  tkrzw::TemporaryDirectory tmp_dir(true, "tkrzw-");
+  const std::string file_path = tmp_dir.MakeUniquePath();
+  const std::string ulog_prefix = tmp_dir.MakeUniquePath();
+  std::vector<std::unique_ptr<tkrzw::ParamDBM>> dbms(1);
+  dbms[0] = std::make_unique<tkrzw::PolyDBM>();
+  const std::map<std::string, std::string> params = {{"dbm", "HashDBM"}};
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            dbms[0]->OpenAdvanced(file_path, true, tkrzw::File::OPEN_DEFAULT, params));
+  tkrzw::MessageQueue mq;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, mq.Open(ulog_prefix, 1 << 20));
+  tkrzw::DBMUpdateLoggerMQ ulog(&mq, 1, 0);
+  dbms[0]->SetUpdateLogger(&ulog);
+  tkrzw::StreamLogger logger;
+  const tkrzw::ReplicationParameters repl_params("", 0, 0, "", 1, 10.0);
+  tkrzw::DBMServiceImpl server(dbms, &logger, 1, &mq, repl_params);
+  grpc::ServerContext context;
+  auto set_record = [&](const std::string& key, const std::string& value) {
+    grpc::ServerContext context;
+    tkrzw::SetRequest request;
+    request.set_key(key);
+    request.set_value(value);
+    tkrzw::SetResponse response;
+    grpc::Status status = server.Set(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    EXPECT_EQ(0, response.status().code());
+  };
+  auto ack = [&](int64_t session_id, int64_t sequence, int64_t timestamp) {
+    tkrzw::ReplicateAckRequest request;
+    request.set_server_id(2);
+    request.set_session_id(session_id);
+    request.set_sequence(sequence);
+    request.set_timestamp(timestamp);
+    tkrzw::ReplicateAckResponse response;
+    grpc::Status status = server.ReplicateAck(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    return response.status().code();
+  };
+  const int64_t future_timestamp = tkrzw::GetWallTime() * 1000 + 100000;
+  EXPECT_EQ(tkrzw::Status::PRECONDITION_ERROR, ack(0, 100, future_timestamp));
+  tkrzw::ReplicateRequest request;
+  request.set_min_timestamp(0);
+  request.set_server_id(2);
+  tkrzw::ReplicateSession session;
+  auto read_op = [&]() {
+    tkrzw::ReplicateResponse response;
+    grpc::Status status = server.ReplicateProcessOne(&session, &context, request, &response);
+    EXPECT_TRUE(status.ok());
+    return response;
+  };
+  const tkrzw::ReplicateResponse first_response = read_op();
+  const int64_t session_id = first_response.session_id();
+  EXPECT_GT(session_id, 0);
+  EXPECT_EQ(tkrzw::ReplicateResponse::OP_NOOP, first_response.op_type());
+  const tkrzw::ReplicateResponse drained_response = read_op();
+  EXPECT_EQ(tkrzw::Status::INFEASIBLE_ERROR, drained_response.status().code());
+  EXPECT_EQ(1, drained_response.sequence());
+  EXPECT_EQ(0, session.position);
+  EXPECT_EQ(tkrzw::Status::PRECONDITION_ERROR, ack(session_id + 1, 100, future_timestamp));
+  // Each writer is released by the acknowledgement of its own update log, even if the reader
+  // never catches up again.
+  auto read_set_op = [&](const std::string& key) {
+    for (int32_t i = 0; i < 1000; i++) {
+      const tkrzw::ReplicateResponse response = read_op();
+      if (response.op_type() == tkrzw::ReplicateResponse::OP_SET) {
+        EXPECT_EQ(key, response.key());
+        return response;
+      }
+      tkrzw::SleepThread(0.001);
+    }
+    return tkrzw::ReplicateResponse();
+  };
+  std::atomic_bool first_done(false);
+  std::thread first_writer([&]() {
+    set_record("one", "first");
+    first_done.store(true);
+  });
+  const tkrzw::ReplicateResponse first_op = read_set_op("one");
+  std::atomic_bool second_done(false);
+  std::thread second_writer([&]() {
+    set_record("two", "second");
+    second_done.store(true);
+  });
+  const tkrzw::ReplicateResponse second_op = read_set_op("two");
+  EXPECT_EQ(2, session.position);
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            ack(session_id, first_op.sequence(), first_op.timestamp()));
+  first_writer.join();
+  EXPECT_TRUE(first_done.load());
+  tkrzw::SleepThread(0.1);
+  EXPECT_FALSE(second_done.load());
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            ack(session_id, second_op.sequence(), second_op.timestamp()));
+  second_writer.join();
+  {
+    tkrzw::InspectRequest request;
+    request.set_dbm_index(-1);
+    tkrzw::InspectResponse response;
+    grpc::Status status = server.Inspect(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    std::map<std::string, std::string> records;
+    for (const auto& record : response.records()) {
+      records.emplace(record.first(), record.second());
+    }
+    EXPECT_EQ("1", records["semisync_replicas"]);
+    EXPECT_EQ("2", records["semisync_num_waits"]);
+    EXPECT_EQ("0", records["semisync_num_timeouts"]);
+    EXPECT_GT(tkrzw::StrToInt(records["ulog_timestamp"]), 0);
+    EXPECT_EQ("1", records["replica_2_connected"]);
+    EXPECT_EQ(records["replica_2_acked_timestamp"], tkrzw::ToString(second_op.timestamp()));
+  }
+  server.FinishReplicateSession(2);
+  EXPECT_EQ(tkrzw::Status::PRECONDITION_ERROR, ack(session_id, 100, future_timestamp));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Close());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, mq.Close());
+}
+
+TEST_F(ServerTest, ReplicationMetrics) {
+  tkrzw::TemporaryDirectory tmp_dir(true, "tkrzw-");
+  const std::string ulog_prefix = tmp_dir.MakeUniquePath();
+  std::vector<std::unique_ptr<tkrzw::ParamDBM>> dbms(1);
+  dbms[0] = std::make_unique<tkrzw::PolyDBM>();
+  const std::map<std::string, std::string> params = {{"dbm", "TinyDBM"}};
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            dbms[0]->OpenAdvanced("", true, tkrzw::File::OPEN_DEFAULT, params));
+  tkrzw::MessageQueue mq;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, mq.Open(ulog_prefix, 1 << 20));
+  tkrzw::DBMUpdateLoggerMQ ulog(&mq, 1, 0);
+  dbms[0]->SetUpdateLogger(&ulog);
+  for (int32_t i = 0; i < 5; i++) {
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set(tkrzw::ToString(i), tkrzw::ToString(i * i)));
+    tkrzw::SleepThread(0.002);
+  }
+  tkrzw::StreamLogger logger;
+  tkrzw::DBMServiceImpl server(dbms, &logger, 1, &mq);
+  grpc::ServerContext context;
+  auto inspect = [&]() {
+    tkrzw::InspectRequest request;
+    request.set_dbm_index(-1);
+    tkrzw::InspectResponse response;
+    grpc::Status status = server.Inspect(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    std::map<std::string, std::string> records;
+    for (const auto& record : response.records()) {
+      records.emplace(record.first(), record.second());
+    }
+    return records;
+  };
+  auto ack = [&](int64_t session_id, int64_t sequence, int64_t timestamp) {
+    tkrzw::ReplicateAckRequest request;
+    request.set_server_id(2);
+    request.set_session_id(session_id);
+    request.set_sequence(sequence);
+    request.set_timestamp(timestamp);
+    tkrzw::ReplicateAckResponse response;
+    grpc::Status status = server.ReplicateAck(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    return response.status().code();
+  };
+  auto expected_lag = [](const std::map<std::string, std::string>& records) {
+    const int64_t lag = tkrzw::StrToInt(records.at("ulog_timestamp")) -
+        tkrzw::StrToInt(records.at("replica_2_acked_timestamp"));
+    return tkrzw::ToString(std::max<int64_t>(0, lag));
+  };
+  auto records = inspect();
+  EXPECT_EQ(records.end(), records.find("replica_2_connected"));
+  EXPECT_EQ("0", records["num_observers"]);
+  tkrzw::ReplicateRequest request;
+  request.set_min_timestamp(0);
+  request.set_server_id(2);
+  tkrzw::ReplicateSession session;
+  std::vector<tkrzw::ReplicateResponse> responses;
+  for (int32_t i = 0; i < 6; i++) {
+    tkrzw::ReplicateResponse response;
+    grpc::Status status = server.ReplicateProcessOne(&session, &context, request, &response);
+    EXPECT_TRUE(status.ok());
+    responses.emplace_back(response);
+  }
+  EXPECT_EQ(tkrzw::ReplicateResponse::OP_NOOP, responses[0].op_type());
+  const int64_t session_id = responses[0].session_id();
+  for (int32_t i = 1; i < 6; i++) {
+    EXPECT_EQ(tkrzw::ReplicateResponse::OP_SET, responses[i].op_type());
+    EXPECT_EQ(i, responses[i].sequence());
+  }
+  records = inspect();
+  EXPECT_EQ("1", records["replica_2_connected"]);
+  EXPECT_EQ("5", records["replica_2_num_sent"]);
+  EXPECT_EQ(tkrzw::ToString(responses[5].timestamp()), records["replica_2_sent_timestamp"]);
+  EXPECT_EQ("0", records["replica_2_acked_timestamp"]);
+  EXPECT_EQ(expected_lag(records), records["replica_2_lag"]);
+  EXPECT_GE(tkrzw::StrToInt(records["replica_2_lag"]), responses[5].timestamp());
+  EXPECT_GT(tkrzw::StrToDouble(records["replica_2_send_rate"]), 0);
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            ack(session_id, responses[3].sequence(), responses[3].timestamp()));
+  records = inspect();
+  EXPECT_EQ(tkrzw::ToString(responses[3].timestamp()), records["replica_2_acked_timestamp"]);
+  EXPECT_EQ(expected_lag(records), records["replica_2_lag"]);
+  // Acknowledgements beyond what has been sent are clamped to the last sent timestamp.
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            ack(session_id, 100, responses[5].timestamp() + 100000));
+  records = inspect();
+  EXPECT_EQ(tkrzw::ToString(responses[5].timestamp()), records["replica_2_acked_timestamp"]);
+  EXPECT_EQ(expected_lag(records), records["replica_2_lag"]);
+  EXPECT_EQ("5", records["replica_2_num_sent"]);
+  server.FinishReplicateSession(2);
+  records = inspect();
+  EXPECT_EQ("0", records["replica_2_connected"]);
+  EXPECT_EQ(tkrzw::ToString(responses[5].timestamp()), records["replica_2_acked_timestamp"]);
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Close());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, mq.Close());
+}
+
+TEST_F(ServerTest, Compaction) {
+  tkrzw::TemporaryDirectory tmp_dir(true, "tkrzw-");
+  const std::string ulog_prefix = tmp_dir.MakeUniquePath();
+  std::vector<std::unique_ptr<tkrzw::ParamDBM>> dbms(1);
+  dbms[0] = std::make_unique<tkrzw::PolyDBM>();
+  const std::map<std::string, std::string> params = {{"dbm", "TinyDBM"}};
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            dbms[0]->OpenAdvanced("", true, tkrzw::File::OPEN_DEFAULT, params));
+  tkrzw::MessageQueue mq;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, mq.Open(ulog_prefix, 1 << 20));
+  tkrzw::DBMUpdateLoggerMQ ulog(&mq, 1, 0);
+  dbms[0]->SetUpdateLogger(&ulog);
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set("one", "first"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set("two", "second"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Clear());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set("one", "first"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set("one", "second"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set("two", "second"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Remove("two"));
+  tkrzw::SleepThread(0.2);
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set("three", "third"));
+  tkrzw::StreamLogger logger;
+  const tkrzw::ReplicationParameters repl_params(
+      "", 0, 0, "", 0, 1.0, 1.0, "", -1, 0, 0.1);
+  tkrzw::DBMServiceImpl server(dbms, &logger, 1, &mq, repl_params);
+  grpc::ServerContext context;
+  tkrzw::ReplicateRequest request;
+  request.set_min_timestamp(0);
+  request.set_server_id(2);
+  tkrzw::ReplicateSession session;
+  std::vector<tkrzw::ReplicateResponse> responses;
+  for (int32_t i = 0; i < 6; i++) {
+    tkrzw::ReplicateResponse response;
+    grpc::Status status = server.ReplicateProcessOne(&session, &context, request, &response);
+    EXPECT_TRUE(status.ok());
+    responses.emplace_back(response);
+  }
+  EXPECT_EQ(tkrzw::ReplicateResponse::OP_NOOP, responses[0].op_type());
+  EXPECT_EQ(tkrzw::ReplicateResponse::OP_CLEAR, responses[1].op_type());
+  EXPECT_EQ(tkrzw::ReplicateResponse::OP_SET, responses[2].op_type());
+  EXPECT_EQ("one", responses[2].key());
+  EXPECT_EQ("second", responses[2].value());
+  EXPECT_GT(responses[1].timestamp(), 0);
+  EXPECT_EQ(responses[1].timestamp(), responses[2].timestamp());
+  EXPECT_EQ(responses[1].timestamp(), responses[3].timestamp());
+  EXPECT_EQ(tkrzw::ReplicateResponse::OP_REMOVE, responses[3].op_type());
+  EXPECT_EQ("two", responses[3].key());
+  EXPECT_EQ(tkrzw::ReplicateResponse::OP_SET, responses[4].op_type());
+  EXPECT_EQ("three", responses[4].key());
+  EXPECT_GT(responses[4].timestamp(), 0);
+  EXPECT_EQ(tkrzw::Status::INFEASIBLE_ERROR, responses[5].status().code());
+  server.FinishReplicateSession(2);
+  // Each update log is a chunk by itself if the chunk size is tiny.
+  const tkrzw::ReplicationParameters chunk_params(
+      "", 0, 0, "", 0, 1.0, 1.0, "", -1, 0, 0.1, "", -1, 1);
+  tkrzw::DBMServiceImpl chunk_server(dbms, &logger, 1, &mq, chunk_params);
+  tkrzw::ReplicateSession chunk_session;
+  responses.clear();
+  for (int32_t i = 0; i < 10; i++) {
+    tkrzw::ReplicateResponse response;
+    grpc::Status status = chunk_server.ReplicateProcessOne(
+        &chunk_session, &context, request, &response);
+    EXPECT_TRUE(status.ok());
+    responses.emplace_back(response);
+  }
+  const std::vector<tkrzw::ReplicateResponse::OpType> op_types = {
+    tkrzw::ReplicateResponse::OP_NOOP, tkrzw::ReplicateResponse::OP_SET,
+    tkrzw::ReplicateResponse::OP_SET, tkrzw::ReplicateResponse::OP_CLEAR,
+    tkrzw::ReplicateResponse::OP_SET, tkrzw::ReplicateResponse::OP_SET,
+    tkrzw::ReplicateResponse::OP_SET, tkrzw::ReplicateResponse::OP_REMOVE,
+    tkrzw::ReplicateResponse::OP_SET,
+  };
+  for (size_t i = 0; i < op_types.size(); i++) {
+    EXPECT_EQ(op_types[i], responses[i].op_type());
+    if (i > 1) {
+      EXPECT_GE(responses[i].timestamp(), responses[i - 1].timestamp());
+    }
+  }
+  EXPECT_EQ("three", responses[8].key());
+  EXPECT_EQ(tkrzw::Status::INFEASIBLE_ERROR, responses[9].status().code());
+  chunk_server.FinishReplicateSession(2);
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Close());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, mq.Close());
+}
+
+TEST_F(ServerTest, InProcess) {
+  std::vector<std::unique_ptr<tkrzw::ParamDBM>> dbms(1);
+  dbms[0] = std::make_unique<tkrzw::PolyDBM>();
+  const std::map<std::string, std::string> params = {{"dbm", "TinyDBM"}};
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            dbms[0]->OpenAdvanced("", true, tkrzw::File::OPEN_DEFAULT, params));
+  tkrzw::StreamLogger logger;
+  tkrzw::DBMServiceImpl service(dbms, &logger, 1, nullptr);
+  grpc::ServerBuilder builder;
+  builder.RegisterService(&service);
+  std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
+  ASSERT_NE(nullptr, server);
+  tkrzw::RemoteDBM::RegisterInProcessServer("test", server.get());
+  {
+    tkrzw::RemoteDBM dbm;
+    EXPECT_EQ(tkrzw::Status::NOT_FOUND_ERROR, dbm.Connect("inproc:unknown", 1.0));
+    tkrzw::RemoteDBM::ConnectOptions options;
+    options.num_channels = 0;
+    EXPECT_EQ(tkrzw::Status::INVALID_ARGUMENT_ERROR, dbm.Connect("inproc:test", options));
+    options.num_channels = 2;
+    options.compression = "unknown";
+    EXPECT_EQ(tkrzw::Status::INVALID_ARGUMENT_ERROR, dbm.Connect("inproc:test", options));
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Connect("inproc:test", 1.0, 2));
+    std::vector<std::pair<std::string, std::string>> records;
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.InspectClient(&records));
+    EXPECT_NE(records.end(), std::find(records.begin(), records.end(),
+                                       std::make_pair(std::string("num_channels"),
+                                                      std::string("2"))));
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Set("one", "first"));
+    EXPECT_EQ("first", dbm.GetSimple("one"));
+    EXPECT_EQ("first", dbms[0]->GetSimple("one"));
+    for (int32_t i = 0; i < 10; i++) {
+      EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Set(tkrzw::ToString(i), tkrzw::ToString(i * i)));
+    }
+    for (int32_t i = 0; i < 10; i++) {
+      EXPECT_EQ(tkrzw::ToString(i * i), dbm.GetSimple(tkrzw::ToString(i)));
+    }
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Disconnect());
+  }
+  {
+    tkrzw::RemoteDBM dbm;
+    tkrzw::RemoteDBM::ConnectOptions options;
+    options.num_channels = 3;
+    options.compression = "gzip";
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Connect("inproc:test", options));
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Set("two", "second"));
+    EXPECT_EQ("second", dbm.GetSimple("two"));
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Disconnect());
+  }
+  tkrzw::RemoteDBM::RegisterInProcessServer("test", nullptr);
+  server->Shutdown();
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Close());
+}
+
+TEST_F(ServerTest, CascadedReplication) {
+  tkrzw::TemporaryDirectory tmp_dir(true, "tkrzw-");
+  const std::map<std::string, std::string> params = {{"dbm", "TinyDBM"}};
+  std::vector<std::unique_ptr<tkrzw::ParamDBM>> master_dbms(1);
+  master_dbms[0] = std::make_unique<tkrzw::PolyDBM>();
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            master_dbms[0]->OpenAdvanced("", true, tkrzw::File::OPEN_DEFAULT, params));
+  tkrzw::MessageQueue master_mq;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, master_mq.Open(tmp_dir.MakeUniquePath(), 1 << 20));
+  tkrzw::DBMUpdateLoggerMQ master_ulog(&master_mq, 1, 0);
+  master_dbms[0]->SetUpdateLogger(&master_ulog);
+  std::vector<std::unique_ptr<tkrzw::ParamDBM>> relay_dbms(1);
+  relay_dbms[0] = std::make_unique<tkrzw::PolyDBM>();
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            relay_dbms[0]->OpenAdvanced("", true, tkrzw::File::OPEN_DEFAULT, params));
+  tkrzw::MessageQueue relay_mq;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, relay_mq.Open(tmp_dir.MakeUniquePath(), 1 << 20));
+  tkrzw::DBMUpdateLoggerMQ relay_ulog(&relay_mq, 2, 0);
+  relay_dbms[0]->SetUpdateLogger(&relay_ulog);
+  std::vector<std::unique_ptr<tkrzw::ParamDBM>> leaf_dbms(1);
+  leaf_dbms[0] = std::make_unique<tkrzw::PolyDBM>();
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            leaf_dbms[0]->OpenAdvanced("", true, tkrzw::File::OPEN_DEFAULT, params));
+  tkrzw::StreamLogger logger;
+  tkrzw::DBMServiceImpl master_service(master_dbms, &logger, 1, &master_mq);
+  grpc::ServerBuilder master_builder;
+  master_builder.RegisterService(&master_service);
+  std::unique_ptr<grpc::Server> master_server(master_builder.BuildAndStart());
+  ASSERT_NE(nullptr, master_server);
+  tkrzw::RemoteDBM::RegisterInProcessServer("chain_master", master_server.get());
+  const tkrzw::ReplicationParameters relay_params(
+      "inproc:chain_master", 0, 0.1, "", 0, 1.0, 10.0, "", -1, 0, 0, "inproc:chain_relay");
+  auto relay_service = std::make_unique<tkrzw::DBMServiceImpl>(
+      relay_dbms, &logger, 2, &relay_mq, relay_params);
+  grpc::ServerBuilder relay_builder;
+  relay_builder.RegisterService(relay_service.get());
+  std::unique_ptr<grpc::Server> relay_server(relay_builder.BuildAndStart());
+  ASSERT_NE(nullptr, relay_server);
+  tkrzw::RemoteDBM::RegisterInProcessServer("chain_relay", relay_server.get());
+  auto leaf_service = std::make_unique<tkrzw::DBMServiceImpl>(
+      leaf_dbms, &logger, 3, nullptr, tkrzw::ReplicationParameters(
+          "inproc:chain_relay", 0, 0.1, "", 0, 1.0, 10.0, "", -1, 0, 0, "inproc:chain_leaf"));
+  tkrzw::RemoteDBM dbm;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Connect("inproc:chain_master", 10.0));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Set("one", "first"));
+  const int64_t first_timestamp = dbm.GetLastTimestamp();
+  EXPECT_GT(first_timestamp, 0);
+  grpc::ServerContext context;
+  auto get_leaf = [&](const std::string& key, int64_t min_timestamp) {
+    tkrzw::GetRequest request;
+    request.set_key(key);
+    request.set_min_timestamp(min_timestamp);
+    tkrzw::GetResponse response;
+    grpc::Status status = leaf_service->Get(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    EXPECT_EQ(0, response.status().code());
+    return response.value();
+  };
+  // The leaf applies the update with the timestamp of the master through the relay.
+  EXPECT_EQ("first", get_leaf("one", first_timestamp));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Set("two", "second"));
+  const int64_t second_timestamp = dbm.GetLastTimestamp();
+  EXPECT_GE(second_timestamp, first_timestamp);
+  EXPECT_EQ("second", get_leaf("two", second_timestamp));
+  auto inspect = [&](tkrzw::DBMServiceImpl* service) {
+    tkrzw::InspectRequest request;
+    request.set_dbm_index(-1);
+    tkrzw::InspectResponse response;
+    grpc::Status status = service->Inspect(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    std::map<std::string, std::string> records;
+    for (const auto& record : response.records()) {
+      records.emplace(record.first(), record.second());
+    }
+    return records;
+  };
+  // The records followed by the topology view link the chain.
+  auto records = inspect(&master_service);
+  EXPECT_EQ(records.end(), records.find("repl_master"));
+  EXPECT_EQ("inproc:chain_relay", records["replica_2_address"]);
+  EXPECT_EQ("1", records["replica_2_connected"]);
+  records = inspect(relay_service.get());
+  EXPECT_EQ("inproc:chain_master", records["repl_master"]);
+  EXPECT_EQ("0", records["repl_cascaded"]);
+  EXPECT_GE(tkrzw::StrToInt(records["repl_applied_timestamp"]), second_timestamp);
+  EXPECT_EQ("inproc:chain_leaf", records["replica_3_address"]);
+  EXPECT_EQ("1", records["replica_3_connected"]);
+  records = inspect(leaf_service.get());
+  EXPECT_EQ("inproc:chain_relay", records["repl_master"]);
+  EXPECT_EQ("1", records["repl_cascaded"]);
+  EXPECT_GE(tkrzw::StrToInt(records["repl_applied_timestamp"]), second_timestamp);
+  EXPECT_LT(tkrzw::StrToInt(records["repl_lag"]), 10000);
+  {
+    tkrzw::HeartbeatRequest request;
+    tkrzw::HeartbeatResponse response;
+    grpc::Status status = leaf_service->Heartbeat(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    EXPECT_TRUE(response.replicating());
+    EXPECT_TRUE(response.cascaded());
+    EXPECT_GE(response.applied_timestamp(), second_timestamp);
+  }
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbm.Disconnect());
+  leaf_service.reset(nullptr);
+  tkrzw::RemoteDBM::RegisterInProcessServer("chain_relay", nullptr);
+  relay_server->Shutdown();
+  relay_server.reset(nullptr);
+  relay_service.reset(nullptr);
+  tkrzw::RemoteDBM::RegisterInProcessServer("chain_master", nullptr);
+  master_server->Shutdown();
+  EXPECT_EQ("second", leaf_dbms[0]->GetSimple("two"));
+  EXPECT_EQ(tkrzw::Status::SUCCESS, leaf_dbms[0]->Close());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, relay_dbms[0]->Close());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, master_dbms[0]->Close());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, relay_mq.Close());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, master_mq.Close());
+}
+
+TEST_F(ServerTest, UpdateLogRetention) {
+  tkrzw::TemporaryDirectory tmp_dir(true, "tkrzw-");
+  const std::string ulog_prefix = tmp_dir.MakeUniquePath();
+  std::vector<std::unique_ptr<tkrzw::ParamDBM>> dbms(1);
+  dbms[0] = std::make_unique<tkrzw::PolyDBM>();
+  const std::map<std::string, std::string> params = {{"dbm", "TinyDBM"}};
+  EXPECT_EQ(tkrzw::Status::SUCCESS,
+            dbms[0]->OpenAdvanced("", true, tkrzw::File::OPEN_DEFAULT, params));
+  tkrzw::MessageQueue mq;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, mq.Open(ulog_prefix, 256));
+  tkrzw::DBMUpdateLoggerMQ ulog(&mq, 1, 0);
+  dbms[0]->SetUpdateLogger(&ulog);
+  for (int32_t i = 0; i < 30; i++) {
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set(tkrzw::ToString(i), "abcdefghijklmnop"));
+    tkrzw::SleepThread(0.002);
+  }
+  auto count_files = [&]() {
+    std::vector<std::string> paths;
+    EXPECT_EQ(tkrzw::Status::SUCCESS, tkrzw::MessageQueue::FindFiles(ulog_prefix, &paths));
+    return paths.size();
+  };
+  const size_t num_files = count_files();
+  EXPECT_GT(num_files, 3);
+  tkrzw::StreamLogger logger;
+  const tkrzw::ReplicationParameters repl_params(
+      "", 0, 0, "", 0, 1.0, 1.0, ulog_prefix, 0, 0, 0, "", 0.5);
+  tkrzw::DBMServiceImpl server(dbms, &logger, 1, &mq, repl_params);
+  server.RemoveOldUpdateLogs(tkrzw::GetWallTime() + 1);
+  EXPECT_EQ(num_files, count_files());
+  grpc::ServerContext context;
+  tkrzw::ReplicateRequest request;
+  request.set_min_timestamp(0);
+  request.set_server_id(2);
+  tkrzw::ReplicateSession session;
+  std::vector<tkrzw::ReplicateResponse> responses;
+  for (int32_t i = 0; i < 31; i++) {
+    tkrzw::ReplicateResponse response;
+    grpc::Status status = server.ReplicateProcessOne(&session, &context, request, &response);
+    EXPECT_TRUE(status.ok());
+    responses.emplace_back(response);
+  }
+  server.RemoveOldUpdateLogs(tkrzw::GetWallTime() + 1);
+  EXPECT_EQ(num_files, count_files());
+  auto ack = [&](const tkrzw::ReplicateResponse& response) {
+    tkrzw::ReplicateAckRequest request;
+    request.set_server_id(2);
+    request.set_session_id(response.session_id());
+    request.set_sequence(response.sequence());
+    request.set_timestamp(response.timestamp());
+    tkrzw::ReplicateAckResponse response_ack;
+    grpc::Status status = server.ReplicateAck(&context, &request, &response_ack);
+    EXPECT_TRUE(status.ok());
+    EXPECT_EQ(0, response_ack.status().code());
+  };
+  const int64_t middle_timestamp = responses[15].timestamp();
+  ack(responses[15]);
+  server.RemoveOldUpdateLogs(tkrzw::GetWallTime() + 1);
+  std::vector<std::string> paths;
+  EXPECT_EQ(tkrzw::Status::SUCCESS, tkrzw::MessageQueue::FindFiles(ulog_prefix, &paths));
+  EXPECT_LT(paths.size(), num_files);
+  for (const auto& path : paths) {
+    int64_t file_id = 0, timestamp = 0, file_size = 0;
+    EXPECT_EQ(tkrzw::Status::SUCCESS, tkrzw::MessageQueue::ReadFileMetadata(
+        path, &file_id, &timestamp, &file_size));
+    EXPECT_GE(timestamp, middle_timestamp);
+  }
+  auto get_oldest_timestamp = [&]() {
+    tkrzw::InspectRequest request;
+    request.set_dbm_index(-1);
+    tkrzw::InspectResponse response;
+    grpc::Status status = server.Inspect(&context, &request, &response);
+    EXPECT_TRUE(status.ok());
+    for (const auto& record : response.records()) {
+      if (record.first() == "ulog_oldest_timestamp") {
+        return tkrzw::StrToInt(record.second());
+      }
+    }
+    return static_cast<int64_t>(-1);
+  };
+  const int64_t oldest_timestamp = get_oldest_timestamp();
+  EXPECT_GT(oldest_timestamp, responses[1].timestamp());
+  EXPECT_LE(oldest_timestamp, middle_timestamp);
+  bool oldest_found = false;
+  for (const auto& response : responses) {
+    if (response.timestamp() == oldest_timestamp) {
+      oldest_found = true;
+    }
+  }
+  EXPECT_TRUE(oldest_found);
+  ack(responses[30]);
+  server.RemoveOldUpdateLogs(tkrzw::GetWallTime() + 1);
+  EXPECT_EQ(1, count_files());
+  EXPECT_GT(get_oldest_timestamp(), oldest_timestamp);
+  EXPECT_LE(get_oldest_timestamp(), responses[30].timestamp());
+  server.FinishReplicateSession(2);
+  for (int32_t i = 0; i < 30; i++) {
+    EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Set(tkrzw::ToString(i), "ABCDEFGHIJKLMNOP"));
+    tkrzw::SleepThread(0.002);
+  }
+  const size_t num_new_files = count_files();
+  EXPECT_GT(num_new_files, 3);
+  // The disconnected replica holds the files within the grace period.
+  server.RemoveOldUpdateLogs(tkrzw::GetWallTime());
+  EXPECT_EQ(num_new_files, count_files());
+  server.RemoveOldUpdateLogs(tkrzw::GetWallTime() + 1);
+  EXPECT_EQ(1, count_files());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, dbms[0]->Close());
+  EXPECT_EQ(tkrzw::Status::SUCCESS, mq.Close());
+}
+
 // END OF FILE